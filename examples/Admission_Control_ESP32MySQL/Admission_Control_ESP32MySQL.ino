@@ -0,0 +1,134 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/*********************************************************************************************************************************
+  Admission_Control_ESP32MySQL.ino
+  by Syafiqlim @ syafiqlimx
+
+ **********************************************************************************************************************************/
+/*
+  INSTRUCTIONS FOR USE
+
+  This example submits a burst of BURST_ROWS INSERTs every BURST_INTERVAL_MS, as a device
+  reporting an alarm would, through an ESP32_MySQL_Admission. The INSERTs leave its bounded
+  queue at RATE per second at most, and slower while the server takes more than LATENCY_MS to
+  answer, so loop() is never held up for long and a fleet of devices can't flood the server.
+  Every 5 seconds it prints the statements sent, throttled and dropped, the current rate and
+  the average round trip. Put some load on the server to watch the rate come down.
+
+  1) Change the user and password to a valid MySQL user and password in Credentials.h
+  2) Change the SSID and pass to match your WiFi network in Credentials.h
+  3) Change the server, default DB, default table and default column according to your DB schema
+  4) Connect a USB cable to your ESP32
+  5) Select the correct board and port
+  6) Compile and upload the sketch to your ESP32
+  7) Once uploaded, open Serial Monitor (use 115200 speed) and observe
+
+*/
+
+#include "Credentials.h"
+
+#define ESP32_MYSQL_DEBUG_PORT      Serial
+
+// Debug Level from 0 to 4
+#define _ESP32_MYSQL_LOGLEVEL_      1
+
+#include <ESP32_MySQL.h>
+
+char server[] = "192.168.1.10"; // change to your local server's address
+
+uint16_t server_port = 3306;    // MySQL server port (default : 3306)
+
+char default_database[] = "DB0";           //default DB
+char default_table[]    = "TEST0x00";          //default table
+
+char default_column[] = "data0";   //default column
+
+#define RATE                  20            // statements per second
+#define BURST                 5
+#define QUEUE_STATEMENTS      64
+#define LATENCY_MS            150           // slow down above this round trip
+#define BURST_ROWS            100
+#define BURST_INTERVAL_MS     10000
+
+ESP32_MySQL_Connection conn((Client *)&client);
+
+ESP32_MySQL_Admission writes(&conn, RATE, BURST, QUEUE_STATEMENTS, 4096);
+
+unsigned long last_burst  = 0;
+unsigned long last_report = 0;
+int event = 0;
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000); // wait for serial port to connect
+
+  ESP32_MYSQL_DISPLAY1("\nStarting Admission_Control_ESP32MySQL on", ARDUINO_BOARD);
+
+  // Begin WiFi section
+  ESP32_MYSQL_DISPLAY1("Connecting to", ssid);
+
+  WiFi.begin(ssid, pass);
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    delay(500);
+    ESP32_MYSQL_DISPLAY0(".");
+  }
+
+  // print out info about the connection:
+  ESP32_MYSQL_DISPLAY1("Connected to network. My IP address is:", WiFi.localIP());
+
+  ESP32_MYSQL_DISPLAY("Connecting...");
+
+  while (!conn.connect(server, server_port, user, password))
+  {
+    ESP32_MYSQL_DISPLAY("Connect failed. Trying again.");
+    delay(5000);
+  }
+
+  // Lets keepalive() reconnect
+  conn.set_keepalive(30000);
+
+  writes.set_latency_target(LATENCY_MS, 2);
+  writes.set_overflow(ADMIT_DROP_OLDEST);
+}
+
+void loop()
+{
+  if (millis() - last_burst >= BURST_INTERVAL_MS)
+  {
+    last_burst = millis();
+
+    for (int i = 0; i < BURST_ROWS; i++)
+    {
+      String sql = String("INSERT INTO ") + default_database + "." + default_table
+                   + " (" + default_column + ") VALUES ('event " + event++ + "')";
+
+      writes.submit(sql.c_str());
+    }
+  }
+
+  // About 50 ms at most; with the connection down, reconnect outside of it
+  if (!writes.service(50))
+    conn.keepalive();
+
+  if (millis() - last_report >= 5000)
+  {
+    last_report = millis();
+
+    const Admission_Stats& stats = writes.stats();
+
+    ESP32_MYSQL_DISPLAY5("Sent:", stats.sent, "throttled:", stats.throttled, "waiting:", writes.queued());
+    ESP32_MYSQL_DISPLAY5("Dropped:", stats.dropped_oldest + stats.dropped_newest, "rejected:", stats.rejected,
+                         "slowdowns:", stats.slowdowns);
+    ESP32_MYSQL_DISPLAY3("Rate per second:", writes.current_rate(), "average ms:", stats.avg_latency_ms);
+  }
+}
@@ -0,0 +1,133 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/*********************************************************************************************************************************
+  Aggregate_Insert_ESP32MySQL.ino
+  by Syafiqlim @ syafiqlimx
+
+ **********************************************************************************************************************************/
+/*
+  INSTRUCTIONS FOR USE
+
+  This example reads two sensors every SAMPLE_INTERVAL_MS, but only inserts one row per sensor
+  and minute, with the min, max, average and last value of that minute. The rows are reduced
+  on the ESP32 by an ESP32_MySQL_Aggregator and sent by an ESP32_MySQL_Insert_Batcher. With a
+  dead band of DEAD_BAND, a minute whose values moved less than that since the last row is
+  held back, for at most MAX_HELD_BACK minutes. Every minute the samples taken and the rows
+  sent are printed.
+
+  The table needs the columns: start BIGINT, sensor INT, min_v FLOAT, max_v FLOAT, avg_v DOUBLE, last_v FLOAT
+
+  1) Change the user and password to a valid MySQL user and password in Credentials.h
+  2) Change the SSID and pass to match your WiFi network in Credentials.h
+  3) Change the server, default DB and default table according to your DB schema
+  4) Connect a USB cable to your ESP32
+  5) Select the correct board and port
+  6) Compile and upload the sketch to your ESP32
+  7) Once uploaded, open Serial Monitor (use 115200 speed) and observe
+
+*/
+
+#include "Credentials.h"
+
+#define ESP32_MYSQL_DEBUG_PORT      Serial
+
+// Debug Level from 0 to 4
+#define _ESP32_MYSQL_LOGLEVEL_      1
+
+#include <ESP32_MySQL.h>
+
+char server[] = "192.168.1.10"; // change to your local server's address
+
+uint16_t server_port = 3306;    // MySQL server port (default : 3306)
+
+char default_database[] = "DB0";           //default DB
+char default_table[]    = "TEST0x00";          //default table
+
+#define SAMPLE_INTERVAL_MS    100           // 10 samples per second and sensor
+#define WINDOW_MS             60000         // a row per minute
+#define DEAD_BAND             0.2f
+#define MAX_HELD_BACK         15            // a row every 15 minutes at least
+
+#define TEMPERATURE_SENSOR    1
+#define LIGHT_SENSOR          2
+#define LIGHT_PIN             34
+
+ESP32_MySQL_Connection conn((Client *)&client);
+
+ESP32_MySQL_Insert_Batcher *batcher;
+ESP32_MySQL_Aggregator *minutes;
+
+unsigned long last_sample = 0;
+unsigned long last_report = 0;
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000); // wait for serial port to connect
+
+  ESP32_MYSQL_DISPLAY1("\nStarting Aggregate_Insert_ESP32MySQL on", ARDUINO_BOARD);
+
+  // Begin WiFi section
+  ESP32_MYSQL_DISPLAY1("Connecting to", ssid);
+
+  WiFi.begin(ssid, pass);
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    delay(500);
+    ESP32_MYSQL_DISPLAY0(".");
+  }
+
+  // print out info about the connection:
+  ESP32_MYSQL_DISPLAY1("Connected to network. My IP address is:", WiFi.localIP());
+
+  ESP32_MYSQL_DISPLAY("Connecting...");
+
+  while (!conn.connect(server, server_port, user, password))
+  {
+    ESP32_MYSQL_DISPLAY("Connect failed. Trying again.");
+    delay(5000);
+  }
+
+  // Reconnects by itself before the next INSERT
+  conn.set_keepalive(30000);
+
+  String table = String(default_database) + "." + default_table;
+
+  // The rows of a minute go out together
+  batcher = new ESP32_MySQL_Insert_Batcher(&conn, table.c_str(), "start, sensor, min_v, max_v, avg_v, last_v", 50, 5000);
+  minutes = new ESP32_MySQL_Aggregator(*batcher, AGG_MIN | AGG_MAX | AGG_AVG | AGG_LAST, WINDOW_MS);
+
+  minutes->set_dead_band(DEAD_BAND, MAX_HELD_BACK);
+}
+
+void loop()
+{
+  if (millis() - last_sample >= SAMPLE_INTERVAL_MS)
+  {
+    last_sample = millis();
+
+    minutes->add(TEMPERATURE_SENSOR, temperatureRead());
+    minutes->add(LIGHT_SENSOR, analogRead(LIGHT_PIN) / 40.95f);      // percent
+  }
+
+  minutes->flush_if_due();
+  batcher->flush_if_due();
+
+  if (millis() - last_report >= WINDOW_MS)
+  {
+    last_report = millis();
+
+    const Agg_Stats& stats = minutes->stats();
+
+    ESP32_MYSQL_DISPLAY5("Samples:", stats.samples, "rows:", stats.windows, "held back by the dead band:", stats.suppressed);
+    ESP32_MYSQL_DISPLAY3("Rows inserted:", batcher->stats().rows, "failed:", stats.failed + batcher->stats().failed_rows);
+  }
+}
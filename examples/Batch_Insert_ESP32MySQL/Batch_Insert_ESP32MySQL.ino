@@ -0,0 +1,135 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/*********************************************************************************************************************************
+  Batch_Insert_ESP32MySQL.ino
+  by Syafiqlim @ syafiqlimx
+
+ **********************************************************************************************************************************/
+/*
+  INSTRUCTIONS FOR USE
+
+  This example takes a sample every SAMPLE_INTERVAL_MS and hands it to an ESP32_MySQL_Insert_Batcher,
+  which sends the samples as multi-row INSERT statements: when the buffer is full, when
+  BATCH_ROWS rows are waiting, or when the oldest is BATCH_AGE_MS old. Every minute it prints
+  the flush statistics.
+
+  The table needs the columns: sensor INT, value FLOAT, note VARCHAR(32)
+
+  1) Change the user and password to a valid MySQL user and password in Credentials.h
+  2) Change the SSID and pass to match your WiFi network in Credentials.h
+  3) Change the server, default DB and default table according to your DB schema
+  4) Connect a USB cable to your ESP32
+  5) Select the correct board and port
+  6) Compile and upload the sketch to your ESP32
+  7) Once uploaded, open Serial Monitor (use 115200 speed) and observe
+
+*/
+
+#include "Credentials.h"
+
+#define ESP32_MYSQL_DEBUG_PORT      Serial
+
+// Debug Level from 0 to 4
+#define _ESP32_MYSQL_LOGLEVEL_      1
+
+#include <ESP32_MySQL.h>
+
+char server[] = "xxxxxx.com"; // change to your server's hostname/URL
+
+uint16_t server_port = 3306;    // MySQL server port (default : 3306)
+
+char default_database[] = "DB0";           //default DB
+char default_table[]    = "TEST0x00";          //default table
+
+#define SAMPLE_INTERVAL_MS    20
+#define BATCH_ROWS            200
+#define BATCH_AGE_MS          5000
+#define BATCH_BYTES           8192
+
+ESP32_MySQL_Connection conn((Client *)&client);
+
+ESP32_MySQL_Insert_Batcher *batcher;
+
+unsigned long last_sample = 0;
+unsigned long last_report = 0;
+int           sample      = 0;
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000); // wait for serial port to connect
+
+  ESP32_MYSQL_DISPLAY1("\nStarting Batch_Insert_ESP32MySQL on", ARDUINO_BOARD);
+
+  // Begin WiFi section
+  ESP32_MYSQL_DISPLAY1("Connecting to", ssid);
+
+  WiFi.begin(ssid, pass);
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    delay(500);
+    ESP32_MYSQL_DISPLAY0(".");
+  }
+
+  // print out info about the connection:
+  ESP32_MYSQL_DISPLAY1("Connected to network. My IP address is:", WiFi.localIP());
+
+  String table = String(default_database) + "." + default_table;
+
+  batcher = new ESP32_MySQL_Insert_Batcher(&conn, table.c_str(), "sensor, value, note", BATCH_ROWS, BATCH_AGE_MS, BATCH_BYTES);
+}
+
+void printStats()
+{
+  const Batcher_Stats& stats = batcher->stats();
+
+  ESP32_MYSQL_DISPLAY3("INSERTs:", stats.flushes, "rows:", stats.rows);
+  ESP32_MYSQL_DISPLAY3("Failed INSERTs:", stats.failed_flushes, "rows dropped:", stats.failed_rows);
+  ESP32_MYSQL_DISPLAY5("Flushed when full:", stats.reasons[BATCHER_FLUSH_BYTES], "on rows:", stats.reasons[BATCHER_FLUSH_ROWS],
+                       "on age:", stats.reasons[BATCHER_FLUSH_AGE]);
+  ESP32_MYSQL_DISPLAY5("Round trip ms, last:", stats.last_flush_ms, "max:", stats.max_flush_ms, "largest INSERT bytes:", stats.max_bytes_used);
+
+  batcher->reset_stats();
+}
+
+void loop()
+{
+  if (!conn.connected())
+  {
+    ESP32_MYSQL_DISPLAY("Connecting...");
+
+    if (!conn.connect(server, server_port, user, password))
+    {
+      ESP32_MYSQL_DISPLAY("\nConnect failed. Trying again in 5s.");
+      delay(5000);
+      return;
+    }
+  }
+
+  if (millis() - last_sample >= SAMPLE_INTERVAL_MS)
+  {
+    last_sample = millis();
+
+    // False only when the connection is down and the buffer is full
+    if (!batcher->add_row(sample % 8, (float) analogRead(A0) * 3.3f / 4095, "batched"))
+      ESP32_MYSQL_DISPLAY1("Sample lost:", sample);
+
+    sample++;
+  }
+
+  batcher->flush_if_due();
+
+  if (millis() - last_report >= 60000)
+  {
+    last_report = millis();
+    printStats();
+  }
+}
@@ -0,0 +1,146 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/*********************************************************************************************************************************
+  Commit_Group_ESP32MySQL.ino
+  by Syafiqlim @ syafiqlimx
+
+ **********************************************************************************************************************************/
+/*
+  INSTRUCTIONS FOR USE
+
+  This example runs the same ROWS_PER_RUN single-row INSERTs several times and prints the rows
+  per second of each run: first with autocommit, where every INSERT is committed (and flushed
+  to disk by the server) on its own, then with an ESP32_MySQL_Commit_Group committing every
+  10, 50 and 200 INSERTs. Use a server on the local network, so the commit cost is not hidden
+  behind the network round trips.
+
+  1) Change the user and password to a valid MySQL user and password in Credentials.h
+  2) Change the SSID and pass to match your WiFi network in Credentials.h
+  3) Change the server, default DB, default table and default column according to your DB schema
+  4) Connect a USB cable to your ESP32
+  5) Select the correct board and port
+  6) Compile and upload the sketch to your ESP32
+  7) Once uploaded, open Serial Monitor (use 115200 speed) and observe
+
+*/
+
+#include "Credentials.h"
+
+#define ESP32_MYSQL_DEBUG_PORT      Serial
+
+// Debug Level from 0 to 4
+#define _ESP32_MYSQL_LOGLEVEL_      1
+
+#include <ESP32_MySQL.h>
+
+char server[] = "192.168.1.10"; // change to your local server's address
+
+uint16_t server_port = 3306;    // MySQL server port (default : 3306)
+
+char default_database[] = "DB0";           //default DB
+char default_table[]    = "TEST0x00";          //default table
+
+char default_column[] = "data0";   //default column
+
+#define ROWS_PER_RUN        500
+
+ESP32_MySQL_Connection conn((Client *)&client);
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000); // wait for serial port to connect
+
+  ESP32_MYSQL_DISPLAY1("\nStarting Commit_Group_ESP32MySQL on", ARDUINO_BOARD);
+
+  // Begin WiFi section
+  ESP32_MYSQL_DISPLAY1("Connecting to", ssid);
+
+  WiFi.begin(ssid, pass);
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    delay(500);
+    ESP32_MYSQL_DISPLAY0(".");
+  }
+
+  // print out info about the connection:
+  ESP32_MYSQL_DISPLAY1("Connected to network. My IP address is:", WiFi.localIP());
+}
+
+String insertSQL(const char *note, int row)
+{
+  return String("INSERT INTO ") + default_database + "." + default_table
+         + " (" + default_column + ") VALUES ('" + note + " #" + row + "')";
+}
+
+// ROWS_PER_RUN INSERTs, each committed on its own
+void runAutocommit()
+{
+  ESP32_MySQL_Query query(&conn);
+
+  int inserted = 0;
+
+  unsigned long start = millis();
+
+  for (int i = 0; i < ROWS_PER_RUN; i++)
+  {
+    if (query.execute(insertSQL("autocommit", i).c_str()))
+      inserted++;
+  }
+
+  unsigned long elapsed = millis() - start;
+
+  ESP32_MYSQL_DISPLAY5("Autocommit      :", (inserted * 1000UL) / (elapsed ? elapsed : 1), "rows/s, inserted", inserted, "of", ROWS_PER_RUN);
+}
+
+// ROWS_PER_RUN INSERTs, one commit per group_size
+void runGrouped(uint16_t group_size)
+{
+  ESP32_MySQL_Commit_Group group(&conn, group_size, 60000);
+
+  unsigned long start = millis();
+
+  for (int i = 0; i < ROWS_PER_RUN; i++)
+    group.execute(insertSQL("grouped", i).c_str());
+
+  group.commit();
+
+  unsigned long elapsed = millis() - start;
+
+  const Group_Stats& stats = group.stats();
+
+  ESP32_MYSQL_DISPLAY5("Commit every", group_size, ":", (stats.statements * 1000UL) / (elapsed ? elapsed : 1), "rows/s, commits", stats.commits);
+  ESP32_MYSQL_DISPLAY5("  COMMIT ms, last:", stats.last_commit_ms, "max:", stats.max_commit_ms, "replays:", stats.replays);
+}
+
+void loop()
+{
+  ESP32_MYSQL_DISPLAY("Connecting...");
+
+  if (conn.connect(server, server_port, user, password))
+  {
+    runAutocommit();
+    runGrouped(10);
+    runGrouped(50);
+    runGrouped(200);
+
+    conn.close();                     // close the connection
+  }
+  else
+  {
+    ESP32_MYSQL_DISPLAY("\nConnect failed. Trying again on next iteration.");
+  }
+
+  ESP32_MYSQL_DISPLAY("\nSleeping...");
+  ESP32_MYSQL_DISPLAY("================================================");
+
+  delay(60000);
+}
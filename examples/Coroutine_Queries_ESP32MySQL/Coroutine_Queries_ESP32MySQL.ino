@@ -0,0 +1,143 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/*********************************************************************************************************************************
+  Coroutine_Queries_ESP32MySQL.ino
+  by Syafiqlim @ syafiqlimx
+
+ **********************************************************************************************************************************/
+/*
+  INSTRUCTIONS FOR USE
+
+  This example needs a C++20 toolchain (arduino-esp32 core v3.x or newer). Several
+  database conversations run concurrently from loop(), each on its own connection,
+  without creating a task per connection.
+
+  1) Change the user and password to a valid MySQL user and password in Credentials.h
+  2) Change the SSID and pass to match your WiFi network in Credentials.h
+  3) Change the server, database, table and query according to your DB schema
+  4) Connect a USB cable to your ESP32
+  5) Select the correct board and port
+  6) Compile and upload the sketch to your ESP32
+  7) Once uploaded, open Serial Monitor (use 115200 speed) and observe
+
+*/
+
+#include "Credentials.h"
+
+#define ESP32_MYSQL_DEBUG_PORT      Serial
+
+// Debug Level from 0 to 4
+#define _ESP32_MYSQL_LOGLEVEL_      1
+
+#include <ESP32_MySQL.h>
+
+#ifndef ESP32_MYSQL_HAS_COROUTINES
+  #error This example needs a C++20 compiler with coroutine support
+#endif
+
+char server[] = "xxxxxx.com"; // change to your server's hostname/URL
+
+uint16_t server_port = 3306;    // MySQL server port (default : 3306)
+
+char default_database[] = "DB0";           //default DB
+char default_table[]    = "TEST0x00";          //default table
+
+#define NUM_CONVERSATIONS     4
+
+WiFiClient              clients[NUM_CONVERSATIONS];
+ESP32_MySQL_Connection  *conns[NUM_CONVERSATIONS];
+
+ESP32_MySQL_Scheduler   scheduler;
+
+// One logical DB conversation: connect, query, print the rows, disconnect
+ESP32_MySQL_Task conversation(ESP32_MySQL_Connection *conn, int id)
+{
+  if ( !co_await async_connect(conn, server, server_port, user, password, default_database) )
+  {
+    ESP32_MYSQL_DISPLAY1("Connect failed, conversation", id);
+    co_return;
+  }
+
+  ESP32_MySQL_Query query_mem = ESP32_MySQL_Query(conn);
+
+  String query = String("SELECT * FROM ") + default_database + "." + default_table + " LIMIT 5";
+
+  if ( co_await async_execute(&query_mem, query.c_str()) )
+  {
+    column_names *cols = co_await async_get_columns(&query_mem);
+
+    while (row_values *row = co_await async_get_next_row(&query_mem))
+    {
+      ESP32_MYSQL_DISPLAY0(id);
+      ESP32_MYSQL_DISPLAY0(": ");
+
+      for (int f = 0; cols && (f < cols->num_fields); f++)
+      {
+        ESP32_MYSQL_DISPLAY0(row->values[f]);
+        
+        if (f < cols->num_fields - 1)
+          ESP32_MYSQL_DISPLAY0(",");
+      }
+      
+      ESP32_MYSQL_DISPLAY();
+    }
+  }
+  else
+  {
+    ESP32_MYSQL_DISPLAY1("Querying error, conversation", id);
+  }
+
+  // Let the other conversations run before closing
+  co_await async_sleep(100);
+  
+  conn->close();
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000); // wait for serial port to connect
+
+  ESP32_MYSQL_DISPLAY1("\nStarting Coroutine_Queries_ESP32MySQL on", ARDUINO_BOARD);
+
+  // Begin WiFi section
+  ESP32_MYSQL_DISPLAY1("Connecting to", ssid);
+  
+  WiFi.begin(ssid, pass);
+  
+  while (WiFi.status() != WL_CONNECTED) 
+  {
+    delay(500);
+    ESP32_MYSQL_DISPLAY0(".");
+  }
+
+  // print out info about the connection:
+  ESP32_MYSQL_DISPLAY1("Connected to network. My IP address is:", WiFi.localIP());
+
+  for (int i = 0; i < NUM_CONVERSATIONS; i++)
+    conns[i] = new ESP32_MySQL_Connection((Client *) &clients[i]);
+}
+
+void loop()
+{
+  unsigned long start = millis();
+  
+  for (int i = 0; i < NUM_CONVERSATIONS; i++)
+    scheduler.spawn(conversation(conns[i], i));
+
+  // All conversations interleave while waiting for the server
+  scheduler.run();
+
+  ESP32_MYSQL_DISPLAY3(NUM_CONVERSATIONS, "conversations finished in", millis() - start, "ms");
+  ESP32_MYSQL_DISPLAY("\nSleeping...");
+  ESP32_MYSQL_DISPLAY("================================================");
+ 
+  delay(10000);
+}
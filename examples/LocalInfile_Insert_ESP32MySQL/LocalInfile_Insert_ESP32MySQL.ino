@@ -0,0 +1,183 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/*********************************************************************************************************************************
+  LocalInfile_Insert_ESP32MySQL.ino
+  by Syafiqlim @ syafiqlimx
+
+ **********************************************************************************************************************************/
+/*
+  INSTRUCTIONS FOR USE
+
+  This example loads the same number of rows twice and prints the rows per second for
+  each: once with multi-row INSERT statements of ROWS_PER_INSERT rows, and once with a
+  single LOAD DATA LOCAL INFILE whose file is generated line by line while it is sent.
+  The generated file never exists in RAM as a whole.
+
+  The server must allow it: SET GLOBAL local_infile = 1;
+
+  1) Change the user and password to a valid MySQL user and password in Credentials.h
+  2) Change the SSID and pass to match your WiFi network in Credentials.h
+  3) Change the server, default DB, default table and default column according to your DB schema
+  4) Connect a USB cable to your ESP32
+  5) Select the correct board and port
+  6) Compile and upload the sketch to your ESP32
+  7) Once uploaded, open Serial Monitor (use 115200 speed) and observe
+
+*/
+
+#include "Credentials.h"
+
+#define ESP32_MYSQL_DEBUG_PORT      Serial
+
+// Debug Level from 0 to 4
+#define _ESP32_MYSQL_LOGLEVEL_      1
+
+#include <ESP32_MySQL.h>
+
+char server[] = "xxxxxx.com"; // change to your server's hostname/URL
+
+uint16_t server_port = 3306;    // MySQL server port (default : 3306)
+
+char default_database[] = "DB0";           //default DB
+char default_table[]    = "TEST0x00";          //default table
+
+char default_column[] = "data0";   //default column
+
+#define ROWS_PER_RUN        2000
+#define ROWS_PER_INSERT     50
+
+ESP32_MySQL_Connection conn((Client *)&client);
+
+// Where the generated file is up to
+struct Row_Generator
+{
+  int next_row;
+  int rows;
+};
+
+Row_Generator generator;
+
+// Long_Data_Source writing whole lines "infile #<row>\n" until buffer is full
+size_t generateRows(uint8_t *buffer, const size_t& size, void *context)
+{
+  Row_Generator *gen = (Row_Generator *) context;
+  size_t length = 0;
+
+  while (gen->next_row < gen->rows)
+  {
+    char line[32];
+    int line_len = snprintf(line, sizeof(line), "infile #%d\n", gen->next_row);
+
+    if (length + line_len > size)
+      break;
+
+    memcpy(&buffer[length], line, line_len);
+    length += line_len;
+    gen->next_row++;
+  }
+
+  return length;
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000); // wait for serial port to connect
+
+  ESP32_MYSQL_DISPLAY1("\nStarting LocalInfile_Insert_ESP32MySQL on", ARDUINO_BOARD);
+
+  // Only this name can be loaded; must be added before connect()
+  conn.add_local_infile("rows.txt", generateRows, &generator);
+
+  // Begin WiFi section
+  ESP32_MYSQL_DISPLAY1("Connecting to", ssid);
+
+  WiFi.begin(ssid, pass);
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    delay(500);
+    ESP32_MYSQL_DISPLAY0(".");
+  }
+
+  // print out info about the connection:
+  ESP32_MYSQL_DISPLAY1("Connected to network. My IP address is:", WiFi.localIP());
+}
+
+// Insert ROWS_PER_RUN rows, ROWS_PER_INSERT per statement
+void runInserts()
+{
+  ESP32_MySQL_Query query(&conn);
+
+  int loaded = 0;
+
+  unsigned long start = millis();
+
+  for (int i = 0; i < ROWS_PER_RUN; i += ROWS_PER_INSERT)
+  {
+    String sql = String("INSERT INTO ") + default_database + "." + default_table
+               + " (" + default_column + ") VALUES ";
+
+    for (int r = i; (r < i + ROWS_PER_INSERT) && (r < ROWS_PER_RUN); r++)
+      sql += String((r > i) ? "," : "") + "('insert #" + r + "')";
+
+    if (query.execute(sql.c_str()))
+      loaded += query.get_rows_affected();
+  }
+
+  unsigned long elapsed = millis() - start;
+
+  ESP32_MYSQL_DISPLAY5("Multi-row INSERT :", (loaded * 1000UL) / (elapsed ? elapsed : 1), "rows/s, loaded", loaded, "of", ROWS_PER_RUN);
+}
+
+// Load ROWS_PER_RUN rows with one statement
+void runLoadData()
+{
+  ESP32_MySQL_Query query(&conn);
+
+  int loaded = 0;
+
+  generator.next_row  = 0;
+  generator.rows      = ROWS_PER_RUN;
+
+  unsigned long start = millis();
+
+  String sql = String("LOAD DATA LOCAL INFILE 'rows.txt' INTO TABLE ") + default_database + "." + default_table
+             + " (" + default_column + ")";
+
+  if (query.execute(sql.c_str()))
+    loaded = query.get_rows_affected();
+
+  unsigned long elapsed = millis() - start;
+
+  ESP32_MYSQL_DISPLAY5("LOAD DATA LOCAL  :", (loaded * 1000UL) / (elapsed ? elapsed : 1), "rows/s, loaded", loaded, "of", ROWS_PER_RUN);
+}
+
+void loop()
+{
+  ESP32_MYSQL_DISPLAY("Connecting...");
+
+  if (conn.connect(server, server_port, user, password))
+  {
+    runInserts();
+    runLoadData();
+
+    conn.close();                     // close the connection
+  }
+  else
+  {
+    ESP32_MYSQL_DISPLAY("\nConnect failed. Trying again on next iteration.");
+  }
+
+  ESP32_MYSQL_DISPLAY("\nSleeping...");
+  ESP32_MYSQL_DISPLAY("================================================");
+
+  delay(60000);
+}
@@ -0,0 +1,19 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+#ifndef Credentials_h
+#define Credentials_h
+
+char ssid[] = "xxxxx";             // your network SSID (name)
+char pass[] = "xxxxx";         // your network password
+
+char user[]         = "xxxxx";              // MySQL user login username
+char password[]     = "xxxxx";          // MySQL user login password
+
+#endif    //Credentials_h
@@ -0,0 +1,132 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/*********************************************************************************************************************************
+  Pipeline_Insert_ESP32MySQL.ino
+  by Syafiqlim @ syafiqlimx
+
+ **********************************************************************************************************************************/
+/*
+  INSTRUCTIONS FOR USE
+
+  This example inserts the same number of rows at several pipeline depths and prints
+  the statements per second for each, so you can see how much of the round trip time
+  pipelining saves on your network. Depth 1 is the same as one execute() per row.
+
+  1) Change the user and password to a valid MySQL user and password in Credentials.h
+  2) Change the SSID and pass to match your WiFi network in Credentials.h
+  3) Change the server, default DB, default table and default column according to your DB schema
+  4) Connect a USB cable to your ESP32
+  5) Select the correct board and port
+  6) Compile and upload the sketch to your ESP32
+  7) Once uploaded, open Serial Monitor (use 115200 speed) and observe
+
+*/
+
+#include "Credentials.h"
+
+#define ESP32_MYSQL_DEBUG_PORT      Serial
+
+// Debug Level from 0 to 4
+#define _ESP32_MYSQL_LOGLEVEL_      1
+
+#include <ESP32_MySQL.h>
+
+char server[] = "xxxxxx.com"; // change to your server's hostname/URL
+
+uint16_t server_port = 3306;    // MySQL server port (default : 3306)
+
+char default_database[] = "DB0";           //default DB
+char default_table[]    = "TEST0x00";          //default table
+
+char default_column[] = "data0";   //default column
+
+#define STATEMENTS_PER_RUN    64
+
+const uint8_t depths[] = { 1, 2, 4, 8, 16 };
+
+ESP32_MySQL_Connection conn((Client *)&client);
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000); // wait for serial port to connect
+
+  ESP32_MYSQL_DISPLAY1("\nStarting Pipeline_Insert_ESP32MySQL on", ARDUINO_BOARD);
+
+  // Begin WiFi section
+  ESP32_MYSQL_DISPLAY1("Connecting to", ssid);
+  
+  WiFi.begin(ssid, pass);
+  
+  while (WiFi.status() != WL_CONNECTED) 
+  {
+    delay(500);
+    ESP32_MYSQL_DISPLAY0(".");
+  }
+
+  // print out info about the connection:
+  ESP32_MYSQL_DISPLAY1("Connected to network. My IP address is:", WiFi.localIP());
+}
+
+// Insert STATEMENTS_PER_RUN rows, depth statements per round trip
+void runInserts(uint8_t depth)
+{
+  ESP32_MySQL_Pipeline pipeline(&conn);
+  
+  int failed = 0;
+  
+  unsigned long start = millis();
+
+  for (int i = 0; i < STATEMENTS_PER_RUN; i++)
+  {
+    String sql = String("INSERT INTO ") + default_database + "." + default_table 
+               + " (" + default_column + ") VALUES ('depth " + depth + " #" + i + "')";
+
+    pipeline.add(sql.c_str());
+
+    if ( (pipeline.count() >= depth) || (i == STATEMENTS_PER_RUN - 1) )
+    {
+      if (!pipeline.flush())
+      {
+        for (uint8_t s = 0; s < pipeline.count(); s++)
+        {
+          if (pipeline.result(s).status != PIPELINE_OK)
+            failed++;
+        }
+      }
+    }
+  }
+
+  unsigned long elapsed = millis() - start;
+
+  ESP32_MYSQL_DISPLAY5("Depth", depth, ":", (STATEMENTS_PER_RUN * 1000UL) / (elapsed ? elapsed : 1), "statements/s, failed =", failed);
+}
+
+void loop()
+{
+  ESP32_MYSQL_DISPLAY("Connecting...");
+  
+  if (conn.connect(server, server_port, user, password))
+  {
+    for (uint8_t d = 0; d < sizeof(depths); d++)
+      runInserts(depths[d]);
+    
+    conn.close();                     // close the connection
+  } 
+  else 
+  {
+    ESP32_MYSQL_DISPLAY("\nConnect failed. Trying again on next iteration.");
+  }
+
+  ESP32_MYSQL_DISPLAY("\nSleeping...");
+  ESP32_MYSQL_DISPLAY("================================================");
+ 
+  delay(60000);
+}
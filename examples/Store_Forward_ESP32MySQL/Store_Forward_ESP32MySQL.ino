@@ -0,0 +1,135 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/*********************************************************************************************************************************
+  Store_Forward_ESP32MySQL.ino
+  by Syafiqlim @ syafiqlimx
+
+ **********************************************************************************************************************************/
+/*
+  INSTRUCTIONS FOR USE
+
+  This example takes a sample every SAMPLE_INTERVAL_MS. While the server is reachable the
+  samples go straight to an ESP32_MySQL_Insert_Batcher; while it is not (no WiFi, server down)
+  they are appended to an ESP32_MySQL_Store_Queue in LittleFS, which keeps them across resets.
+  Once the connection is back, the queue is drained through the batcher, oldest first, and
+  every 10 seconds the backlog and drain rate are printed. Turn the WiFi access point off for
+  a while to watch it.
+
+  The table needs the columns: sensor INT, value FLOAT, taken BIGINT
+
+  1) Change the user and password to a valid MySQL user and password in Credentials.h
+  2) Change the SSID and pass to match your WiFi network in Credentials.h
+  3) Change the server, default DB and default table according to your DB schema
+  4) Connect a USB cable to your ESP32
+  5) Select the correct board and port, and a partition scheme with a file system
+  6) Compile and upload the sketch to your ESP32
+  7) Once uploaded, open Serial Monitor (use 115200 speed) and observe
+
+*/
+
+#include "Credentials.h"
+
+#define ESP32_MYSQL_DEBUG_PORT      Serial
+
+// Debug Level from 0 to 4
+#define _ESP32_MYSQL_LOGLEVEL_      1
+
+#include <LittleFS.h>
+
+#include <ESP32_MySQL.h>
+
+char server[] = "xxxxxx.com"; // change to your server's hostname/URL
+
+uint16_t server_port = 3306;    // MySQL server port (default : 3306)
+
+char default_database[] = "DB0";           //default DB
+char default_table[]    = "TEST0x00";          //default table
+
+#define SAMPLE_INTERVAL_MS    1000
+#define DRAIN_ROWS            500           // per loop(), so sampling goes on while draining
+
+ESP32_MySQL_Connection conn((Client *)&client);
+
+ESP32_MySQL_Insert_Batcher *batcher;
+
+ESP32_MySQL_Store_Queue queue(LittleFS, "/mysqlq");
+
+unsigned long last_sample   = 0;
+unsigned long last_report   = 0;
+unsigned long last_connect  = 0;
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000); // wait for serial port to connect
+
+  ESP32_MYSQL_DISPLAY1("\nStarting Store_Forward_ESP32MySQL on", ARDUINO_BOARD);
+
+  if (!LittleFS.begin(true) || !queue.begin())
+    ESP32_MYSQL_DISPLAY("Can't open the queue, samples are lost while the server is unreachable");
+
+  ESP32_MYSQL_DISPLAY1("Rows waiting from the last run:", queue.backlog());
+
+  String table = String(default_database) + "." + default_table;
+
+  batcher = new ESP32_MySQL_Insert_Batcher(&conn, table.c_str(), "sensor, value, taken");
+
+  // Begin WiFi section, without waiting: samples are queued meanwhile
+  ESP32_MYSQL_DISPLAY1("Connecting to", ssid);
+
+  WiFi.begin(ssid, pass);
+}
+
+void takeSample()
+{
+  const int     sensor  = 1;
+  const float   value   = temperatureRead();
+  const int64_t taken   = millis();
+
+  // Behind queued rows, or unsent batcher rows, to keep the order
+  if (conn.connected() && queue.empty() && batcher->add_row(sensor, value, taken))
+    return;
+
+  if (!queue.push(sensor, value, taken))
+    ESP32_MYSQL_DISPLAY("Sample lost");
+}
+
+void loop()
+{
+  if ( (WiFi.status() == WL_CONNECTED) && !conn.connected() && (millis() - last_connect >= 10000) )
+  {
+    last_connect = millis();
+
+    ESP32_MYSQL_DISPLAY("Connecting...");
+    conn.connect(server, server_port, user, password);
+  }
+
+  if (millis() - last_sample >= SAMPLE_INTERVAL_MS)
+  {
+    last_sample = millis();
+    takeSample();
+  }
+
+  if (conn.connected())
+  {
+    queue.drain(*batcher, DRAIN_ROWS);
+    batcher->flush_if_due();
+  }
+
+  if (millis() - last_report >= 10000)
+  {
+    last_report = millis();
+
+    const Queue_Stats& stats = queue.stats();
+
+    ESP32_MYSQL_DISPLAY5("Backlog rows:", queue.backlog(), "drain rate rows/s:", stats.drain_rate, "sent:", stats.sent);
+    ESP32_MYSQL_DISPLAY5("Queued:", stats.queued, "dropped:", stats.dropped, "failed:", stats.failed);
+  }
+}
@@ -0,0 +1,142 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/*********************************************************************************************************************************
+  Time_Series_ESP32MySQL.ino
+  by Syafiqlim @ syafiqlimx
+
+ **********************************************************************************************************************************/
+/*
+  INSTRUCTIONS FOR USE
+
+  This example measures how many samples per second an ESP32_MySQL_Time_Series sustains. A
+  producer task pushes CHANNELS samples every PRODUCER_PERIOD_MS into the ring, while the flush
+  task of the series sends them to the server. Every 10 seconds it prints the samples pushed
+  and sent per second, the samples dropped, the highest fill of the ring and the flush time.
+  Lower PRODUCER_PERIOD_MS or raise CHANNELS until samples are dropped to find the limit of
+  your network and server, and try TS_FLUSH_STATEMENT against a MariaDB server.
+
+  The table needs the columns: taken BIGINT, sensor INT, value FLOAT
+
+  1) Change the user and password to a valid MySQL user and password in Credentials.h
+  2) Change the SSID and pass to match your WiFi network in Credentials.h
+  3) Change the server, default DB and default table according to your DB schema
+  4) Connect a USB cable to your ESP32
+  5) Select the correct board and port
+  6) Compile and upload the sketch to your ESP32
+  7) Once uploaded, open Serial Monitor (use 115200 speed) and observe
+
+*/
+
+#include "Credentials.h"
+
+#define ESP32_MYSQL_DEBUG_PORT      Serial
+
+// Debug Level from 0 to 4
+#define _ESP32_MYSQL_LOGLEVEL_      1
+
+#include <ESP32_MySQL.h>
+
+char server[] = "192.168.1.10"; // change to your local server's address
+
+uint16_t server_port = 3306;    // MySQL server port (default : 3306)
+
+char default_database[] = "DB0";           //default DB
+char default_table[]    = "TEST0x00";          //default table
+
+#define CHANNELS              8
+#define PRODUCER_PERIOD_MS    1             // CHANNELS samples each, 8000 samples/s
+#define RING_SAMPLES          4096          // 40 KB
+
+ESP32_MySQL_Connection conn((Client *)&client);
+
+ESP32_MySQL_Time_Series *series;
+
+void producer(void *parameter)
+{
+  TickType_t wake = xTaskGetTickCount();
+  uint32_t n = 0;
+
+  for (;;)
+  {
+    for (uint16_t channel = 0; channel < CHANNELS; channel++)
+      series->push(channel, sinf(n * 0.01f + channel));
+
+    n++;
+    vTaskDelayUntil(&wake, pdMS_TO_TICKS(PRODUCER_PERIOD_MS));
+  }
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000); // wait for serial port to connect
+
+  ESP32_MYSQL_DISPLAY1("\nStarting Time_Series_ESP32MySQL on", ARDUINO_BOARD);
+
+  // Begin WiFi section
+  ESP32_MYSQL_DISPLAY1("Connecting to", ssid);
+
+  WiFi.begin(ssid, pass);
+
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    delay(500);
+    ESP32_MYSQL_DISPLAY0(".");
+  }
+
+  // print out info about the connection:
+  ESP32_MYSQL_DISPLAY1("Connected to network. My IP address is:", WiFi.localIP());
+
+  ESP32_MYSQL_DISPLAY("Connecting...");
+
+  while (!conn.connect(server, server_port, user, password))
+  {
+    ESP32_MYSQL_DISPLAY("Connect failed. Trying again.");
+    delay(5000);
+  }
+
+  // Only the flush task uses the connection from here on; it reconnects
+  // by itself, and the samples wait in the ring meanwhile
+  conn.set_keepalive(30000);
+
+  String table = String(default_database) + "." + default_table;
+
+  series = new ESP32_MySQL_Time_Series(&conn, table.c_str(), "taken, sensor, value", RING_SAMPLES);
+
+  series->set_flush_policy(1000, 500);        // 1000 samples or 500 ms
+  series->set_overflow(TS_DROP_OLDEST);
+  // series->set_flush_mode(TS_FLUSH_STATEMENT);
+
+  // Network on one core, sampling on the other
+  series->start_task(5, 2, 0);
+  xTaskCreatePinnedToCore(producer, "producer", 4096, NULL, 3, NULL, 1);
+}
+
+void loop()
+{
+  static TS_Stats last = { 0 };
+  static unsigned long last_report = millis();
+
+  delay(10000);
+
+  const TS_Stats& stats = series->stats();
+  const unsigned long elapsed = millis() - last_report;
+
+  last_report = millis();
+
+  ESP32_MYSQL_DISPLAY5("Pushed/s:", ((stats.pushed - last.pushed) * 1000UL) / elapsed,
+                       "sent/s:", ((stats.sent - last.sent) * 1000UL) / elapsed,
+                       "waiting:", series->waiting());
+  ESP32_MYSQL_DISPLAY5("Dropped:", stats.dropped_oldest + stats.dropped_newest, "highest fill:", stats.max_waiting,
+                       "of", series->get_capacity());
+  ESP32_MYSQL_DISPLAY5("Flushes:", stats.flushes, "failed:", stats.failed_flushes, "flush ms, max:", stats.max_flush_ms);
+
+  last = stats;
+}
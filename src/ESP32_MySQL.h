@@ -34,5 +34,17 @@
 #include <ESP32_MySQL_Packet_Impl.h>
 #include <ESP32_MySQL_Sha256.h>
 #include <ESP32_MySQL_Aes256_Impl.h>
+#include <ESP32_MySQL_Coroutine_Impl.h>
+#include <ESP32_MySQL_Reactor_Impl.h>
+#include <ESP32_MySQL_Pipeline_Impl.h>
+#include <ESP32_MySQL_Statement_Impl.h>
+#include <ESP32_MySQL_Statement_Cache_Impl.h>
+#include <ESP32_MySQL_Insert_Batcher_Impl.h>
+#include <ESP32_MySQL_Upsert_Buffer_Impl.h>
+#include <ESP32_MySQL_Commit_Group_Impl.h>
+#include <ESP32_MySQL_Store_Queue_Impl.h>
+#include <ESP32_MySQL_Time_Series_Impl.h>
+#include <ESP32_MySQL_Aggregator_Impl.h>
+#include <ESP32_MySQL_Admission_Impl.h>
  
 #endif    //ESP32_MYSQL_H
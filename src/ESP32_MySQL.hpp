@@ -23,5 +23,17 @@
 #include <ESP32_MySQL_Query.h>
 #include <ESP32_MySQL_Encrypt_Sha1.h>
 #include <ESP32_MySQL_Packet.h>
+#include <ESP32_MySQL_Coroutine.h>
+#include <ESP32_MySQL_Reactor.h>
+#include <ESP32_MySQL_Pipeline.h>
+#include <ESP32_MySQL_Statement.h>
+#include <ESP32_MySQL_Statement_Cache.h>
+#include <ESP32_MySQL_Insert_Batcher.h>
+#include <ESP32_MySQL_Upsert_Buffer.h>
+#include <ESP32_MySQL_Commit_Group.h>
+#include <ESP32_MySQL_Store_Queue.h>
+#include <ESP32_MySQL_Time_Series.h>
+#include <ESP32_MySQL_Aggregator.h>
+#include <ESP32_MySQL_Admission.h>
  
 #endif    //ESP32_MYSQL_HPP
@@ -0,0 +1,218 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Admission.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Write admission control
+
+  Keeps a slow server, or a burst of writes from a whole fleet of
+  devices, from piling work up in the application. Writes go to a
+  bounded queue, and leave it at a limited rate:
+
+    ESP32_MySQL_Admission writes(&conn, 20, 10);     // 20 per second, bursts of 10
+
+    writes.set_latency_target(200);                  // slow down above 200 ms
+    writes.submit("INSERT INTO test.events (code) VALUES (7)");
+    writes.service();                                // in loop(), sends what the rate allows
+
+  - Rate limit: a token bucket of burst tokens, refilled at rate per
+    second. Each statement sent takes a token; a statement that finds
+    none waits in the queue, counted once in stats().throttled.
+  - Bounded queue: up to max_queued statements in queue_bytes. When it
+    is full submit() follows the overflow policy: ADMIT_DROP_NEWEST
+    (default) refuses the statement, ADMIT_DROP_OLDEST drops the oldest
+    waiting one, ADMIT_BLOCK waits up to block_ms for room, sending from
+    the queue itself unless another task is in service().
+  - Latency feedback: with a latency target, the rate is halved when
+    the average round trip rises above it, or a statement gets no
+    answer, and grows back by a twentieth of the configured rate a
+    second while it stays below. It never falls under min_rate.
+
+  service() also stops after max_ms: a statement only waits for its
+  answer as long as is left of it, so a slow server holds up loop() for
+  about max_ms. Statements the server rejects are dropped. service()
+  doesn't reconnect; while the connection is down it returns false and
+  the statements wait. A statement without an answer goes back to the
+  front of the queue, so it is sent at least once.
+
+  admit() only takes a token, for writes made another way, e.g. before
+  a batcher flush().
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_ADMISSION_H
+#define ESP32_MYSQL_ADMISSION_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <ESP32_MySQL_Connection.h>
+
+#if defined(ESP32)
+  #include "freertos/FreeRTOS.h"
+#endif
+
+#ifndef ESP32_MYSQL_ADMIT_RATE
+  #define ESP32_MYSQL_ADMIT_RATE          20        // statements per second
+#endif
+
+#ifndef ESP32_MYSQL_ADMIT_BURST
+  #define ESP32_MYSQL_ADMIT_BURST         10        // statements sent at once after a pause
+#endif
+
+#ifndef ESP32_MYSQL_ADMIT_QUEUE
+  #define ESP32_MYSQL_ADMIT_QUEUE         32        // statements waiting
+#endif
+
+#ifndef ESP32_MYSQL_ADMIT_QUEUE_BYTES
+  #define ESP32_MYSQL_ADMIT_QUEUE_BYTES   2048      // of those
+#endif
+
+typedef enum
+{
+  ADMIT_DROP_NEWEST = 0,
+  ADMIT_DROP_OLDEST,
+  ADMIT_BLOCK
+} Admit_Overflow;
+
+typedef struct
+{
+  uint32_t submitted;         // statements queued
+  uint32_t sent;              // answered with Ok
+  uint32_t rejected;          // answered with an error, dropped
+  uint32_t throttled;         // statements held back by the rate limit
+  uint32_t dropped_newest;    // refused with the queue full
+  uint32_t dropped_oldest;    // dropped to make room
+  uint32_t blocked;           // submit() calls that waited for room
+  uint32_t admitted;          // admit() calls given a token
+  uint32_t refused;           // admit() calls without one
+  uint32_t slowdowns;         // rate halved by the latency feedback
+  uint32_t avg_latency_ms;    // moving average of the round trip
+  uint32_t max_latency_ms;
+} Admission_Stats;
+
+class ESP32_MySQL_Admission
+{
+  public:
+    ESP32_MySQL_Admission(ESP32_MySQL_Connection *connection,
+                          const float& rate = ESP32_MYSQL_ADMIT_RATE,
+                          const uint16_t& burst = ESP32_MYSQL_ADMIT_BURST,
+                          const uint16_t& max_queued = ESP32_MYSQL_ADMIT_QUEUE,
+                          const size_t& queue_bytes = ESP32_MYSQL_ADMIT_QUEUE_BYTES);
+    ~ESP32_MySQL_Admission();
+
+    bool submit(const char *sql);
+    bool service(const uint32_t& max_ms = 100);
+    bool admit();
+
+    void set_overflow(const Admit_Overflow& policy, const uint32_t& block_ms = 0)
+    {
+      overflow        = policy;
+      this->block_ms  = block_ms;
+    }
+
+    // Slow down above target_ms of round trip, to min_rate at most; 0 = off
+    void set_latency_target(const uint32_t& target_ms, const float& min_rate = 1)
+    {
+      latency_target_ms = target_ms;
+      this->min_rate    = (min_rate > max_rate) ? max_rate : min_rate;
+    }
+
+    // Statements waiting
+    uint16_t queued();
+
+    // Statements per second allowed now
+    float current_rate() const
+    {
+      return rate;
+    }
+
+    const Admission_Stats& stats() const
+    {
+      return admit_stats;
+    }
+
+    void reset_stats()
+    {
+      memset(&admit_stats, 0, sizeof(admit_stats));
+    }
+
+    ESP32_MySQL_Connection *connection()
+    {
+      return conn;
+    }
+
+  private:
+    bool  take_token();
+    void  refill();
+    void  measured(const uint32_t& latency_ms, const bool& answered);
+    size_t entry_length(size_t pos) const;
+    void  copy_in(const size_t& pos, const char *from, const size_t& length);
+    void  copy_out(const size_t& pos, char *to, const size_t& length) const;
+    bool  pop(char *sql);
+    bool  requeue(const char *sql);
+    void  drop_oldest();
+
+    void lock()
+    {
+#if defined(ESP32)
+      portENTER_CRITICAL(&mux);
+#endif
+    }
+
+    void unlock()
+    {
+#if defined(ESP32)
+      portEXIT_CRITICAL(&mux);
+#endif
+    }
+
+#if defined(ESP32)
+    portMUX_TYPE  mux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+    ESP32_MySQL_Connection *conn;
+
+    // Ring of statements waiting, each ending with '\0', the oldest at
+    // queue_head; short copies only under the lock, nothing is moved
+    char      *queue;
+    size_t    queue_size;
+    size_t    queue_head;
+    size_t    queue_len;
+    uint16_t  num_queued;
+    uint16_t  max_queued;
+    bool      front_throttled;    // the oldest was counted in throttled
+
+    // The statement being sent, out of the queue
+    char      *sending;
+    volatile bool servicing;
+
+    Admit_Overflow  overflow;
+    uint32_t  block_ms;
+
+    // Token bucket
+    float     rate;
+    float     max_rate;
+    float     min_rate;
+    float     tokens;
+    uint16_t  burst;
+    uint32_t  last_refill_ms;
+
+    // Latency feedback
+    uint32_t  latency_target_ms;
+    uint32_t  last_adjust_ms;
+
+    Admission_Stats admit_stats;
+};
+
+#endif    // ESP32_MYSQL_ADMISSION_H
@@ -0,0 +1,475 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Admission_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_ADMISSION_IMPL_H
+#define ESP32_MYSQL_ADMISSION_IMPL_H
+
+#include <ESP32_MySQL_Admission.h>
+
+/*
+  ESP32_MySQL_Admission
+
+  rate[in]          (optional) statements per second
+  burst[in]         (optional) statements sent at once after a pause
+  max_queued[in]    (optional) statements waiting
+  queue_bytes[in]   (optional) size of the queue, allocated here; also
+                    the longest statement
+*/
+ESP32_MySQL_Admission::ESP32_MySQL_Admission(ESP32_MySQL_Connection *connection, const float& rate,
+                                             const uint16_t& burst, const uint16_t& max_queued,
+                                             const size_t& queue_bytes)
+{
+  conn                = connection;
+  queue_size          = queue_bytes;
+  queue_head          = 0;
+  queue_len           = 0;
+  num_queued          = 0;
+  this->max_queued    = (max_queued == 0) ? 1 : max_queued;
+  front_throttled     = false;
+  servicing           = false;
+  overflow            = ADMIT_DROP_NEWEST;
+  block_ms            = 0;
+  max_rate            = (rate > 0) ? rate : 1;
+  this->rate          = max_rate;
+  min_rate            = (max_rate < 1) ? max_rate : 1;
+  this->burst         = (burst == 0) ? 1 : burst;
+  tokens              = this->burst;
+  last_refill_ms      = millis();
+  latency_target_ms   = 0;
+  last_adjust_ms      = millis();
+
+  memset(&admit_stats, 0, sizeof(admit_stats));
+
+  queue   = (char *) malloc(queue_size);
+  sending = (char *) malloc(queue_size);
+
+  if (!queue || !sending)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Admission: out of memory");
+
+    free(queue);
+    free(sending);
+    queue       = NULL;
+    sending     = NULL;
+    queue_size  = 0;
+  }
+}
+
+ESP32_MySQL_Admission::~ESP32_MySQL_Admission()
+{
+  if (num_queued > 0)
+    ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Admission: statements not sent =", num_queued);
+
+  free(queue);
+  free(sending);
+}
+
+/*
+  submit - queue a statement answered by an Ok packet, e.g. an INSERT
+
+  sql[in]         the statement, copied
+
+  Returns bool - True = queued; false = queue full (ADMIT_DROP_NEWEST, or
+                 ADMIT_BLOCK without room in time) or statement larger
+                 than the queue
+*/
+bool ESP32_MySQL_Admission::submit(const char *sql)
+{
+  const size_t length = strlen(sql) + 1;
+
+  if (length > queue_size)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Admission: statement larger than the queue");
+
+    lock();
+    admit_stats.dropped_newest++;
+    unlock();
+
+    return false;
+  }
+
+  const uint32_t start = millis();
+  bool waited = false;
+
+  for (;;)
+  {
+    lock();
+
+    if ( (num_queued < max_queued) && (queue_len + length <= queue_size) )
+    {
+      copy_in((queue_head + queue_len) % queue_size, sql, length);
+      queue_len += length;
+      num_queued++;
+      admit_stats.submitted++;
+      unlock();
+
+      return true;
+    }
+
+    if (overflow == ADMIT_DROP_OLDEST)
+    {
+      drop_oldest();
+      admit_stats.dropped_oldest++;
+      unlock();
+
+      continue;
+    }
+
+    if ( (overflow == ADMIT_BLOCK) && (!waited || ((uint32_t) (millis() - start) < block_ms)) )
+    {
+      if (!waited)
+        admit_stats.blocked++;
+
+      unlock();
+      waited = true;
+
+      // Make room ourselves, unless another task is at it
+      if (!servicing)
+        service(block_ms);
+
+      if (block_ms > 0)
+        delay(1);
+
+      continue;
+    }
+
+    admit_stats.dropped_newest++;
+    unlock();
+
+    return false;
+  }
+}
+
+/*
+  service - send queued statements, as far as the rate allows
+
+  Call it from loop(), or a task of its own. Each statement may wait for
+  its answer only as long as is left of max_ms, so the call returns in
+  about max_ms even with a server that stopped answering. A statement is
+  not started when less than its average round trip is left. It doesn't
+  reconnect: with the connection down it returns false at once, and the
+  caller reconnects, e.g. with keepalive(), outside of the time budget.
+
+  max_ms[in]      (optional) stop sending after that long, 0 = no limit
+
+  Returns bool - False = connection down or busy, the statements wait
+*/
+bool ESP32_MySQL_Admission::service(const uint32_t& max_ms)
+{
+  lock();
+
+  const bool busy = servicing;
+
+  servicing = true;
+  unlock();
+
+  if (busy)
+    return true;
+
+  const uint32_t start = millis();
+  bool ok = true;
+  bool first = true;
+
+  while ( (max_ms == 0) || ((uint32_t) (millis() - start) < max_ms) )
+  {
+    lock();
+
+    if (num_queued == 0)
+    {
+      unlock();
+      break;
+    }
+
+    if (!take_token())
+    {
+      if (!front_throttled)
+      {
+        front_throttled = true;
+        admit_stats.throttled++;
+      }
+
+      unlock();
+      break;
+    }
+
+    unlock();
+
+    // Time left for this statement's answer
+    uint32_t timeout_ms = 0;
+
+    if (max_ms > 0)
+    {
+      const uint32_t spent = millis() - start;
+
+      timeout_ms = (spent < max_ms) ? max_ms - spent : 1;
+
+      if ( !first && (timeout_ms < admit_stats.avg_latency_ms) )
+      {
+        // Not likely to be answered in time: the token was not used
+        lock();
+        tokens += 1;
+        unlock();
+
+        break;
+      }
+    }
+
+    ESP32_MySQL_Lock_Guard guard(conn);
+
+    if ( !guard.owns_lock() || !conn->connected() )
+    {
+      ESP32_MYSQL_LOGERROR(NOT_CONNECTED);
+
+      // The token was not used
+      lock();
+      tokens += 1;
+      unlock();
+
+      ok = false;
+      break;
+    }
+
+    lock();
+    pop(sending);
+    unlock();
+
+    first = false;
+
+    const uint32_t saved_timeout = conn->get_data_timeout();
+
+    if (timeout_ms > 0)
+      conn->set_data_timeout(timeout_ms);
+
+    const uint32_t sent_ms = millis();
+    const bool inserted = conn->query_ok(sending);
+    const uint32_t latency = millis() - sent_ms;
+
+    conn->set_data_timeout(saved_timeout);
+
+    if (inserted)
+    {
+      admit_stats.sent++;
+    }
+    else if (conn->connected())
+    {
+      admit_stats.rejected++;
+    }
+    else
+    {
+      // No answer in time, query_ok() closed the connection: try again later
+      lock();
+
+      if (!requeue(sending))
+        admit_stats.dropped_oldest++;
+
+      unlock();
+      ok = false;
+    }
+
+    measured(latency, inserted || conn->connected());
+
+    if (!ok)
+      break;
+  }
+
+  servicing = false;
+
+  return ok;
+}
+
+/*
+  admit - take a token for a write made without submit()
+
+  Returns bool - True = within the rate; false = write now and it is
+                 over the rate
+*/
+bool ESP32_MySQL_Admission::admit()
+{
+  lock();
+
+  const bool ok = take_token();
+
+  if (ok)
+    admit_stats.admitted++;
+  else
+    admit_stats.refused++;
+
+  unlock();
+
+  return ok;
+}
+
+uint16_t ESP32_MySQL_Admission::queued()
+{
+  lock();
+
+  const uint16_t count = num_queued;
+
+  unlock();
+
+  return count;
+}
+
+// Called locked
+bool ESP32_MySQL_Admission::take_token()
+{
+  refill();
+
+  if (tokens < 1)
+    return false;
+
+  tokens -= 1;
+
+  return true;
+}
+
+// Tokens for the time since the last refill, up to burst
+void ESP32_MySQL_Admission::refill()
+{
+  const uint32_t now = millis();
+
+  tokens += (now - last_refill_ms) * rate / 1000;
+
+  if (tokens > burst)
+    tokens = burst;
+
+  last_refill_ms = now;
+}
+
+/*
+  measured - adjust the rate to the round trip of a statement
+
+  Halves the rate when the average is above the target, or there was no
+  answer, at most once per target_ms so a single slow burst counts once.
+  Otherwise adds a twentieth of the configured rate each second.
+
+  latency_ms[in]  round trip of the statement
+  answered[in]    False = connection lost on the way
+*/
+void ESP32_MySQL_Admission::measured(const uint32_t& latency_ms, const bool& answered)
+{
+  if (admit_stats.avg_latency_ms == 0)
+    admit_stats.avg_latency_ms = latency_ms;
+  else
+    admit_stats.avg_latency_ms += ((int32_t) latency_ms - (int32_t) admit_stats.avg_latency_ms) / 8;
+
+  if (latency_ms > admit_stats.max_latency_ms)
+    admit_stats.max_latency_ms = latency_ms;
+
+  if (latency_target_ms == 0)
+    return;
+
+  const uint32_t now = millis();
+  const uint32_t since = now - last_adjust_ms;
+
+  if ( !answered || (admit_stats.avg_latency_ms > latency_target_ms) )
+  {
+    if (since >= latency_target_ms)
+    {
+      rate            = (rate / 2 > min_rate) ? rate / 2 : min_rate;
+      last_adjust_ms  = now;
+
+      admit_stats.slowdowns++;
+      ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Admission: slower, per second =", rate);
+    }
+  }
+  else if ( (rate < max_rate) && (since >= 1000) )
+  {
+    rate            = (rate + max_rate / 20 < max_rate) ? rate + max_rate / 20 : max_rate;
+    last_adjust_ms  = now;
+  }
+}
+
+// Length with the '\0' of the statement at pos, which may wrap around
+size_t ESP32_MySQL_Admission::entry_length(size_t pos) const
+{
+  size_t length = 1;
+
+  while (queue[pos] != 0)
+  {
+    pos = (pos + 1) % queue_size;
+    length++;
+  }
+
+  return length;
+}
+
+// Copies length bytes to the queue at pos, wrapping around its end
+void ESP32_MySQL_Admission::copy_in(const size_t& pos, const char *from, const size_t& length)
+{
+  const size_t first = (length < queue_size - pos) ? length : queue_size - pos;
+
+  memcpy(&queue[pos], from, first);
+  memcpy(queue, &from[first], length - first);
+}
+
+// Copies length bytes from the queue at pos, wrapping around its end
+void ESP32_MySQL_Admission::copy_out(const size_t& pos, char *to, const size_t& length) const
+{
+  const size_t first = (length < queue_size - pos) ? length : queue_size - pos;
+
+  memcpy(to, &queue[pos], first);
+  memcpy(&to[first], queue, length - first);
+}
+
+// Moves the oldest statement to sql; called locked
+bool ESP32_MySQL_Admission::pop(char *sql)
+{
+  if (num_queued == 0)
+    return false;
+
+  const size_t length = entry_length(queue_head);
+
+  copy_out(queue_head, sql, length);
+
+  queue_head       = (queue_head + length) % queue_size;
+  queue_len       -= length;
+  num_queued--;
+  front_throttled  = false;
+
+  return true;
+}
+
+// Puts sql back in front of the queue; called locked
+bool ESP32_MySQL_Admission::requeue(const char *sql)
+{
+  const size_t length = strlen(sql) + 1;
+
+  if ( (num_queued >= max_queued) || (queue_len + length > queue_size) )
+    return false;
+
+  queue_head = (queue_head + queue_size - length) % queue_size;
+
+  copy_in(queue_head, sql, length);
+
+  queue_len += length;
+  num_queued++;
+
+  return true;
+}
+
+// Called locked
+void ESP32_MySQL_Admission::drop_oldest()
+{
+  const size_t length = entry_length(queue_head);
+
+  queue_head       = (queue_head + length) % queue_size;
+  queue_len       -= length;
+  num_queued--;
+  front_throttled  = false;
+}
+
+#endif    // ESP32_MYSQL_ADMISSION_IMPL_H
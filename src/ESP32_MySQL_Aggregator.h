@@ -0,0 +1,184 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Aggregator.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Windowed pre-aggregation
+
+  Where a table only needs the min, max, average or last value of each
+  minute, the raw samples are reduced on the device, and a single row
+  per window and series goes to the INSERT batcher:
+
+    ESP32_MySQL_Insert_Batcher  batcher(&conn, "test.minutes", "start, sensor, min_v, max_v, avg_v");
+    ESP32_MySQL_Aggregator      minutes(batcher, AGG_MIN | AGG_MAX | AGG_AVG, 60000);
+
+    minutes.add(sensor, value);       // every sample
+    minutes.flush_if_due();           // in loop(), closes windows without new samples
+
+  A row holds the start of the window, the series, then the aggregates
+  asked for in this order: AGG_MIN, AGG_MAX, AGG_AVG, AGG_FIRST,
+  AGG_LAST, AGG_SUM, AGG_COUNT. The batcher needs a column for each.
+
+  Times are millis() unless given to add(); any unit works, e.g. epoch
+  seconds, as long as window and hop use it too.
+
+  - Tumbling windows (hop 0): back to back, each window_ms long, starting
+    at multiples of window_ms.
+  - Sliding windows: window_ms long, one every hop_ms. Each window is
+    kept as window_ms / hop_ms panes of hop_ms, so a sample is added
+    once whatever the overlap. Windows starting before the first sample
+    of a series, or before a gap in it, are not sent: later windows hold
+    all of their samples.
+
+  A window is sent once a sample of its series falls after it, or at
+  flush_if_due() once its end has passed. Windows without samples are
+  not sent. A sample older than the open pane of its series is dropped,
+  counted in stats().late.
+
+  With set_dead_band() a window is only sent when one of its values
+  (every aggregate but AGG_SUM and AGG_COUNT) moved more than the dead
+  band since the last row of its series, or max_windows windows were
+  held back: a slowly varying signal costs a row now and then.
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_AGGREGATOR_H
+#define ESP32_MYSQL_AGGREGATOR_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <ESP32_MySQL_Insert_Batcher.h>
+
+#ifndef ESP32_MYSQL_AGG_SERIES
+  #define ESP32_MYSQL_AGG_SERIES        16        // series aggregated at once
+#endif
+
+#ifndef ESP32_MYSQL_AGG_PANES
+  #define ESP32_MYSQL_AGG_PANES         60        // most panes of a sliding window
+#endif
+
+// Aggregates of a window, in the order of their columns
+#define AGG_MIN                         0x01
+#define AGG_MAX                         0x02
+#define AGG_AVG                         0x04
+#define AGG_FIRST                       0x08
+#define AGG_LAST                        0x10
+#define AGG_SUM                         0x20
+#define AGG_COUNT                       0x40
+
+#define ESP32_MYSQL_AGG_KINDS           7
+
+// Samples of one hop_ms
+typedef struct
+{
+  uint32_t  count;
+  float     min;
+  float     max;
+  float     first;
+  float     last;
+  double    sum;
+} Agg_Pane;
+
+typedef struct
+{
+  uint32_t samples;           // add() calls taken
+  uint32_t late;              // samples older than the open pane, dropped
+  uint32_t refused;           // samples of a new series with the table full
+  uint32_t windows;           // rows given to the batcher
+  uint32_t suppressed;        // windows held back by the dead band
+  uint32_t failed;            // rows the batcher refused
+} Agg_Stats;
+
+class ESP32_MySQL_Aggregator
+{
+  public:
+    ESP32_MySQL_Aggregator(ESP32_MySQL_Insert_Batcher& batcher, const uint8_t& aggregates,
+                           const uint32_t& window_ms, const uint32_t& hop_ms = 0,
+                           const uint16_t& max_series = ESP32_MYSQL_AGG_SERIES);
+    ~ESP32_MySQL_Aggregator();
+
+    bool add(const uint16_t& series, const float& value);
+    bool add(const uint16_t& series, const float& value, const uint32_t& time);
+
+    // Send only windows that moved more than dead_band; 0 = send all
+    void set_dead_band(const float& dead_band, const uint16_t& max_windows = 0)
+    {
+      this->dead_band   = dead_band;
+      this->max_windows = max_windows;
+    }
+
+    bool flush_if_due();
+    bool flush_if_due(const uint32_t& time);
+    bool flush();
+
+    // Series seen, each holding a slot until destroyed
+    uint16_t active_series() const
+    {
+      return num_series;
+    }
+
+    const Agg_Stats& stats() const
+    {
+      return agg_stats;
+    }
+
+    void reset_stats()
+    {
+      memset(&agg_stats, 0, sizeof(agg_stats));
+    }
+
+  private:
+    // State of one series
+    typedef struct
+    {
+      uint16_t  id;
+      uint8_t   pane;                   // open pane
+      uint32_t  pane_start;             // start time of the open pane
+      uint32_t  first_start;            // of the first pane since a gap
+      float     sent[ESP32_MYSQL_AGG_KINDS];  // values of the last row, for the dead band
+      bool      has_sent;
+      uint16_t  held_back;              // windows suppressed since that row
+      Agg_Pane  *panes;                 // num_panes, a ring
+    } Agg_Series;
+
+    Agg_Series  *find_series(const uint16_t& id, const uint32_t& time);
+    bool        advance(Agg_Series *s, const uint32_t& time);
+    bool        close_pane(Agg_Series *s);
+    bool        emit(Agg_Series *s, const uint32_t& end);
+    bool        within_dead_band(const Agg_Series *s, const float *values);
+
+    static void clear_pane(Agg_Pane *pane)
+    {
+      memset(pane, 0, sizeof(Agg_Pane));
+    }
+
+    ESP32_MySQL_Insert_Batcher *batcher;
+
+    uint8_t     aggregates;
+    uint32_t    window_ms;
+    uint32_t    hop_ms;
+    uint8_t     num_panes;
+
+    Agg_Series  *series;
+    Agg_Pane    *panes;                 // max_series * num_panes
+    uint16_t    num_series;
+    uint16_t    max_series;
+
+    float       dead_band;
+    uint16_t    max_windows;
+
+    Agg_Stats   agg_stats;
+};
+
+#endif    // ESP32_MYSQL_AGGREGATOR_H
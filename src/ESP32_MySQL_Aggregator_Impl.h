@@ -0,0 +1,431 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Aggregator_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_AGGREGATOR_IMPL_H
+#define ESP32_MYSQL_AGGREGATOR_IMPL_H
+
+#include <math.h>
+
+#include <ESP32_MySQL_Aggregator.h>
+
+/*
+  ESP32_MySQL_Aggregator
+
+  batcher[in]     batcher of the table the rows are for: start, series,
+                  then a column per aggregate
+  aggregates[in]  AGG_MIN, AGG_MAX, AGG_AVG, AGG_FIRST, AGG_LAST,
+                  AGG_SUM and AGG_COUNT, or-ed together
+  window_ms[in]   length of a window
+  hop_ms[in]      (optional) time between sliding windows, 0 = tumbling
+  max_series[in]  (optional) series aggregated at once
+*/
+ESP32_MySQL_Aggregator::ESP32_MySQL_Aggregator(ESP32_MySQL_Insert_Batcher& batcher, const uint8_t& aggregates,
+                                               const uint32_t& window_ms, const uint32_t& hop_ms,
+                                               const uint16_t& max_series)
+{
+  this->batcher     = &batcher;
+  this->aggregates  = aggregates;
+  this->window_ms   = (window_ms == 0) ? 1 : window_ms;
+  this->hop_ms      = ( (hop_ms == 0) || (hop_ms > this->window_ms) ) ? this->window_ms : hop_ms;
+  this->max_series  = (max_series == 0) ? 1 : max_series;
+  num_series        = 0;
+  dead_band         = 0;
+  max_windows       = 0;
+
+  memset(&agg_stats, 0, sizeof(agg_stats));
+
+  // A window is a whole number of panes
+  uint32_t count = (this->window_ms + this->hop_ms - 1) / this->hop_ms;
+
+  if (count > ESP32_MYSQL_AGG_PANES)
+    count = ESP32_MYSQL_AGG_PANES;
+
+  num_panes = (uint8_t) count;
+
+  if (this->window_ms != num_panes * this->hop_ms)
+  {
+    this->window_ms = num_panes * this->hop_ms;
+    ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Aggregator: window changed to", this->window_ms);
+  }
+
+  series  = (Agg_Series *) malloc(this->max_series * sizeof(Agg_Series));
+  panes   = (Agg_Pane *) malloc(this->max_series * num_panes * sizeof(Agg_Pane));
+
+  if (!series || !panes)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Aggregator: out of memory");
+
+    free(series);
+    free(panes);
+    series            = NULL;
+    panes             = NULL;
+    this->max_series  = 0;
+  }
+}
+
+ESP32_MySQL_Aggregator::~ESP32_MySQL_Aggregator()
+{
+  free(series);
+  free(panes);
+}
+
+/*
+  add - add a sample taken now to its window
+
+  series[in]      sensor or series number, the second column of its rows
+  value[in]       the reading
+
+  Returns bool - False = sample dropped: older than the open pane of its
+                 series, or a new series with max_series of them already
+*/
+bool ESP32_MySQL_Aggregator::add(const uint16_t& series, const float& value)
+{
+  return add(series, value, (uint32_t) millis());
+}
+
+// add() with the time the sample was taken
+bool ESP32_MySQL_Aggregator::add(const uint16_t& series, const float& value, const uint32_t& time)
+{
+  agg_stats.samples++;
+
+  Agg_Series *s = find_series(series, time);
+
+  if (!s)
+  {
+    agg_stats.refused++;
+    return false;
+  }
+
+  if ((int32_t) (time - s->pane_start) < 0)
+  {
+    agg_stats.late++;
+    return false;
+  }
+
+  advance(s, time);
+
+  Agg_Pane& pane = s->panes[s->pane];
+
+  if (pane.count == 0)
+  {
+    pane.min    = value;
+    pane.max    = value;
+    pane.first  = value;
+  }
+  else if (value < pane.min)
+  {
+    pane.min = value;
+  }
+  else if (value > pane.max)
+  {
+    pane.max = value;
+  }
+
+  pane.last = value;
+  pane.sum += value;
+  pane.count++;
+
+  return true;
+}
+
+/*
+  flush_if_due - send the windows that have ended
+
+  Call it from loop(), so windows of series without new samples are
+  sent too.
+
+  time[in]        (optional) now, in the unit of add(); millis() by default
+
+  Returns bool - False = the batcher refused a row
+*/
+bool ESP32_MySQL_Aggregator::flush_if_due()
+{
+  return flush_if_due((uint32_t) millis());
+}
+
+bool ESP32_MySQL_Aggregator::flush_if_due(const uint32_t& time)
+{
+  bool ok = true;
+
+  for (uint16_t i = 0; i < num_series; i++)
+  {
+    if (!advance(&series[i], time))
+      ok = false;
+  }
+
+  return ok;
+}
+
+/*
+  flush - send the open windows as they are, e.g. before a deep sleep
+
+  The rows go to the server with the batcher flush at the end. Samples
+  added later in the same window go in a second row for it. A sliding
+  window still filling up starts at its first sample.
+
+  Returns bool - False = the batcher refused a row, or the INSERT failed
+*/
+bool ESP32_MySQL_Aggregator::flush()
+{
+  bool ok = true;
+
+  for (uint16_t i = 0; i < num_series; i++)
+  {
+    Agg_Series *s = &series[i];
+
+    if (!emit(s, s->pane_start + hop_ms))
+      ok = false;
+
+    for (uint8_t p = 0; p < num_panes; p++)
+      clear_pane(&s->panes[p]);
+  }
+
+  if (!batcher->flush())
+    ok = false;
+
+  return ok;
+}
+
+// The state of series id, added at time if new
+ESP32_MySQL_Aggregator::Agg_Series *ESP32_MySQL_Aggregator::find_series(const uint16_t& id, const uint32_t& time)
+{
+  for (uint16_t i = 0; i < num_series; i++)
+  {
+    if (series[i].id == id)
+      return &series[i];
+  }
+
+  if (num_series >= max_series)
+  {
+    ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Aggregator: series table full, series =", id);
+    return NULL;
+  }
+
+  Agg_Series *s = &series[num_series];
+
+  memset(s, 0, sizeof(Agg_Series));
+
+  s->id           = id;
+  s->pane_start   = time - time % hop_ms;
+  s->first_start  = s->pane_start;
+  s->panes      = &panes[num_series * num_panes];
+
+  for (uint8_t p = 0; p < num_panes; p++)
+    clear_pane(&s->panes[p]);
+
+  num_series++;
+
+  return s;
+}
+
+/*
+  advance - close the panes of s that end at or before time
+
+  After a gap with no samples in the window, jumps straight to the pane
+  of time.
+
+  Returns bool - False = the batcher refused a row
+*/
+bool ESP32_MySQL_Aggregator::advance(Agg_Series *s, const uint32_t& time)
+{
+  bool ok = true;
+
+  while ((int32_t) (time - (s->pane_start + hop_ms)) >= 0)
+  {
+    bool empty = true;
+
+    for (uint8_t p = 0; (p < num_panes) && empty; p++)
+      empty = (s->panes[p].count == 0);
+
+    if (empty)
+    {
+      s->pane_start   = time - time % hop_ms;
+      s->first_start  = s->pane_start;
+      break;
+    }
+
+    if (!close_pane(s))
+      ok = false;
+  }
+
+  return ok;
+}
+
+// Sends the window ending with the open pane, and opens the next
+bool ESP32_MySQL_Aggregator::close_pane(Agg_Series *s)
+{
+  const uint32_t end = s->pane_start + hop_ms;
+  bool ok = true;
+
+  // A sliding window still filling up
+  if ((int32_t) (end - window_ms - s->first_start) >= 0)
+    ok = emit(s, end);
+
+  s->pane = (s->pane + 1) % num_panes;
+  s->pane_start += hop_ms;
+
+  clear_pane(&s->panes[s->pane]);
+
+  return ok;
+}
+
+/*
+  emit - the window of s ending at end, as a row of the batcher
+
+  Nothing for a window without samples, or one within the dead band.
+
+  Returns bool - False = the batcher refused the row
+*/
+bool ESP32_MySQL_Aggregator::emit(Agg_Series *s, const uint32_t& end)
+{
+  Agg_Pane window;
+
+  clear_pane(&window);
+
+  // Oldest pane first, the open one last
+  for (uint8_t i = 1; i <= num_panes; i++)
+  {
+    const Agg_Pane& pane = s->panes[(s->pane + i) % num_panes];
+
+    if (pane.count == 0)
+      continue;
+
+    if (window.count == 0)
+    {
+      window.min    = pane.min;
+      window.max    = pane.max;
+      window.first  = pane.first;
+    }
+    else
+    {
+      window.min = (pane.min < window.min) ? pane.min : window.min;
+      window.max = (pane.max > window.max) ? pane.max : window.max;
+    }
+
+    window.last   = pane.last;
+    window.sum   += pane.sum;
+    window.count += pane.count;
+  }
+
+  if (window.count == 0)
+    return true;
+
+  // In the order of the AGG_ bits
+  const float values[ESP32_MYSQL_AGG_KINDS] =
+  {
+    window.min, window.max, (float) (window.sum / window.count), window.first, window.last,
+    (float) window.sum, (float) window.count
+  };
+
+  if (within_dead_band(s, values))
+  {
+    s->held_back++;
+    agg_stats.suppressed++;
+
+    return true;
+  }
+
+  Batcher_Value row[2 + ESP32_MYSQL_AGG_KINDS];
+  uint16_t count = 0;
+
+  memset(row, 0, sizeof(row));
+
+  row[count].type         = MYSQL_TYPE_LONGLONG;
+  row[count].is_unsigned  = true;
+  row[count++].value.u    = ((int32_t) (end - window_ms - s->first_start) < 0) ? s->first_start : end - window_ms;
+
+  row[count].type         = MYSQL_TYPE_LONGLONG;
+  row[count].is_unsigned  = true;
+  row[count++].value.u    = s->id;
+
+  for (uint8_t k = 0; k < ESP32_MYSQL_AGG_KINDS; k++)
+  {
+    const uint8_t bit = 1 << k;
+
+    if (!(aggregates & bit))
+      continue;
+
+    if (bit == AGG_COUNT)
+    {
+      row[count].type         = MYSQL_TYPE_LONGLONG;
+      row[count].is_unsigned  = true;
+      row[count].value.u      = window.count;
+    }
+    else if (bit == AGG_AVG)
+    {
+      row[count].type         = MYSQL_TYPE_DOUBLE;
+      row[count].value.d      = window.sum / window.count;
+    }
+    else if (bit == AGG_SUM)
+    {
+      row[count].type         = MYSQL_TYPE_DOUBLE;
+      row[count].value.d      = window.sum;
+    }
+    else
+    {
+      row[count].type         = MYSQL_TYPE_FLOAT;
+      row[count].value.d      = values[k];
+    }
+
+    count++;
+  }
+
+  if (!batcher->add_values(row, count))
+  {
+    agg_stats.failed++;
+    return false;
+  }
+
+  // The dead band compares with rows the batcher took
+  memcpy(s->sent, values, sizeof(values));
+  s->has_sent   = true;
+  s->held_back  = 0;
+
+  agg_stats.windows++;
+
+  return true;
+}
+
+/*
+  within_dead_band - no value of the window moved more than dead_band
+                     since the last row of s
+
+  AGG_SUM and AGG_COUNT grow with the sample rate, so they are left out.
+*/
+bool ESP32_MySQL_Aggregator::within_dead_band(const Agg_Series *s, const float *values)
+{
+  if ( (dead_band <= 0) || !s->has_sent || ((max_windows > 0) && (s->held_back >= max_windows)) )
+    return false;
+
+  bool compared = false;
+
+  for (uint8_t k = 0; k < ESP32_MYSQL_AGG_KINDS; k++)
+  {
+    const uint8_t bit = 1 << k;
+
+    if ( !(aggregates & bit) || (bit == AGG_SUM) || (bit == AGG_COUNT) )
+      continue;
+
+    if (fabsf(values[k] - s->sent[k]) > dead_band)
+      return false;
+
+    compared = true;
+  }
+
+  return compared;
+}
+
+#endif    // ESP32_MYSQL_AGGREGATOR_IMPL_H
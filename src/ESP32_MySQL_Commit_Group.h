@@ -0,0 +1,149 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Commit_Group.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Grouped commits
+
+  With autocommit every write is its own transaction, and the server
+  flushes its log to disk once per statement. A commit group runs the
+  writes in transactions of up to max_statements statements or
+  max_age_ms milliseconds, so that flush is shared:
+
+    ESP32_MySQL_Commit_Group group(&conn, 50, 1000);
+
+    group.execute("INSERT INTO test.readings (sensor, value) VALUES (1, 21.5)");   // begins a transaction
+    ...                                                                         // commits at 50
+    group.commit_if_due();                                                      // in loop(): commits at 1 s
+
+  Only statements that don't return rows. Each statement runs at once,
+  and is also kept in a log of log_bytes until the commit, so the group
+  can be run again:
+
+  - Statement rejected by the server: execute() returns false and the
+    statement is dropped. The transaction is rolled back and the earlier
+    statements are replayed in a new one, as some errors (a deadlock, a
+    lock wait timeout) roll back more than the statement.
+  - Connection lost before COMMIT: the server has rolled the transaction
+    back. The group reconnects and replays the log. While that fails the
+    statements wait, and execute() returns false once the log is full.
+  - No answer to COMMIT: the server may or may not have committed. The
+    group is not replayed, as that could apply it twice; it is dropped
+    and counted in stats().uncertain.
+
+  A statement larger than log_bytes commits the group and runs alone
+  with autocommit. The group's transaction holds the connection: other
+  users of it would run inside the transaction, so give the group a
+  connection of its own. Call commit() or rollback() before destroying
+  the group; the destructor rolls back what is left.
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_COMMIT_GROUP_H
+#define ESP32_MYSQL_COMMIT_GROUP_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <ESP32_MySQL_Connection.h>
+
+#ifndef ESP32_MYSQL_GROUP_STATEMENTS
+  #define ESP32_MYSQL_GROUP_STATEMENTS    50        // statements per transaction
+#endif
+
+#ifndef ESP32_MYSQL_GROUP_AGE_MS
+  #define ESP32_MYSQL_GROUP_AGE_MS        1000      // longest open transaction
+#endif
+
+#ifndef ESP32_MYSQL_GROUP_LOG_BYTES
+  #define ESP32_MYSQL_GROUP_LOG_BYTES     4096      // statements kept for replay
+#endif
+
+typedef enum
+{
+  GROUP_OK = 0,
+  GROUP_REJECTED,             // error packet
+  GROUP_NO_ANSWER             // connection closed
+} Group_Result;
+
+typedef struct
+{
+  uint32_t commits;           // transactions committed
+  uint32_t statements;        // statements in those
+  uint32_t rejected;          // statements dropped with an error packet
+  uint32_t replays;           // groups run again in a new transaction
+  uint32_t rollbacks;         // rollback() calls
+  uint32_t uncertain;         // COMMITs without an answer, statements dropped
+  uint32_t last_commit_ms;    // round trip of the last COMMIT
+  uint32_t max_commit_ms;
+} Group_Stats;
+
+class ESP32_MySQL_Commit_Group
+{
+  public:
+    ESP32_MySQL_Commit_Group(ESP32_MySQL_Connection *connection,
+                             const uint16_t& max_statements = ESP32_MYSQL_GROUP_STATEMENTS,
+                             const uint32_t& max_age_ms = ESP32_MYSQL_GROUP_AGE_MS,
+                             const size_t& log_bytes = ESP32_MYSQL_GROUP_LOG_BYTES);
+    ~ESP32_MySQL_Commit_Group();
+
+    bool execute(const char *sql);
+    bool commit();
+    bool commit_if_due();
+    bool rollback();
+
+    // Statements executed, or waiting for a replay, but not committed
+    uint16_t pending_statements() const
+    {
+      return num_statements;
+    }
+
+    const Group_Stats& stats() const
+    {
+      return group_stats;
+    }
+
+    void reset_stats()
+    {
+      memset(&group_stats, 0, sizeof(group_stats));
+    }
+
+    ESP32_MySQL_Connection *connection()
+    {
+      return conn;
+    }
+
+  private:
+    Group_Result  run(const char *sql);
+    bool          replay();
+    bool          log_statement(const char *sql, const size_t& length);
+    void          drop_statement(const size_t& offset);
+    void          clear();
+
+    ESP32_MySQL_Connection *conn;
+
+    // Statements of the open transaction, each ending with '\0'
+    char      *log;
+    size_t    log_size;
+    size_t    log_len;
+
+    uint16_t  num_statements;
+    uint16_t  max_statements;
+    uint32_t  max_age_ms;
+    uint32_t  first_statement_ms;
+    bool      needs_replay;       // the transaction was lost
+
+    Group_Stats group_stats;
+};
+
+#endif    // ESP32_MYSQL_COMMIT_GROUP_H
@@ -0,0 +1,325 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Commit_Group_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_COMMIT_GROUP_IMPL_H
+#define ESP32_MYSQL_COMMIT_GROUP_IMPL_H
+
+#include <ESP32_MySQL_Commit_Group.h>
+
+/*
+  ESP32_MySQL_Commit_Group
+
+  max_statements[in]  (optional) statements per transaction
+  max_age_ms[in]      (optional) commit_if_due() commits a group this old
+  log_bytes[in]       (optional) statements kept for replay, allocated here
+*/
+ESP32_MySQL_Commit_Group::ESP32_MySQL_Commit_Group(ESP32_MySQL_Connection *connection, const uint16_t& max_statements,
+                                                   const uint32_t& max_age_ms, const size_t& log_bytes)
+{
+  conn                  = connection;
+  log_size              = log_bytes;
+  log_len               = 0;
+  num_statements        = 0;
+  this->max_statements  = (max_statements == 0) ? 1 : max_statements;
+  this->max_age_ms      = max_age_ms;
+  first_statement_ms    = 0;
+  needs_replay          = false;
+
+  memset(&group_stats, 0, sizeof(group_stats));
+
+  log = (char *) malloc(log_size);
+
+  if (!log)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Commit_Group: out of memory, statements run alone");
+    log_size = 0;
+  }
+}
+
+ESP32_MySQL_Commit_Group::~ESP32_MySQL_Commit_Group()
+{
+  if (num_statements > 0)
+  {
+    ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Commit_Group: rolling back statements =", num_statements);
+    rollback();
+  }
+
+  free(log);
+}
+
+/*
+  execute - run sql in the open transaction, starting one if needed
+
+  sql[in]         statement that returns no rows, copied to the log
+
+  Returns bool - True = executed, or waiting in the log for the
+                 connection; false = rejected by the server, or the log
+                 is full while the connection is down
+*/
+bool ESP32_MySQL_Commit_Group::execute(const char *sql)
+{
+  const size_t length = strlen(sql) + 1;
+
+  if (length > log_size)
+  {
+    // Commit first, to keep the order of the statements
+    if (!commit() && (num_statements > 0))
+      return false;
+
+    return conn->keepalive() && (run(sql) == GROUP_OK);
+  }
+
+  if ( (log_len + length > log_size) && !commit() && (num_statements > 0) )
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Commit_Group::execute: log full, connection down");
+    return false;
+  }
+
+  if ( needs_replay && !replay() )
+  {
+    // Still down: the statement waits for the next replay
+    return log_statement(sql, length);
+  }
+
+  if (num_statements == 0)
+  {
+    if (!conn->begin())
+    {
+      if (conn->connected())
+        return false;
+
+      needs_replay = true;
+    }
+
+    first_statement_ms = millis();
+  }
+
+  log_statement(sql, length);
+
+  if (!needs_replay)
+  {
+    switch (run(sql))
+    {
+      case GROUP_OK:
+        break;
+
+      case GROUP_REJECTED:
+        drop_statement(log_len - length);
+        group_stats.rejected++;
+
+        // The error may have undone more than this statement
+        conn->rollback();
+
+        needs_replay = true;
+        replay();
+
+        return false;
+
+      case GROUP_NO_ANSWER:
+        needs_replay = true;
+        replay();
+        break;
+    }
+  }
+
+  if (num_statements >= max_statements)
+    commit();
+
+  return true;
+}
+
+/*
+  commit - commit the open transaction now
+
+  Returns bool - True = committed, or nothing to commit
+*/
+bool ESP32_MySQL_Commit_Group::commit()
+{
+  // Once again after a replay, if COMMIT was refused or the transaction lost
+  for (uint8_t attempt = 0; attempt < 2; attempt++)
+  {
+    if ( needs_replay && !replay() )
+      return false;
+
+    if (num_statements == 0)
+      return true;
+
+    const bool was_connected = conn->connected();
+    const uint32_t start = millis();
+
+    if (conn->commit())
+    {
+      const uint32_t elapsed = millis() - start;
+
+      group_stats.commits++;
+      group_stats.statements += num_statements;
+      group_stats.last_commit_ms = elapsed;
+
+      if (elapsed > group_stats.max_commit_ms)
+        group_stats.max_commit_ms = elapsed;
+
+      clear();
+
+      return true;
+    }
+
+    if (was_connected && !conn->connected())
+    {
+      ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Commit_Group: no answer to COMMIT, outcome unknown, statements =", num_statements);
+
+      group_stats.uncertain += num_statements;
+      clear();
+
+      return false;
+    }
+
+    // Rolled back by the server, or with a connection lost before COMMIT
+    needs_replay = true;
+  }
+
+  ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Commit_Group: COMMIT refused again, statements dropped =", num_statements);
+
+  group_stats.rejected += num_statements;
+  clear();
+
+  return false;
+}
+
+/*
+  commit_if_due - commit if the transaction is max_age_ms old
+
+  Call it from loop(), so writes are committed without new ones.
+
+  Returns bool - False = a due commit failed
+*/
+bool ESP32_MySQL_Commit_Group::commit_if_due()
+{
+  if ( (num_statements > 0) && ((uint32_t) (millis() - first_statement_ms) >= max_age_ms) )
+    return commit();
+
+  return true;
+}
+
+/*
+  rollback - discard the open transaction and its statements
+
+  Returns bool - True = rolled back
+*/
+bool ESP32_MySQL_Commit_Group::rollback()
+{
+  const bool rolled_back = conn->in_transaction() ? conn->rollback() : true;
+
+  group_stats.rollbacks++;
+  clear();
+
+  return rolled_back;
+}
+
+/*
+  replay - run the logged statements again in a new transaction
+
+  Statements the server rejects now are dropped, and the rest replayed
+  again, so each round is shorter.
+
+  Returns bool - True = all statements executed; false = connection down,
+                 they stay in the log
+*/
+bool ESP32_MySQL_Commit_Group::replay()
+{
+  while (true)
+  {
+    if (conn->in_transaction())
+      conn->rollback();
+
+    if (num_statements == 0)
+    {
+      clear();
+      return true;
+    }
+
+    if ( !conn->connected() && !conn->reconnect() )
+      return false;
+
+    group_stats.replays++;
+
+    if (!conn->begin())
+      return false;
+
+    size_t offset = 0;
+    Group_Result result = GROUP_OK;
+
+    while ( (offset < log_len) && (result == GROUP_OK) )
+    {
+      result = run(&log[offset]);
+
+      if (result == GROUP_OK)
+        offset += strlen(&log[offset]) + 1;
+    }
+
+    if (result == GROUP_OK)
+    {
+      ESP32_MYSQL_LOGINFO1("ESP32_MySQL_Commit_Group: replayed statements =", num_statements);
+
+      needs_replay = false;
+      return true;
+    }
+
+    if (result == GROUP_NO_ANSWER)
+      return false;
+
+    drop_statement(offset);
+    group_stats.rejected++;
+  }
+}
+
+Group_Result ESP32_MySQL_Commit_Group::run(const char *sql)
+{
+  if (conn->query_ok(sql))
+    return GROUP_OK;
+
+  // query_ok() closes the connection when there was no answer
+  return conn->connected() ? GROUP_REJECTED : GROUP_NO_ANSWER;
+}
+
+bool ESP32_MySQL_Commit_Group::log_statement(const char *sql, const size_t& length)
+{
+  if (log_len + length > log_size)
+    return false;
+
+  memcpy(&log[log_len], sql, length);
+  log_len += length;
+  num_statements++;
+
+  return true;
+}
+
+void ESP32_MySQL_Commit_Group::drop_statement(const size_t& offset)
+{
+  const size_t length = strlen(&log[offset]) + 1;
+
+  memmove(&log[offset], &log[offset + length], log_len - offset - length);
+  log_len -= length;
+  num_statements--;
+}
+
+void ESP32_MySQL_Commit_Group::clear()
+{
+  log_len         = 0;
+  num_statements  = 0;
+  needs_replay    = false;
+}
+
+#endif    // ESP32_MYSQL_COMMIT_GROUP_IMPL_H
@@ -21,6 +21,66 @@
 
 #include <ESP32_MySQL_Packet.h>
 
+#if defined(ESP32)
+  #include "freertos/FreeRTOS.h"
+  #include "freertos/semphr.h"
+#endif
+
+#ifndef ESP32_MYSQL_PING_TIMEOUT
+  #define ESP32_MYSQL_PING_TIMEOUT      1000    // Max wait in milliseconds for a ping reply
+#endif
+
+#ifndef ESP32_MYSQL_RECONNECT_TIMEOUT
+  #define ESP32_MYSQL_RECONNECT_TIMEOUT 2000    // Max wait in milliseconds for each login reply of reconnect()
+#endif
+
+#ifndef ESP32_MYSQL_RECONNECT_INTERVAL
+  #define ESP32_MYSQL_RECONNECT_INTERVAL  1000  // Least milliseconds between two reconnect() attempts
+#endif
+
+#ifndef ESP32_MYSQL_LOCK_TIMEOUT
+  #define ESP32_MYSQL_LOCK_TIMEOUT      5000    // Max wait in milliseconds for a shared connection
+#endif
+
+#ifndef ESP32_MYSQL_LOCAL_INFILES
+  #define ESP32_MYSQL_LOCAL_INFILES     4       // names allowed in LOAD DATA LOCAL INFILE
+#endif
+
+#ifndef ESP32_MYSQL_LOCAL_INFILE_CHUNK
+  #define ESP32_MYSQL_LOCAL_INFILE_CHUNK  (MAX_TRANSMISSION_UNIT - 4)   // least bytes per file packet
+#endif
+
+/*
+  Fills buffer with up to size bytes of data sent in pieces, such as a
+  long statement parameter or a LOAD DATA LOCAL INFILE file.
+  Returns the number of bytes written, 0 at the end of the data.
+*/
+typedef size_t (*Long_Data_Source)(uint8_t *buffer, const size_t& size, void *context);
+
+// A file the server may ask for, see add_local_infile()
+typedef struct
+{
+  const char        *name;      // as written in the statement, not copied
+  const uint8_t     *data;      // or source
+  size_t            length;
+  Long_Data_Source  source;
+  void              *context;
+} Local_Infile;
+
+// 32 bit FNV-1a of a string, for the hash tables of the statement cache and upsert buffer
+inline uint32_t SQL_hash_string(const char *str)
+{
+  uint32_t hash = 2166136261UL;
+
+  while (*str)
+  {
+    hash ^= (uint8_t) *str++;
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
 typedef enum 
 {
   RESULT_OK     = 0, 
@@ -28,6 +88,16 @@ typedef enum
   RESULT_PENDING
 } Connection_Result;
 
+// Contention counters for a connection shared between tasks (see enable_thread_safe()).
+typedef struct
+{
+  uint32_t acquired;        // successful acquisitions, not counting nested ones
+  uint32_t contended;       // acquisitions that had to wait for another task
+  uint32_t timeouts;        // acquisitions abandoned after the timeout
+  uint32_t total_wait_ms;   // time spent waiting in contended acquisitions
+  uint32_t max_wait_ms;     // longest single wait
+} Lock_Stats;
+
 
 class ESP32_MySQL_Connection : public MySQL_Packet 
 {
@@ -37,6 +107,9 @@ class ESP32_MySQL_Connection : public MySQL_Packet
     virtual ~ESP32_MySQL_Connection()
     {
 	    this->close();
+      enable_thread_safe(false);
+      forget_login();
+      set_init_script(NULL);
     };
     
     bool connect(const IPAddress& server, const uint16_t& port, char *user, char *password, char *db = NULL);
@@ -60,8 +133,147 @@ class ESP32_MySQL_Connection : public MySQL_Packet
     
     void close();
 
+    // Login steps on an already open socket, used by connect() and the asynchronous wrappers
+    bool start_session(char *user, char *password, char *db = NULL);
+    bool finish_session();
+    void remember_login(const char *hostname, const uint16_t& port, const char *user, const char *db);
+    
+    // Simple commands answered by an OK or error packet
+    bool send_command(const uint8_t& command, const uint8_t *arg = NULL, const size_t& arg_len = 0);
+    bool read_ok_packet();
+    bool query_ok(const char *sql);
+    
+    // Session reuse without reconnecting
+    bool reset();
+    bool change_user(char *user, char *password, char *db = NULL);
+    bool select_db(const char *db);
+    
+    // Statements run after every login and reset()
+    bool set_init_script(const char *sql);
+    bool run_init_script();
+
+    // Explicit transactions
+    bool begin();
+    bool commit();
+    bool rollback();
+
+    // Between begin() and commit() / rollback()
+    bool in_transaction() const
+    {
+      return transaction_open;
+    }
+    
+    // Files for LOAD DATA LOCAL INFILE; the server gets no others
+    bool add_local_infile(const char *name, const uint8_t *data, const size_t& length);
+    bool add_local_infile(const char *name, Stream& stream);
+    bool add_local_infile(const char *name, Long_Data_Source source, void *context = NULL);
+    void remove_local_infiles();
+    bool send_local_infile();
+    
+    // Liveness
+    bool ping(const uint32_t& timeout_ms = ESP32_MYSQL_PING_TIMEOUT);
+    bool reconnect();
+    bool keepalive();
+    
+    void set_keepalive(const uint32_t& interval_ms)
+    {
+      keepalive_ms = interval_ms;
+    }
+    
+    uint32_t get_reconnects() const
+    {
+      return reconnects;
+    }
+    
+    // Changes with every login and reset(); server side state such as
+    // prepared statements belongs to one session
+    uint32_t get_session() const
+    {
+      return session;
+    }
+
+    // Opt-in locking so several tasks can share one connection
+    bool enable_thread_safe(bool enable = true);
+    
+    bool thread_safe() const
+    {
+      return lock_enabled;
+    }
+    
+    bool lock(const uint32_t& timeout_ms = ESP32_MYSQL_LOCK_TIMEOUT);
+    void unlock();
+    
+    const Lock_Stats& lock_stats() const
+    {
+      return stats;
+    }
+    
+    void reset_lock_stats()
+    {
+      memset(&stats, 0, sizeof(stats));
+    }
+
   private:
     bool handle_authentication_result();
+    bool login(const char *hostname, const uint16_t& port, char *user, char *password, char *db, const uint8_t& attempts);
+    void forget_login();
+    Local_Infile *local_infile(const char *name);
+
+    // Login of the last connect(), for reconnect()
+    char        *login_host = NULL;
+    char        *login_user = NULL;
+    char        *login_db   = NULL;
+    uint16_t    login_port  = 0;
+    
+    char        *init_script  = NULL;
+    
+    Local_Infile  local_infiles[ESP32_MYSQL_LOCAL_INFILES];
+    uint8_t       num_local_infiles = 0;
+    
+    uint32_t    keepalive_ms  = 0;
+    uint32_t    reconnects    = 0;
+    uint32_t    last_reconnect_ms = 0;
+    bool        reconnect_tried   = false;
+    uint32_t    session       = 0;
+
+    bool        transaction_open    = false;
+    uint32_t    transaction_session = 0;    // session of begin()
+
+    bool        lock_enabled = false;
+    uint16_t    lock_depth   = 0;         // takes by the holder, changed only by it
+    Lock_Stats  stats = { 0, 0, 0, 0, 0 };
+#if defined(ESP32)
+    SemaphoreHandle_t lock_handle = NULL;
+#endif
+};
+
+/*
+  Holds a connection lock for the lifetime of the guard. A no-op when
+  the connection is not in thread-safe mode.
+*/
+class ESP32_MySQL_Lock_Guard
+{
+  public:
+    ESP32_MySQL_Lock_Guard(ESP32_MySQL_Connection *connection, const uint32_t& timeout_ms = ESP32_MYSQL_LOCK_TIMEOUT)
+    {
+      conn    = connection;
+      locked  = conn->lock(timeout_ms);
+    }
+    
+    ~ESP32_MySQL_Lock_Guard()
+    {
+      if (locked)
+        conn->unlock();
+    }
+    
+    bool owns_lock() const
+    {
+      return locked;
+    }
+
+  private:
+    ESP32_MySQL_Connection *conn;
+    bool locked;
 };
 
 //#include <MySQL_Generic_Connection_Impl.h>
@@ -60,11 +60,31 @@ String SQL_IPAddressToString(const IPAddress& _address)
 //////////////////////////////////////////////////////////////
 
 bool ESP32_MySQL_Connection::connect(const char *hostname, const uint16_t& port, char *user, char *password, char *db)
+{
+  return login(hostname, port, user, password, db, MAX_CONNECT_ATTEMPTS);
+}
+
+/*
+  login - open the TCP connection and log in
+
+  Shared by connect() and reconnect(), which differ only in how often
+  the TCP connect is tried.
+
+  attempts[in]    TCP connects tried, CONNECT_DELAY_MS apart
+
+  Returns bool - True = connection succeeded
+*/
+bool ESP32_MySQL_Connection::login(const char *hostname, const uint16_t& port, char *user, char *password, char *db, const uint8_t& attempts)
 {
   int  connected 	= 0;
   int  retries 		= 0;
   bool returnVal 	= false;
   
+  ESP32_MySQL_Lock_Guard guard(this);
+  
+  if (!guard.owns_lock())
+    return false;
+  
   ESP32_MYSQL_LOGWARN3("Connecting to Server:", hostname, ", Port = ", port);
   
   if (db)
@@ -74,9 +94,10 @@ bool ESP32_MySQL_Connection::connect(const char *hostname, const uint16_t& port,
   if (wants_tls())
     enable_tls(true, hostname);
   cache_password(password);
+  remember_login(hostname, port, user, db);
 
-  // Retry up to MAX_CONNECT_ATTEMPTS times.
-  while (retries++ < MAX_CONNECT_ATTEMPTS)
+  // Retry up to attempts times.
+  while (retries++ < attempts)
   {
     connected = client->connect(hostname, port);
     
@@ -85,7 +106,9 @@ bool ESP32_MySQL_Connection::connect(const char *hostname, const uint16_t& port,
     if (connected != SUCCESS)
     {
       ESP32_MYSQL_LOGDEBUG1("Can't connect. Retry #", retries);
-      delay(CONNECT_DELAY_MS);
+      
+      if (retries < attempts)
+        delay(CONNECT_DELAY_MS);
     }
     else
     {
@@ -96,62 +119,10 @@ bool ESP32_MySQL_Connection::connect(const char *hostname, const uint16_t& port,
   if (connected != SUCCESS)
     return false;
 
-  ESP32_MYSQL_LOGINFO("Connect OK. Try reading packets");
-
-  if ( !read_packet() )
-  {
-    ESP32_MYSQL_LOGERROR("Can't connect. Error reading packets");
-    return false;
-  }
-
-  ESP32_MYSQL_LOGINFO("Try parsing packets");
-
-  parse_handshake_packet();
-
-  ESP32_MYSQL_LOGINFO("Try send_authentication packets");
-
-  const bool tls_possible = wants_tls() && (server_capabilities & CLIENT_SSL);
-  uint32_t client_flags = build_client_flags(tls_possible);
-  uint8_t auth_sequence_id = 0x01;
-
-  if (tls_possible)
-  {
-    if (!send_ssl_request(client_flags, auth_sequence_id))
-    {
-      ESP32_MYSQL_LOGERROR("Failed to send SSL Request packet");
-      return false;
-    }
-
-    auth_sequence_id = get_next_sequence_id();
-
-    if (!start_tls_handshake())
-    {
-      ESP32_MYSQL_LOGERROR("TLS handshake failed");
-      return false;
-    }
-  }
-  else if (wants_tls() && !tls_possible)
-  {
-    ESP32_MYSQL_LOGWARN("Server does not advertise SSL support, continuing without TLS");
-  }
+  refresh_socket_fd();
 
-  send_authentication_packet(user, password, db, client_flags, auth_sequence_id);
-   
-  if ( !read_packet() )
-  {
-    ESP32_MYSQL_LOGERROR("Can't connect. Error reading auth packets");
-  }
-  else if (handle_authentication_result())
-  {
-    ESP32_MYSQL_LOGWARN1("Connected. Server Version =", server_version);
+  if (start_session(user, password, db) && finish_session())
     returnVal = true;
-  }
-
-	if (server_version)
-	{
-		free(server_version); // don't need it anymore
-		server_version = NULL;
-	}
 
   return returnVal;
 }
@@ -167,6 +138,11 @@ Connection_Result ESP32_MySQL_Connection::connectNonBlocking(const char *hostnam
   
   long now = 0;
   
+  ESP32_MySQL_Lock_Guard guard(this);
+  
+  if (!guard.owns_lock())
+    return RESULT_FAIL;
+  
   ESP32_MYSQL_LOGWARN3("Connecting to Server:", hostname, ", Port = ", port);
   
   if (db)
@@ -176,6 +152,7 @@ Connection_Result ESP32_MySQL_Connection::connectNonBlocking(const char *hostnam
   if (wants_tls())
     enable_tls(true, hostname);
   cache_password(password);
+  remember_login(hostname, port, user, db);
   
   while (retries < MAX_CONNECT_ATTEMPTS)
   {  
@@ -208,12 +185,38 @@ Connection_Result ESP32_MySQL_Connection::connectNonBlocking(const char *hostnam
   if (connected != SUCCESS)
     return RESULT_FAIL;
 
+  refresh_socket_fd();
+
+  if (start_session(user, password, db) && finish_session())
+    returnVal = RESULT_OK;
+
+  return returnVal;
+}
+
+//////////////////////////////////////////////////////////////
+
+/*
+  start_session - first half of the login on an open socket
+
+  Reads the server greeting, upgrades to TLS when requested and sends
+  the authentication packet. It stops before waiting for the server's
+  verdict so that callers may wait for it without blocking (see
+  finish_session()).
+
+  user[in]        user name
+  password[in]    user password
+  db[in]          (optional) default database
+
+  Returns bool - True = authentication packet sent
+*/
+bool ESP32_MySQL_Connection::start_session(char *user, char *password, char *db)
+{
   ESP32_MYSQL_LOGINFO("Connect OK. Try reading packets");
 
   if ( !read_packet() )
   {
     ESP32_MYSQL_LOGERROR("Can't connect. Error reading packets");
-    return RESULT_FAIL;
+    return false;
   }
 
   ESP32_MYSQL_LOGINFO("Try parsing packets");
@@ -224,6 +227,16 @@ Connection_Result ESP32_MySQL_Connection::connectNonBlocking(const char *hostnam
 
   const bool tls_possible = wants_tls() && (server_capabilities & CLIENT_SSL);
   uint32_t client_flags = build_client_flags(tls_possible);
+
+  // Only offer LOAD DATA LOCAL INFILE when there is something to load
+  if (num_local_infiles > 0)
+    client_flags |= CLIENT_LOCAL_FILES;
+
+  // MariaDB: ask for bulk execution, which means announcing a MariaDB client
+  client_ext_capabilities = server_ext_capabilities & MARIADB_CLIENT_STMT_BULK_OPERATIONS;
+
+  if (client_ext_capabilities)
+    client_flags &= ~CLIENT_LONG_PASSWORD;
   uint8_t auth_sequence_id = 0x01;
 
   if (tls_possible)
@@ -231,7 +244,7 @@ Connection_Result ESP32_MySQL_Connection::connectNonBlocking(const char *hostnam
     if (!send_ssl_request(client_flags, auth_sequence_id))
     {
       ESP32_MYSQL_LOGERROR("Failed to send SSL Request packet");
-      return RESULT_FAIL;
+      return false;
     }
 
     auth_sequence_id = get_next_sequence_id();
@@ -239,7 +252,7 @@ Connection_Result ESP32_MySQL_Connection::connectNonBlocking(const char *hostnam
     if (!start_tls_handshake())
     {
       ESP32_MYSQL_LOGERROR("TLS handshake failed");
-      return RESULT_FAIL;
+      return false;
     }
   }
   else if (wants_tls() && !tls_possible)
@@ -248,7 +261,24 @@ Connection_Result ESP32_MySQL_Connection::connectNonBlocking(const char *hostnam
   }
 
   send_authentication_packet(user, password, db, client_flags, auth_sequence_id);
-   
+
+  return true;
+}
+
+//////////////////////////////////////////////////////////////
+
+/*
+  finish_session - second half of the login
+
+  Reads the server's answer to the authentication packet sent by
+  start_session() and completes any extra authentication round trips.
+
+  Returns bool - True = logged in
+*/
+bool ESP32_MySQL_Connection::finish_session()
+{
+  bool returnVal = false;
+  
   if ( !read_packet() )
   {
     ESP32_MYSQL_LOGERROR("Can't connect. Error reading auth packets");
@@ -256,7 +286,15 @@ Connection_Result ESP32_MySQL_Connection::connectNonBlocking(const char *hostnam
   else if (handle_authentication_result())
   {
     ESP32_MYSQL_LOGWARN1("Connected. Server Version =", server_version);
-    returnVal = RESULT_OK;
+    returnVal = true;
+  }
+  
+  set_io_state(IO_IDLE);
+  
+  if (returnVal)
+  {
+    session++;
+    returnVal = run_init_script();
   }
 
 	if (server_version)
@@ -468,6 +506,8 @@ bool ESP32_MySQL_Connection::handle_authentication_result()
 */
 void ESP32_MySQL_Connection::close()
 {
+  ESP32_MySQL_Lock_Guard guard(this);
+  
   if (connected())
   {
     client->flush();
@@ -478,4 +518,851 @@ void ESP32_MySQL_Connection::close()
   }
 }
 
+//////////////////////////////////////////////////////////////
+
+/*
+  remember_login - keep the login details for reconnect()
+
+  The password itself is kept by cache_password().
+*/
+static char *SQL_strdup(const char *str)
+{
+  if (!str)
+    return NULL;
+
+  const size_t len = strlen(str) + 1;
+  char *copy = (char *) malloc(len);
+
+  if (copy)
+    memcpy(copy, str, len);
+
+  return copy;
+}
+
+static void SQL_replace_string(char **target, const char *str)
+{
+  // Our own copy, e.g. passed back in by reconnect()
+  if (*target == str)
+    return;
+
+  char *copy = SQL_strdup(str);
+
+  free(*target);
+  *target = copy;
+}
+
+void ESP32_MySQL_Connection::remember_login(const char *hostname, const uint16_t& port, const char *user, const char *db)
+{
+  SQL_replace_string(&login_host, hostname);
+  SQL_replace_string(&login_user, user);
+  SQL_replace_string(&login_db,   db);
+  login_port = port;
+}
+
+void ESP32_MySQL_Connection::forget_login()
+{
+  free(login_host);
+  free(login_user);
+  free(login_db);
+
+  login_host  = NULL;
+  login_user  = NULL;
+  login_db    = NULL;
+}
+
+//////////////////////////////////////////////////////////////
+
+/*
+  send_command - send a command packet
+
+  Builds the packet in the connection buffer and starts a new sequence.
+
+  command[in]     command code (ESP32_MYSQL_COM_xxx)
+  arg[in]         (optional) command argument
+  arg_len[in]     number of bytes in arg
+
+  Returns bool - True = packet written
+*/
+bool ESP32_MySQL_Connection::send_command(const uint8_t& command, const uint8_t *arg, const size_t& arg_len)
+{
+  if (!reserve_buffer(arg_len + 5))
+    return false;
+
+  store_int(&buffer[0], arg_len + 1, 3);
+  buffer[3] = 0x00;
+  buffer[4] = command;
+
+  if (arg_len > 0)
+    memcpy(&buffer[5], arg, arg_len);
+
+  return write_bytes(buffer, arg_len + 5);
+}
+
+/*
+  read_ok_packet - read the answer to a simple command
+
+  Returns bool - True = Ok packet, false = error packet or no answer
+*/
+bool ESP32_MySQL_Connection::read_ok_packet()
+{
+  if ( !read_packet() || (packet_len <= 0) )
+    return false;
+
+  set_io_state(IO_IDLE);
+
+  const int type = get_packet_type();
+
+  if (type == ESP32_MYSQL_OK_PACKET)
+    return true;
+
+  if (type == ESP32_MYSQL_ERROR_PACKET)
+    parse_error_packet();
+
+  return false;
+}
+
+//////////////////////////////////////////////////////////////
+
+/*
+  reset - start a clean session on the open connection
+
+  Uses COM_RESET_CONNECTION (MySQL 5.7.3+, MariaDB 10.2.4+): session
+  variables, temporary tables, user variables, locks and prepared
+  statements are discarded, an open transaction is rolled back, while the
+  user and default database stay. Older servers get COM_CHANGE_USER with
+  the last login instead. Either way the init script runs again, and no
+  TCP connect, TLS handshake or full authentication is repeated.
+
+  Returns bool - True = clean session ready
+*/
+bool ESP32_MySQL_Connection::reset()
+{
+  if (!connected())
+    return false;
+
+  ESP32_MySQL_Lock_Guard guard(this);
+
+  if (!guard.owns_lock())
+    return false;
+
+  if (server_capabilities & CLIENT_SESSION_TRACK)
+  {
+    if ( !send_command(ESP32_MYSQL_COM_RESET_CONNECTION) || !read_packet() )
+    {
+      ESP32_MYSQL_LOGERROR("Reset failed, closing connection");
+      close();
+
+      return false;
+    }
+
+    set_io_state(IO_IDLE);
+
+    if (get_packet_type() == ESP32_MYSQL_OK_PACKET)
+    {
+      session++;
+      return run_init_script();
+    }
+
+    parse_error_packet();
+  }
+
+  if (!login_user)
+  {
+    ESP32_MYSQL_LOGERROR("Can't reset, no previous login");
+    return false;
+  }
+
+  ESP32_MYSQL_LOGINFO("Resetting with COM_CHANGE_USER");
+
+  return change_user(login_user, (char *) (get_cached_password() ? get_cached_password() : ""), login_db);
+}
+
+/*
+  change_user - log in as another user on the open connection
+
+  Like reset(), the session starts clean and the init script runs again.
+  On failure the server closes the connection.
+
+  user[in]        user name
+  password[in]    user password
+  db[in]          (optional) default database
+
+  Returns bool - True = logged in
+*/
+bool ESP32_MySQL_Connection::change_user(char *user, char *password, char *db)
+{
+  if (!connected())
+    return false;
+
+  ESP32_MySQL_Lock_Guard guard(this);
+
+  if (!guard.owns_lock())
+    return false;
+
+  // The caching_sha2 full authentication reads the cached password
+  cache_password(password);
+
+  if ( !send_change_user_packet(user, password, db) || !read_packet() )
+    return false;
+
+  if ( (get_packet_type() == ESP32_MYSQL_EOF_PACKET) && (packet_len > 1) )
+  {
+    if ( !send_auth_switch_response(password) || !read_packet() )
+      return false;
+  }
+
+  const bool logged_in = handle_authentication_result();
+
+  set_io_state(IO_IDLE);
+
+  if (!logged_in)
+    return false;
+
+  session++;
+  remember_login(login_host, login_port, user, db);
+
+  return run_init_script();
+}
+
+/*
+  select_db - change the default database (COM_INIT_DB)
+
+  The new database is also used by reconnect().
+
+  db[in]          database name
+
+  Returns bool - True = database selected
+*/
+bool ESP32_MySQL_Connection::select_db(const char *db)
+{
+  if (!db || !connected())
+    return false;
+
+  ESP32_MySQL_Lock_Guard guard(this);
+
+  if (!guard.owns_lock())
+    return false;
+
+  if ( !send_command(ESP32_MYSQL_COM_INIT_DB, (const uint8_t *) db, strlen(db)) || !read_ok_packet() )
+  {
+    ESP32_MYSQL_LOGERROR1("Can't select database", db);
+    return false;
+  }
+
+  SQL_replace_string(&login_db, db);
+
+  return true;
+}
+
+/*
+  set_init_script - statements to run once per session
+
+  The script runs after every login (connect(), reconnect()) and after
+  reset() or change_user(), e.g.
+
+    conn.set_init_script("SET time_zone = '+00:00'; SET SESSION sql_mode = 'STRICT_ALL_TABLES'");
+
+  Statements are separated by ';' and must not return rows. The script
+  takes effect with the next login; call run_init_script() to apply it
+  to the current session.
+
+  sql[in]         script, copied; NULL = none
+
+  Returns bool - True = script stored
+*/
+bool ESP32_MySQL_Connection::set_init_script(const char *sql)
+{
+  SQL_replace_string(&init_script, sql);
+
+  return (sql == NULL) || (init_script != NULL);
+}
+
+/*
+  run_init_script - run the init script on the current session
+
+  The whole script goes out as one multi-statement query, so it costs a
+  single round trip.
+
+  Returns bool - True = every statement succeeded (or there is no script)
+*/
+bool ESP32_MySQL_Connection::run_init_script()
+{
+  if (!init_script)
+    return true;
+
+  ESP32_MySQL_Lock_Guard guard(this);
+
+  if (!guard.owns_lock())
+    return false;
+
+  if (!send_command(ESP32_MYSQL_COM_QUERY, (const uint8_t *) init_script, strlen(init_script)))
+    return false;
+
+  // One Ok packet per statement; the server stops at the first error
+  do
+  {
+    if (!read_ok_packet())
+    {
+      ESP32_MYSQL_LOGERROR1("Init script failed:", init_script);
+      return false;
+    }
+  } while (get_status_flags() & SERVER_MORE_RESULTS_EXISTS);
+
+  return true;
+}
+
+/*
+  query_ok - run a statement answered by an Ok packet
+
+  A statement without an answer, or answered with rows, leaves the
+  connection out of step, so it is closed.
+
+  Returns bool - True = Ok packet
+*/
+bool ESP32_MySQL_Connection::query_ok(const char *sql)
+{
+  ESP32_MySQL_Lock_Guard guard(this);
+
+  if (!guard.owns_lock())
+    return false;
+
+  if ( !send_command(ESP32_MYSQL_COM_QUERY, (const uint8_t *) sql, strlen(sql)) || !read_packet() || (packet_len <= 0) )
+  {
+    ESP32_MYSQL_LOGERROR1("No answer to", sql);
+    close();
+
+    return false;
+  }
+
+  set_io_state(IO_IDLE);
+
+  if (get_packet_type() == ESP32_MYSQL_OK_PACKET)
+    return true;
+
+  if (get_packet_type() == ESP32_MYSQL_ERROR_PACKET)
+  {
+    parse_error_packet();
+    ESP32_MYSQL_LOGERROR1("Statement failed:", sql);
+  }
+  else
+  {
+    // Rows nobody reads
+    ESP32_MYSQL_LOGERROR1("Statement returned rows:", sql);
+    close();
+  }
+
+  return false;
+}
+
+/*
+  begin - start a transaction
+
+  Statements up to commit() or rollback() are applied all together or
+  not at all, and share a single commit (one log flush on the server)
+  instead of one each with autocommit.
+
+  If the connection is lost in between, the server rolls the transaction
+  back: commit() then fails even if keepalive() has reconnected, and
+  statements sent after the reconnect ran with autocommit.
+
+  Returns bool - True = transaction started
+*/
+bool ESP32_MySQL_Connection::begin()
+{
+  ESP32_MySQL_Lock_Guard guard(this);
+
+  if ( !guard.owns_lock() || !keepalive() )
+    return false;
+
+  if (!query_ok("START TRANSACTION"))
+    return false;
+
+  transaction_open    = true;
+  transaction_session = session;
+
+  return true;
+}
+
+/*
+  commit - make the statements since begin() permanent
+
+  Returns bool - True = committed; false = rolled back, by the server or
+                 with the connection, or no answer: see connected()
+*/
+bool ESP32_MySQL_Connection::commit()
+{
+  const bool lost = transaction_open && (transaction_session != session);
+
+  transaction_open = false;
+
+  if (lost)
+  {
+    ESP32_MYSQL_LOGERROR("Transaction lost with the connection, rolled back by the server");
+    return false;
+  }
+
+  return query_ok("COMMIT");
+}
+
+/*
+  rollback - discard the statements since begin()
+
+  Returns bool - True = rolled back, also when the server did it already
+                 because the connection was lost
+*/
+bool ESP32_MySQL_Connection::rollback()
+{
+  const bool lost = transaction_open && (transaction_session != session);
+
+  transaction_open = false;
+
+  if ( lost || !connected() )
+    return true;
+
+  return query_ok("ROLLBACK");
+}
+
+//////////////////////////////////////////////////////////////
+
+/*
+  add_local_infile - allow LOAD DATA LOCAL INFILE 'name' to load data
+
+  The server names the file it wants, and only names added here are
+  served, so a statement can't read anything else on the device:
+
+    conn.add_local_infile("readings.csv", csv, csv_len);
+    conn.connect(...);
+    query.execute("LOAD DATA LOCAL INFILE 'readings.csv' INTO TABLE test.readings "
+                  "FIELDS TERMINATED BY ',' (sensor, value)");
+
+  Add files before connect(): the client offers CLIENT_LOCAL_FILES only
+  if there are any (the server must have local_infile enabled too).
+  Adding a name again replaces it.
+
+  name[in]        file name as written in the statement, not copied
+  data[in]        file contents, not copied, sent on every request
+
+  Returns bool - False = ESP32_MYSQL_LOCAL_INFILES names added already
+*/
+bool ESP32_MySQL_Connection::add_local_infile(const char *name, const uint8_t *data, const size_t& length)
+{
+  Local_Infile *file = data ? local_infile(name) : NULL;
+
+  if (!file)
+    return false;
+
+  file->data    = data;
+  file->length  = length;
+
+  return true;
+}
+
+// Long_Data_Source reading a Stream to its end
+static size_t SQL_read_stream(uint8_t *buffer, const size_t& size, void *context)
+{
+  return ((Stream *) context)->readBytes(buffer, size);
+}
+
+/*
+  add_local_infile - serve name from what is left in stream, e.g. a File
+
+  The stream is read once; add it again before the next request.
+*/
+bool ESP32_MySQL_Connection::add_local_infile(const char *name, Stream& stream)
+{
+  return add_local_infile(name, SQL_read_stream, &stream);
+}
+
+/*
+  add_local_infile - serve name from source, called until it returns 0
+
+  A source can generate the rows as they are sent, e.g. CSV lines from a
+  buffer of readings, so the file never exists as a whole.
+*/
+bool ESP32_MySQL_Connection::add_local_infile(const char *name, Long_Data_Source source, void *context)
+{
+  Local_Infile *file = source ? local_infile(name) : NULL;
+
+  if (!file)
+    return false;
+
+  file->source  = source;
+  file->context = context;
+
+  return true;
+}
+
+void ESP32_MySQL_Connection::remove_local_infiles()
+{
+  num_local_infiles = 0;
+}
+
+/*
+  local_infile - the cleared entry for name, added if it is new
+*/
+Local_Infile *ESP32_MySQL_Connection::local_infile(const char *name)
+{
+  if (!name)
+    return NULL;
+
+  uint8_t index = 0;
+
+  while ( (index < num_local_infiles) && (strcmp(local_infiles[index].name, name) != 0) )
+    index++;
+
+  if (index >= ESP32_MYSQL_LOCAL_INFILES)
+  {
+    ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Connection::add_local_infile: no room for", name);
+    return NULL;
+  }
+
+  if (index == num_local_infiles)
+    num_local_infiles++;
+
+  memset(&local_infiles[index], 0, sizeof(Local_Infile));
+  local_infiles[index].name = name;
+
+  return &local_infiles[index];
+}
+
+/*
+  send_local_infile - answer the LOCAL INFILE request in the buffer
+
+  Bytes                   Name
+  -----                   ----
+  1                       0xfb
+  n                       file name
+
+  The file goes back as packets of raw data, as large as the packet
+  buffer allows, followed by an empty packet. The server then sends the
+  result of the LOAD DATA statement. A name that was not added is
+  refused with an empty file, so the statement loads no rows.
+
+  Returns bool - False = write failed, the connection is unusable
+*/
+bool ESP32_MySQL_Connection::send_local_infile()
+{
+  const int name_len = packet_len - 1;
+  uint8_t   seq      = buffer[3] + 1;
+  const Local_Infile *file = NULL;
+
+  for (uint8_t i = 0; i < num_local_infiles; i++)
+  {
+    if ( ((int) strlen(local_infiles[i].name) == name_len) &&
+         (memcmp(local_infiles[i].name, &buffer[5], name_len) == 0) )
+    {
+      file = &local_infiles[i];
+    }
+  }
+
+  if (!file)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Connection: LOCAL INFILE not allowed");
+  }
+  else if (!reserve_buffer(4 + ESP32_MYSQL_LOCAL_INFILE_CHUNK))
+  {
+    // Can't send it, but the server still waits for the end
+    file = NULL;
+  }
+
+  const size_t chunk = largest_buffer_size - 4;
+  size_t sent = 0;
+  size_t length;
+
+  do
+  {
+    length = 0;
+
+    if (file && file->source)
+    {
+      length = file->source(&buffer[4], chunk, file->context);
+
+      if (length > chunk)
+        length = chunk;
+    }
+    else if (file)
+    {
+      length = (file->length - sent < chunk) ? file->length - sent : chunk;
+
+      memcpy(&buffer[4], file->data + sent, length);
+    }
+
+    store_int(&buffer[0], length, 3);
+    buffer[3] = seq++;
+
+    if (!write_bytes(buffer, 4 + length))
+    {
+      ESP32_MYSQL_LOGERROR("ESP32_MySQL_Connection: LOCAL INFILE write failed");
+      return false;
+    }
+
+    sent += length;
+  } while (length > 0);
+
+  ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Connection: LOCAL INFILE bytes =", sent);
+
+  return true;
+}
+
+//////////////////////////////////////////////////////////////
+
+/*
+  ping - check that the server is still there (COM_PING)
+
+  Unlike connected(), which only asks the local Client, this is a round
+  trip to the server with its own short deadline, so a half-open TCP
+  connection is found in timeout_ms instead of ESP32_MYSQL_DATA_TIMEOUT.
+  A connection that fails the ping is closed, as a late reply would
+  desynchronize it.
+
+  timeout_ms[in]  Max wait for the reply
+
+  Returns bool - True = server answered
+*/
+bool ESP32_MySQL_Connection::ping(const uint32_t& timeout_ms)
+{
+  if (!connected())
+    return false;
+
+  ESP32_MySQL_Lock_Guard guard(this);
+
+  if (!guard.owns_lock())
+    return false;
+
+  const uint32_t saved_timeout = get_data_timeout();
+
+  set_data_timeout(timeout_ms);
+
+  const bool alive = send_command(ESP32_MYSQL_COM_PING) && read_ok_packet();
+
+  set_data_timeout(saved_timeout);
+
+  if (!alive)
+  {
+    ESP32_MYSQL_LOGWARN("Ping failed, closing connection");
+    close();
+  }
+
+  return alive;
+}
+
+/*
+  reconnect - connect again with the login of the last connect()
+
+  Unlike connect() it tries once, without sleeping, and the login must
+  answer within ESP32_MYSQL_RECONNECT_TIMEOUT, so a caller holding the
+  connection (keepalive(), a query) is never stuck for the full retry
+  loop. Attempts are at least ESP32_MYSQL_RECONNECT_INTERVAL apart; an
+  earlier call returns false at once. Retrying is up to the caller,
+  e.g. the next keepalive() from loop().
+
+  Returns bool - True = connected
+*/
+bool ESP32_MySQL_Connection::reconnect()
+{
+  if (!login_host || !login_user)
+  {
+    ESP32_MYSQL_LOGERROR("Can't reconnect, no previous login");
+    return false;
+  }
+
+  ESP32_MySQL_Lock_Guard guard(this);
+
+  if (!guard.owns_lock())
+    return false;
+
+  if ( reconnect_tried && ( (uint32_t) (millis() - last_reconnect_ms) < ESP32_MYSQL_RECONNECT_INTERVAL ) )
+  {
+    ESP32_MYSQL_LOGDEBUG("Reconnect attempted too recently");
+    return false;
+  }
+
+  reconnect_tried   = true;
+  last_reconnect_ms = millis();
+
+  close();
+
+  // login() replaces the cached password, so hand it a copy
+  char *pwd = SQL_strdup(get_cached_password());
+
+  const uint32_t saved_timeout = get_data_timeout();
+
+  set_data_timeout(ESP32_MYSQL_RECONNECT_TIMEOUT);
+
+  const bool ok = login(login_host, login_port, login_user, pwd ? pwd : (char *) "", login_db, 1);
+
+  set_data_timeout(saved_timeout);
+
+  free(pwd);
+
+  if (ok)
+    reconnects++;
+  else
+    close();
+
+  return ok;
+}
+
+/*
+  keepalive - keep an idle connection usable
+
+  Call it regularly from loop(). When set_keepalive() is enabled and the
+  connection has been idle for the interval, it is pinged; if the ping
+  fails, or the connection is already gone, it reconnects with the last
+  login. Pick an interval below the server's wait_timeout so the server
+  never drops the session. Queries also call this before sending, so the
+  first query after a long pause doesn't wait ESP32_MYSQL_DATA_TIMEOUT on
+  a dead socket.
+
+  Returns bool - True = connection usable
+*/
+bool ESP32_MySQL_Connection::keepalive()
+{
+  if (keepalive_ms == 0)
+    return connected();
+
+  if (!connected())
+    return reconnect();
+
+  if ( (get_io_state() == IO_IDLE) && (idle_ms() >= keepalive_ms) )
+  {
+    if (!ping())
+      return reconnect();
+  }
+
+  return true;
+}
+
+//////////////////////////////////////////////////////////////
+
+/*
+  enable_thread_safe - share this connection between several tasks
+
+  In thread-safe mode every command, together with the consumption of
+  its complete result set, holds the connection exclusively. Other tasks
+  wait up to ESP32_MYSQL_LOCK_TIMEOUT for it. The lock is recursive, so a
+  task already holding it may issue nested calls (e.g. close()).
+
+  Disable it only once no other task uses the connection.
+
+  enable[in]      True = create the lock, false = release it
+
+  Returns bool - True = requested mode is active; false = lock could not
+                 be created, or is held and was kept
+*/
+bool ESP32_MySQL_Connection::enable_thread_safe(bool enable)
+{
+#if defined(ESP32)
+  if (enable && (lock_handle == NULL))
+  {
+    lock_handle = xSemaphoreCreateRecursiveMutex();
+    
+    if (lock_handle == NULL)
+    {
+      ESP32_MYSQL_LOGERROR("Can't create connection lock");
+      lock_enabled = false;
+      
+      return false;
+    }
+  }
+  else if (!enable && (lock_handle != NULL))
+  {
+    // Not while a task holds it: its unlock() would be lost
+    if ( (lock_depth > 0) || (xSemaphoreTakeRecursive(lock_handle, 0) != pdTRUE) )
+    {
+      ESP32_MYSQL_LOGERROR("Connection lock in use, still thread-safe");
+      return false;
+    }
+
+    lock_enabled = false;
+    xSemaphoreGiveRecursive(lock_handle);
+    vSemaphoreDelete(lock_handle);
+    lock_handle = NULL;
+  }
+
+  lock_enabled = enable;
+  
+  return true;
+#else
+  if (enable)
+    ESP32_MYSQL_LOGERROR("Thread-safe mode not supported on this platform");
+    
+  lock_enabled = false;
+  
+  return !enable;
+#endif
+}
+
+//////////////////////////////////////////////////////////////
+
+/*
+  lock - take exclusive ownership of the connection
+
+  The uncontended case is a single non-blocking take. Only when another
+  task owns the connection do we block (up to timeout_ms) and account
+  the wait in lock_stats(), so callers can tell when one shared
+  connection has become a bottleneck.
+
+  timeout_ms[in]  Max time to wait for the owning task
+
+  Returns bool - True = lock held (always true when not thread-safe)
+*/
+bool ESP32_MySQL_Connection::lock(const uint32_t& timeout_ms)
+{
+  if (!lock_enabled)
+    return true;
+
+#if defined(ESP32)
+  if (xSemaphoreTakeRecursive(lock_handle, 0) == pdTRUE)
+  {
+    // Nested takes by the holder are not acquisitions
+    if (lock_depth++ == 0)
+      stats.acquired++;
+
+    return true;
+  }
+
+  const unsigned long start = millis();
+
+  if (xSemaphoreTakeRecursive(lock_handle, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)
+  {
+    // Counted without the lock, so only approximate under heavy contention
+    stats.timeouts++;
+    ESP32_MYSQL_LOGWARN1("Timeout waiting for shared connection, ms =", timeout_ms);
+    
+    return false;
+  }
+
+  const uint32_t waited = (uint32_t) (millis() - start);
+  
+  lock_depth++;
+  stats.acquired++;
+  stats.contended++;
+  stats.total_wait_ms += waited;
+  
+  if (waited > stats.max_wait_ms)
+    stats.max_wait_ms = waited;
+  
+  return true;
+#else
+  (void) timeout_ms;
+  return true;
+#endif
+}
+
+//////////////////////////////////////////////////////////////
+
+void ESP32_MySQL_Connection::unlock()
+{
+#if defined(ESP32)
+  if (lock_enabled && lock_handle)
+  {
+    if (lock_depth > 0)
+      lock_depth--;
+
+    xSemaphoreGiveRecursive(lock_handle);
+  }
+#endif
+}
+
 #endif    // ESP32_MySQL_Connection_IMPL_H
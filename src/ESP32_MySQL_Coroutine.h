@@ -0,0 +1,350 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Coroutine.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  C++20 coroutine wrappers (only compiled with a C++20 toolchain)
+
+  Each database conversation is written as a coroutine returning
+  ESP32_MySQL_Task and handed to an ESP32_MySQL_Scheduler. While a
+  conversation waits for the server, the scheduler runs the others, so
+  many connections make progress on one core without a task each:
+
+    ESP32_MySQL_Task conversation(ESP32_MySQL_Connection *conn)
+    {
+      if (!co_await async_connect(conn, server, port, user, password))
+        co_return;
+
+      ESP32_MySQL_Query query(conn);
+
+      if (co_await async_execute(&query, "SELECT id, name FROM test.t"))
+      {
+        co_await async_get_columns(&query);
+
+        while (row_values *row = co_await async_get_next_row(&query))
+          Serial.println(row->values[1]);
+      }
+    }
+
+    scheduler.spawn(conversation(&conn1));
+    scheduler.spawn(conversation(&conn2));
+    scheduler.run();
+
+  Note: `for co_await` did not make it into C++20, hence the while loop.
+  Use one connection per conversation.
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_COROUTINE_H
+#define ESP32_MYSQL_COROUTINE_H
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+  #if __has_include(<coroutine>)
+    #define ESP32_MYSQL_HAS_COROUTINES      1
+  #endif
+#endif
+
+#ifdef ESP32_MYSQL_HAS_COROUTINES
+
+#include <coroutine>
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <ESP32_MySQL_Query.h>
+
+#ifndef ESP32_MYSQL_MAX_COROUTINES
+  #define ESP32_MYSQL_MAX_COROUTINES    16      // Conversations one scheduler can run
+#endif
+
+#ifndef ESP32_MYSQL_ASYNC_TIMEOUT
+  #define ESP32_MYSQL_ASYNC_TIMEOUT     6000    // Max wait in milliseconds for a server response
+#endif
+
+class ESP32_MySQL_Task;
+class ESP32_MySQL_Scheduler;
+
+struct ESP32_MySQL_Promise
+{
+  ESP32_MySQL_Scheduler *scheduler = NULL;
+  uint8_t                slot      = 0;
+
+  ESP32_MySQL_Task get_return_object();
+
+  std::suspend_always initial_suspend() noexcept
+  {
+    return {};
+  }
+
+  std::suspend_always final_suspend() noexcept
+  {
+    return {};
+  }
+
+  void return_void() {}
+
+  void unhandled_exception()
+  {
+    abort();
+  }
+};
+
+// Return type of a conversation coroutine. Starts suspended until spawned.
+class ESP32_MySQL_Task
+{
+  public:
+    typedef ESP32_MySQL_Promise promise_type;
+
+    explicit ESP32_MySQL_Task(std::coroutine_handle<ESP32_MySQL_Promise> coroutine) : handle(coroutine) {}
+
+    ESP32_MySQL_Task(ESP32_MySQL_Task&& other) noexcept : handle(other.handle)
+    {
+      other.handle = NULL;
+    }
+
+    ESP32_MySQL_Task(const ESP32_MySQL_Task&) = delete;
+    ESP32_MySQL_Task& operator=(const ESP32_MySQL_Task&) = delete;
+
+    ~ESP32_MySQL_Task()
+    {
+      if (handle)
+        handle.destroy();
+    }
+
+    std::coroutine_handle<ESP32_MySQL_Promise> release()
+    {
+      std::coroutine_handle<ESP32_MySQL_Promise> coroutine = handle;
+      handle = NULL;
+
+      return coroutine;
+    }
+
+  private:
+    std::coroutine_handle<ESP32_MySQL_Promise> handle;
+};
+
+inline ESP32_MySQL_Task ESP32_MySQL_Promise::get_return_object()
+{
+  return ESP32_MySQL_Task(std::coroutine_handle<ESP32_MySQL_Promise>::from_promise(*this));
+}
+
+/*
+  Base of every awaitable operation. The scheduler calls step() whenever
+  a whole packet has arrived on the source connection (or on every pass
+  when there is no source), and step() reads just that packet. The
+  coroutine resumes once step() reports completion or the deadline
+  passes. A timed out operation fails, after cancel() closed its
+  connection.
+*/
+class ESP32_MySQL_Operation
+{
+  public:
+    virtual ~ESP32_MySQL_Operation() {}
+
+    bool await_ready() const
+    {
+      return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<ESP32_MySQL_Promise> handle);
+
+    // Called once when the coroutine suspends. Return false to resume at once.
+    virtual bool start()
+    {
+      return true;
+    }
+
+    // Called with a packet ready on the source. Return true when complete.
+    virtual bool step() = 0;
+
+    // Called when the deadline passed: drop what is still on the way
+    virtual void cancel() {}
+
+    MySQL_Packet   *source    = NULL;     // connection gating step(), NULL = poll every pass
+    unsigned long   deadline  = 0;        // millis() limit for the current wait, 0 = none
+    bool            failed    = false;
+};
+
+class ESP32_MySQL_Scheduler
+{
+  public:
+    ESP32_MySQL_Scheduler();
+    ~ESP32_MySQL_Scheduler();
+
+    bool    spawn(ESP32_MySQL_Task task);
+    bool    run_once();
+    void    run();
+
+    uint8_t active() const
+    {
+      return count;
+    }
+
+    bool    wait(const uint8_t& slot, ESP32_MySQL_Operation *op);
+
+  private:
+    typedef struct
+    {
+      std::coroutine_handle<ESP32_MySQL_Promise>  handle;
+      ESP32_MySQL_Operation                      *op;     // NULL = runnable
+    } Slot;
+
+    Slot    slots[ESP32_MYSQL_MAX_COROUTINES];
+    uint8_t count;
+};
+
+class ESP32_MySQL_Connect_Op : public ESP32_MySQL_Operation
+{
+  public:
+    ESP32_MySQL_Connect_Op(ESP32_MySQL_Connection *connection, const char *hostname, const uint16_t& port,
+                           char *user, char *password, char *db)
+      : conn(connection), host(hostname), port(port), user(user), password(password), db(db) {}
+
+    bool start();
+    bool step();
+    void cancel();
+
+    bool await_resume() const
+    {
+      return !failed;
+    }
+
+  private:
+    ESP32_MySQL_Connection *conn;
+    const char  *host;
+    uint16_t    port;
+    char        *user;
+    char        *password;
+    char        *db;
+    bool        auth_sent = false;
+};
+
+class ESP32_MySQL_Execute_Op : public ESP32_MySQL_Operation
+{
+  public:
+    ESP32_MySQL_Execute_Op(ESP32_MySQL_Query *query, const char *sql) : query(query), sql(sql) {}
+
+    bool start();
+    bool step();
+    void cancel()
+    {
+      query->abort();
+    }
+
+    bool await_resume() const
+    {
+      return !failed;
+    }
+
+  private:
+    ESP32_MySQL_Query *query;
+    const char        *sql;
+};
+
+#ifdef WITH_SELECT
+
+class ESP32_MySQL_Columns_Op : public ESP32_MySQL_Operation
+{
+  public:
+    ESP32_MySQL_Columns_Op(ESP32_MySQL_Query *query) : query(query) {}
+
+    bool start();
+    bool step();
+    void cancel()
+    {
+      query->abort();
+    }
+
+    column_names *await_resume() const
+    {
+      return failed ? NULL : columns;
+    }
+
+  private:
+    ESP32_MySQL_Query *query;
+    column_names      *columns = NULL;
+};
+
+class ESP32_MySQL_Row_Op : public ESP32_MySQL_Operation
+{
+  public:
+    ESP32_MySQL_Row_Op(ESP32_MySQL_Query *query) : query(query) {}
+
+    bool start();
+    bool step();
+    void cancel()
+    {
+      query->abort();
+    }
+
+    row_values *await_resume() const
+    {
+      return failed ? NULL : row;
+    }
+
+  private:
+    ESP32_MySQL_Query *query;
+    row_values        *row = NULL;
+};
+
+#endif    // WITH_SELECT
+
+class ESP32_MySQL_Sleep_Op : public ESP32_MySQL_Operation
+{
+  public:
+    ESP32_MySQL_Sleep_Op(const uint32_t& ms) : wake(millis() + ms) {}
+
+    bool step()
+    {
+      return (long) (millis() - wake) >= 0;
+    }
+
+    void await_resume() const {}
+
+  private:
+    unsigned long wake;
+};
+
+inline ESP32_MySQL_Connect_Op async_connect(ESP32_MySQL_Connection *conn, const char *hostname, const uint16_t& port,
+                                            char *user, char *password, char *db = NULL)
+{
+  return ESP32_MySQL_Connect_Op(conn, hostname, port, user, password, db);
+}
+
+inline ESP32_MySQL_Execute_Op async_execute(ESP32_MySQL_Query *query, const char *sql)
+{
+  return ESP32_MySQL_Execute_Op(query, sql);
+}
+
+#ifdef WITH_SELECT
+
+inline ESP32_MySQL_Columns_Op async_get_columns(ESP32_MySQL_Query *query)
+{
+  return ESP32_MySQL_Columns_Op(query);
+}
+
+inline ESP32_MySQL_Row_Op async_get_next_row(ESP32_MySQL_Query *query)
+{
+  return ESP32_MySQL_Row_Op(query);
+}
+
+#endif    // WITH_SELECT
+
+inline ESP32_MySQL_Sleep_Op async_sleep(const uint32_t& ms)
+{
+  return ESP32_MySQL_Sleep_Op(ms);
+}
+
+#endif    // ESP32_MYSQL_HAS_COROUTINES
+
+#endif    // ESP32_MYSQL_COROUTINE_H
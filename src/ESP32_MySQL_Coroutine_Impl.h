@@ -0,0 +1,314 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Coroutine_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_COROUTINE_IMPL_H
+#define ESP32_MYSQL_COROUTINE_IMPL_H
+
+#include <ESP32_MySQL_Coroutine.h>
+
+#ifdef ESP32_MYSQL_HAS_COROUTINES
+
+/*
+  await_suspend - park the awaiting coroutine in its scheduler slot
+
+  Returns bool - False = resume immediately (start() failed or the
+                 coroutine is not running under a scheduler)
+*/
+bool ESP32_MySQL_Operation::await_suspend(std::coroutine_handle<ESP32_MySQL_Promise> handle)
+{
+  ESP32_MySQL_Promise& promise = handle.promise();
+
+  if (!promise.scheduler)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Operation: coroutine was not spawned on a scheduler");
+    failed = true;
+
+    return false;
+  }
+
+  if (!start())
+    return false;
+
+  return promise.scheduler->wait(promise.slot, this);
+}
+
+//////////////////////////////////////////////////////////////
+
+ESP32_MySQL_Scheduler::ESP32_MySQL_Scheduler()
+{
+  count = 0;
+
+  for (int i = 0; i < ESP32_MYSQL_MAX_COROUTINES; i++)
+  {
+    slots[i].handle = NULL;
+    slots[i].op     = NULL;
+  }
+}
+
+ESP32_MySQL_Scheduler::~ESP32_MySQL_Scheduler()
+{
+  for (int i = 0; i < ESP32_MYSQL_MAX_COROUTINES; i++)
+  {
+    if (slots[i].handle)
+      slots[i].handle.destroy();
+  }
+}
+
+/*
+  spawn - hand a conversation to the scheduler
+
+  The coroutine runs from its first statement on the next run_once().
+
+  Returns bool - False = all ESP32_MYSQL_MAX_COROUTINES slots are busy
+*/
+bool ESP32_MySQL_Scheduler::spawn(ESP32_MySQL_Task task)
+{
+  for (int i = 0; i < ESP32_MYSQL_MAX_COROUTINES; i++)
+  {
+    if (!slots[i].handle)
+    {
+      slots[i].handle = task.release();
+      slots[i].op     = NULL;
+      slots[i].handle.promise().scheduler = this;
+      slots[i].handle.promise().slot      = i;
+      count++;
+
+      return true;
+    }
+  }
+
+  ESP32_MYSQL_LOGERROR("ESP32_MySQL_Scheduler::spawn: no free slot");
+
+  return false;
+}
+
+bool ESP32_MySQL_Scheduler::wait(const uint8_t& slot, ESP32_MySQL_Operation *op)
+{
+  if ((slot >= ESP32_MYSQL_MAX_COROUTINES) || !slots[slot].handle)
+    return false;
+
+  slots[slot].op = op;
+
+  return true;
+}
+
+/*
+  run_once - one pass over all conversations
+
+  Resumes every coroutine that is runnable, whose connection has a whole
+  packet waiting and whose operation completed with it, or whose wait
+  timed out. Each step reads one packet, so no step waits on the server.
+
+  Returns bool - True = conversations remain
+*/
+bool ESP32_MySQL_Scheduler::run_once()
+{
+  for (int i = 0; i < ESP32_MYSQL_MAX_COROUTINES; i++)
+  {
+    Slot& slot = slots[i];
+
+    if (!slot.handle)
+      continue;
+
+    ESP32_MySQL_Operation *op = slot.op;
+
+    if (op)
+    {
+      if ( (op->source == NULL) || op->source->packet_ready() )
+      {
+        if (!op->step())
+          continue;
+      }
+      else if ( (op->deadline != 0) && ((long) (millis() - op->deadline) >= 0) )
+      {
+        ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Scheduler: operation timed out, slot =", i);
+        op->cancel();
+        op->failed = true;
+      }
+      else
+      {
+        continue;
+      }
+    }
+
+    slot.op = NULL;
+    slot.handle.resume();
+
+    if (slot.handle.done())
+    {
+      slot.handle.destroy();
+      slot.handle = NULL;
+      count--;
+    }
+  }
+
+  return count > 0;
+}
+
+/*
+  run - drive all conversations until every one has finished
+*/
+void ESP32_MySQL_Scheduler::run()
+{
+  while (run_once())
+  {
+    yield();
+  }
+}
+
+//////////////////////////////////////////////////////////////
+
+/*
+  ESP32_MySQL_Connect_Op - connect() split at every server round trip
+
+  The TCP connect (a single attempt) and a TLS handshake still block, the
+  greeting and the authentication verdict are awaited without blocking.
+*/
+bool ESP32_MySQL_Connect_Op::start()
+{
+  ESP32_MYSQL_LOGWARN3("Connecting to Server:", host, ", Port = ", port);
+
+  conn->reset_for_connect();
+
+  if (conn->wants_tls())
+    conn->enable_tls(true, host);
+
+  conn->cache_password(password);
+  conn->remember_login(host, port, user, db);
+
+  if (conn->client->connect(host, port) != SUCCESS)
+  {
+    ESP32_MYSQL_LOGERROR("Can't connect.");
+    failed = true;
+
+    return false;
+  }
+
+  conn->refresh_socket_fd();
+
+  source   = conn;
+  deadline = millis() + ESP32_MYSQL_ASYNC_TIMEOUT;
+
+  return true;
+}
+
+bool ESP32_MySQL_Connect_Op::step()
+{
+  if (!auth_sent)
+  {
+    if (!conn->start_session(user, password, db))
+    {
+      failed = true;
+      return true;
+    }
+
+    auth_sent = true;
+    deadline  = millis() + ESP32_MYSQL_ASYNC_TIMEOUT;
+
+    return false;
+  }
+
+  failed = !conn->finish_session();
+
+  return true;
+}
+
+// No greeting or verdict in time: don't leave the socket half open
+void ESP32_MySQL_Connect_Op::cancel()
+{
+  conn->close();
+}
+
+//////////////////////////////////////////////////////////////
+
+bool ESP32_MySQL_Execute_Op::start()
+{
+  if (!query->send(sql))
+  {
+    failed = true;
+    return false;
+  }
+
+  source   = query->connection();
+  deadline = millis() + ESP32_MYSQL_ASYNC_TIMEOUT;
+
+  return true;
+}
+
+bool ESP32_MySQL_Execute_Op::step()
+{
+  failed = !query->read_result();
+
+  return true;
+}
+
+//////////////////////////////////////////////////////////////
+
+#ifdef WITH_SELECT
+
+bool ESP32_MySQL_Columns_Op::start()
+{
+  if (!query->start_columns())
+  {
+    failed = true;
+    return false;
+  }
+
+  source   = query->connection();
+  deadline = millis() + ESP32_MYSQL_ASYNC_TIMEOUT;
+
+  return true;
+}
+
+// One column definition, or the EOF after them, per step
+bool ESP32_MySQL_Columns_Op::step()
+{
+  const int res = query->read_column();
+
+  if (res == ESP32_MYSQL_OK_PACKET)
+  {
+    deadline = millis() + ESP32_MYSQL_ASYNC_TIMEOUT;
+    return false;
+  }
+
+  columns = query->get_column_list();
+  failed  = (res != ESP32_MYSQL_EOF_PACKET);
+
+  return true;
+}
+
+//////////////////////////////////////////////////////////////
+
+bool ESP32_MySQL_Row_Op::start()
+{
+  source   = query->connection();
+  deadline = millis() + ESP32_MYSQL_ASYNC_TIMEOUT;
+
+  return true;
+}
+
+bool ESP32_MySQL_Row_Op::step()
+{
+  row = query->get_next_row();
+
+  return true;
+}
+
+#endif    // WITH_SELECT
+
+#endif    // ESP32_MYSQL_HAS_COROUTINES
+
+#endif    // ESP32_MYSQL_COROUTINE_IMPL_H
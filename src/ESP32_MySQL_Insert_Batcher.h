@@ -0,0 +1,297 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Insert_Batcher.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Multi-row INSERT batching
+
+  Collects rows for one table as "(...),(...)" tuples of a single
+  INSERT, written straight into a packet buffer allocated once, so
+  hundreds of samples cost one round trip instead of one each:
+
+    ESP32_MySQL_Insert_Batcher batcher(&conn, "test.readings", "sensor, value, note");
+
+    batcher.add_row(sensor_id, temperature, "ok");    // in the sampling loop
+    batcher.flush_if_due();                           // in loop()
+
+  Integers, float and double are written as numbers, strings are quoted
+  and escaped, nullptr is NULL. A non-finite float or double is NULL too.
+
+  The INSERT goes out by itself when the next row would not fit in
+  max_bytes, when max_rows rows are waiting, or when the oldest row is
+  max_age_ms old (checked by add_row() and flush_if_due()). flush()
+  sends it at once.
+
+  If the server rejects the INSERT, its rows are dropped and counted in
+  stats().failed_rows. If the connection fails they stay, and add_row()
+  returns false once nothing more fits. Rows still waiting when the
+  batcher is destroyed are lost, so flush() first.
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_INSERT_BATCHER_H
+#define ESP32_MYSQL_INSERT_BATCHER_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <type_traits>
+
+#include <ESP32_MySQL_Connection.h>
+
+#ifndef ESP32_MYSQL_BATCHER_BYTES
+  #define ESP32_MYSQL_BATCHER_BYTES     4096      // packet buffer, the largest INSERT sent
+#endif
+
+#ifndef ESP32_MYSQL_BATCHER_ROWS
+  #define ESP32_MYSQL_BATCHER_ROWS      200       // rows per INSERT
+#endif
+
+#ifndef ESP32_MYSQL_BATCHER_AGE_MS
+  #define ESP32_MYSQL_BATCHER_AGE_MS    5000      // longest wait of a row
+#endif
+
+// Why an INSERT was sent
+typedef enum
+{
+  BATCHER_FLUSH_CALL = 0,     // flush()
+  BATCHER_FLUSH_BYTES,        // the next row did not fit
+  BATCHER_FLUSH_ROWS,         // max_rows reached
+  BATCHER_FLUSH_AGE,          // oldest row max_age_ms old
+  BATCHER_FLUSH_REASONS
+} Batcher_Flush_Reason;
+
+// A value of add_values()
+typedef struct
+{
+  uint8_t       type;           // MYSQL_TYPE_LONGLONG, _FLOAT, _DOUBLE, _STRING or _NULL
+  bool          is_unsigned;    // MYSQL_TYPE_LONGLONG in value.u
+  union
+  {
+    int64_t     i;
+    uint64_t    u;
+    double      d;
+  } value;
+  const char    *text;          // MYSQL_TYPE_STRING, not copied
+} Batcher_Value;
+
+typedef struct
+{
+  uint32_t flushes;                             // INSERTs answered with Ok
+  uint32_t rows;                                // rows in those
+  uint32_t failed_flushes;                      // rejected or not answered
+  uint32_t failed_rows;                         // rows dropped with a rejected INSERT
+  uint32_t reasons[BATCHER_FLUSH_REASONS];      // flushes by Batcher_Flush_Reason
+  uint32_t last_flush_ms;                       // round trip of the last INSERT
+  uint32_t max_flush_ms;
+  uint32_t max_bytes_used;                      // largest INSERT sent
+} Batcher_Stats;
+
+class ESP32_MySQL_Insert_Batcher
+{
+  public:
+    ESP32_MySQL_Insert_Batcher(ESP32_MySQL_Connection *connection, const char *table, const char *columns,
+                               const uint16_t& max_rows = ESP32_MYSQL_BATCHER_ROWS,
+                               const uint32_t& max_age_ms = ESP32_MYSQL_BATCHER_AGE_MS,
+                               const size_t& max_bytes = ESP32_MYSQL_BATCHER_BYTES);
+    ~ESP32_MySQL_Insert_Batcher();
+
+    /*
+      add_row - append one row, a value per column
+
+      Returns bool - False = wrong number of values, row too large for
+                     max_bytes, or no room while the connection is down
+    */
+    template <typename... Args>
+    bool add_row(const Args&... values)
+    {
+      if (sizeof...(values) != num_columns)
+      {
+        ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Insert_Batcher::add_row: values expected =", num_columns);
+        return false;
+      }
+
+      return add([&]() { return append_all(values...); });
+    }
+
+    // add_row() with the values and their types known at run time
+    bool add_values(const Batcher_Value *values, const uint16_t& count);
+
+    bool flush();
+    bool flush_if_due();
+
+    // Appended to every INSERT, e.g. " ON DUPLICATE KEY UPDATE v = VALUES(v)"
+    bool set_suffix(const char *sql);
+
+    uint16_t pending_rows() const
+    {
+      return num_rows;
+    }
+
+    // Values add_row() and add_values() take per row
+    uint16_t column_count() const
+    {
+      return num_columns;
+    }
+
+    // Drops the waiting rows
+    void clear()
+    {
+      num_rows  = 0;
+      len       = prefix_len;
+    }
+
+    const Batcher_Stats& stats() const
+    {
+      return batch_stats;
+    }
+
+    void reset_stats()
+    {
+      memset(&batch_stats, 0, sizeof(batch_stats));
+    }
+
+    ESP32_MySQL_Connection *connection()
+    {
+      return conn;
+    }
+
+  private:
+    /*
+      add - append the row written by append_row(), sending the waiting
+            rows first if it does not fit
+    */
+    template <typename F>
+    bool add(const F& append_row)
+    {
+      const size_t row_start = len;
+
+      if ( !(begin_row() && append_row() && end_row()) )
+      {
+        len = row_start;
+
+        if (num_rows == 0)
+        {
+          ESP32_MYSQL_LOGERROR("ESP32_MySQL_Insert_Batcher: row larger than max_bytes");
+          return false;
+        }
+
+        // Send what we have and try again in an empty buffer
+        send(BATCHER_FLUSH_BYTES);
+
+        if (num_rows > 0)
+          return false;
+
+        if ( !(begin_row() && append_row() && end_row()) )
+        {
+          len = prefix_len;
+          ESP32_MYSQL_LOGERROR("ESP32_MySQL_Insert_Batcher: row larger than max_bytes");
+          return false;
+        }
+      }
+
+      if (num_rows++ == 0)
+        first_row_ms = millis();
+
+      if (num_rows >= max_rows)
+        send(BATCHER_FLUSH_ROWS);
+      else
+        flush_if_due();
+
+      return true;
+    }
+
+    bool  send(const Batcher_Flush_Reason& reason);
+    bool  begin_row();
+    bool  end_row();
+    bool  append(const char *text, const size_t& text_len);
+    bool  append_int(const int64_t& value);
+    bool  append_uint(const uint64_t& value);
+    bool  append_double(const double& value, const int& digits);
+    bool  append_string(const char *value);
+
+    // Appends values, a comma before all but the first
+    bool append_all()
+    {
+      return true;
+    }
+
+    template <typename T, typename... Rest>
+    bool append_all(const T& value, const Rest&... rest)
+    {
+      if ( (sizeof...(rest) + 1 < num_columns) && !append(",", 1) )
+        return false;
+
+      return append_value(value) && append_all(rest...);
+    }
+
+    // One overload per value type
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, bool>::type
+    append_value(const T& value)
+    {
+      return append_int((int64_t) value);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, bool>::type
+    append_value(const T& value)
+    {
+      return append_uint((uint64_t) value);
+    }
+
+    bool append_value(const float& value)
+    {
+      return append_double(value, 9);
+    }
+
+    bool append_value(const double& value)
+    {
+      return append_double(value, 17);
+    }
+
+    bool append_value(const char *value)
+    {
+      return append_string(value);
+    }
+
+    bool append_value(const String& value)
+    {
+      return append_string(value.c_str());
+    }
+
+    bool append_value(const std::nullptr_t&)
+    {
+      return append("NULL", 4);
+    }
+
+    ESP32_MySQL_Connection *conn;
+
+    // COM_QUERY packet: header, command, "INSERT INTO t (c) VALUES ", rows
+    char      *buffer;
+    size_t    size;
+    size_t    len;
+    size_t    prefix_len;
+    char      *suffix;
+    size_t    suffix_len;
+
+    uint16_t  num_columns;
+    uint16_t  num_rows;
+    uint16_t  max_rows;
+    uint32_t  max_age_ms;
+    uint32_t  first_row_ms;
+
+    Batcher_Stats batch_stats;
+};
+
+#endif    // ESP32_MYSQL_INSERT_BATCHER_H
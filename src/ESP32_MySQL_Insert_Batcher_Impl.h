@@ -0,0 +1,382 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Insert_Batcher_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_INSERT_BATCHER_IMPL_H
+#define ESP32_MYSQL_INSERT_BATCHER_IMPL_H
+
+#include <math.h>
+
+#include <ESP32_MySQL_Insert_Batcher.h>
+
+/*
+  ESP32_MySQL_Insert_Batcher
+
+  table[in]       table name, e.g. "test.readings", copied into the buffer
+  columns[in]     column list, e.g. "sensor, value", copied into the buffer
+  max_rows[in]    (optional) rows per INSERT
+  max_age_ms[in]  (optional) longest wait of a row
+  max_bytes[in]   (optional) size of the packet buffer, allocated here
+*/
+ESP32_MySQL_Insert_Batcher::ESP32_MySQL_Insert_Batcher(ESP32_MySQL_Connection *connection, const char *table,
+                                                       const char *columns, const uint16_t& max_rows,
+                                                       const uint32_t& max_age_ms, const size_t& max_bytes)
+{
+  conn                = connection;
+  size                = max_bytes;
+  len                 = 0;
+  prefix_len          = 0;
+  suffix              = NULL;
+  suffix_len          = 0;
+  num_columns         = 1;
+  num_rows            = 0;
+  this->max_rows      = (max_rows == 0) ? 1 : max_rows;
+  this->max_age_ms    = max_age_ms;
+  first_row_ms        = 0;
+
+  memset(&batch_stats, 0, sizeof(batch_stats));
+
+  for (const char *c = columns; *c; c++)
+  {
+    if (*c == ',')
+      num_columns++;
+  }
+
+  buffer = (char *) malloc(size);
+
+  // Header, filled in by send()
+  if ( !buffer || !append("\0\0\0\0", 4) || !append("\x03", 1) || !append("INSERT INTO ", 12) ||
+       !append(table, strlen(table)) || !append(" (", 2) || !append(columns, strlen(columns)) ||
+       !append(") VALUES ", 9) )
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Insert_Batcher: out of memory or max_bytes too small");
+
+    free(buffer);
+    buffer  = NULL;
+    size    = 0;
+    len     = 0;
+  }
+
+  prefix_len = len;
+}
+
+ESP32_MySQL_Insert_Batcher::~ESP32_MySQL_Insert_Batcher()
+{
+  if (num_rows > 0)
+    ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Insert_Batcher: rows not sent =", num_rows);
+
+  free(buffer);
+  free(suffix);
+}
+
+/*
+  set_suffix - SQL appended to every INSERT
+
+  Only while no rows are waiting, as it has to fit in max_bytes with them.
+
+  sql[in]         e.g. " ON DUPLICATE KEY UPDATE v = VALUES(v)", copied;
+                  NULL = none
+
+  Returns bool - True = suffix stored
+*/
+bool ESP32_MySQL_Insert_Batcher::set_suffix(const char *sql)
+{
+  if (num_rows > 0)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Insert_Batcher::set_suffix: rows waiting, flush() first");
+    return false;
+  }
+
+  const size_t sql_len = sql ? strlen(sql) : 0;
+  char *copy = NULL;
+
+  if (sql_len > 0)
+  {
+    copy = (char *) malloc(sql_len);
+
+    if (!copy)
+      return false;
+
+    memcpy(copy, sql, sql_len);
+  }
+
+  free(suffix);
+  suffix      = copy;
+  suffix_len  = sql_len;
+
+  return true;
+}
+
+/*
+  add_values - append one row of count values
+
+  Returns bool - as add_row()
+*/
+bool ESP32_MySQL_Insert_Batcher::add_values(const Batcher_Value *values, const uint16_t& count)
+{
+  if (count != num_columns)
+  {
+    ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Insert_Batcher::add_values: values expected =", num_columns);
+    return false;
+  }
+
+  return add([&]()
+  {
+    for (uint16_t i = 0; i < count; i++)
+    {
+      const Batcher_Value& v = values[i];
+      bool ok;
+
+      if ( (i > 0) && !append(",", 1) )
+        return false;
+
+      switch (v.type)
+      {
+        case MYSQL_TYPE_LONGLONG:
+          ok = v.is_unsigned ? append_uint(v.value.u) : append_int(v.value.i);
+          break;
+
+        case MYSQL_TYPE_FLOAT:
+          ok = append_double(v.value.d, 9);
+          break;
+
+        case MYSQL_TYPE_DOUBLE:
+          ok = append_double(v.value.d, 17);
+          break;
+
+        case MYSQL_TYPE_STRING:
+          ok = append_string(v.text);
+          break;
+
+        default:
+          ok = append("NULL", 4);
+          break;
+      }
+
+      if (!ok)
+        return false;
+    }
+
+    return true;
+  });
+}
+
+/*
+  flush - send the waiting rows now
+
+  Returns bool - True = rows inserted, or none waiting
+*/
+bool ESP32_MySQL_Insert_Batcher::flush()
+{
+  return send(BATCHER_FLUSH_CALL);
+}
+
+/*
+  flush_if_due - send the waiting rows if the oldest is max_age_ms old
+
+  Call it from loop(), so rows don't wait for the next add_row().
+
+  Returns bool - False = a due INSERT failed
+*/
+bool ESP32_MySQL_Insert_Batcher::flush_if_due()
+{
+  if ( (num_rows > 0) && ((uint32_t) (millis() - first_row_ms) >= max_age_ms) )
+    return send(BATCHER_FLUSH_AGE);
+
+  return true;
+}
+
+/*
+  send - one COM_QUERY with all waiting rows
+
+  The packet goes out from our buffer as it is, without a copy into the
+  connection buffer. An Ok or error packet empties the buffer; without
+  an answer the rows stay for the next attempt.
+
+  Returns bool - True = Ok packet, or no rows
+*/
+bool ESP32_MySQL_Insert_Batcher::send(const Batcher_Flush_Reason& reason)
+{
+  if (num_rows == 0)
+    return true;
+
+  // end_row() kept room for it
+  if (suffix)
+    memcpy(&buffer[len], suffix, suffix_len);
+
+  const size_t packet_len = len + suffix_len;
+
+  conn->store_int((byte *) buffer, packet_len - 4, 3);
+  buffer[3] = 0x00;
+
+  batch_stats.reasons[reason]++;
+
+  ESP32_MySQL_Lock_Guard guard(conn);
+
+  const uint32_t start = millis();
+  bool answered = false;
+  bool inserted = false;
+
+  if (!guard.owns_lock())
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Insert_Batcher: connection busy");
+  }
+  else if (!conn->keepalive())
+  {
+    ESP32_MYSQL_LOGERROR(NOT_CONNECTED);
+  }
+  else if ( !conn->write_bytes((const uint8_t *) buffer, packet_len) || !conn->read_packet() || (conn->packet_len <= 0) )
+  {
+    // A partial write or a late answer would desynchronize the connection
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Insert_Batcher: no answer");
+    conn->close();
+  }
+  else
+  {
+    answered = true;
+    conn->set_io_state(IO_IDLE);
+
+    if (conn->get_packet_type() == ESP32_MYSQL_OK_PACKET)
+      inserted = true;
+    else
+      conn->parse_error_packet();
+  }
+
+  if (inserted)
+  {
+    const uint32_t elapsed = millis() - start;
+
+    batch_stats.flushes++;
+    batch_stats.rows += num_rows;
+    batch_stats.last_flush_ms = elapsed;
+
+    if (elapsed > batch_stats.max_flush_ms)
+      batch_stats.max_flush_ms = elapsed;
+
+    if (packet_len > batch_stats.max_bytes_used)
+      batch_stats.max_bytes_used = packet_len;
+  }
+  else
+  {
+    batch_stats.failed_flushes++;
+
+    if (answered)
+      batch_stats.failed_rows += num_rows;
+  }
+
+  ESP32_MYSQL_LOGDEBUG3("ESP32_MySQL_Insert_Batcher: rows =", num_rows, ", bytes =", packet_len);
+
+  if (answered)
+    clear();
+
+  return inserted;
+}
+
+bool ESP32_MySQL_Insert_Batcher::begin_row()
+{
+  return (num_rows > 0) ? append(",(", 2) : append("(", 1);
+}
+
+// Closes the row, if the suffix still fits after it
+bool ESP32_MySQL_Insert_Batcher::end_row()
+{
+  return append(")", 1) && (len + suffix_len <= size);
+}
+
+bool ESP32_MySQL_Insert_Batcher::append(const char *text, const size_t& text_len)
+{
+  if (len + text_len > size)
+    return false;
+
+  memcpy(&buffer[len], text, text_len);
+  len += text_len;
+
+  return true;
+}
+
+bool ESP32_MySQL_Insert_Batcher::append_int(const int64_t& value)
+{
+  char text[24];
+
+  return append(text, snprintf(text, sizeof(text), "%lld", (long long) value));
+}
+
+bool ESP32_MySQL_Insert_Batcher::append_uint(const uint64_t& value)
+{
+  char text[24];
+
+  return append(text, snprintf(text, sizeof(text), "%llu", (unsigned long long) value));
+}
+
+/*
+  append_double - text that reads back as the same value
+
+  digits[in]      significant digits, 9 for float, 17 for double
+*/
+bool ESP32_MySQL_Insert_Batcher::append_double(const double& value, const int& digits)
+{
+  if (!isfinite(value))
+    return append("NULL", 4);
+
+  char text[32];
+
+  return append(text, snprintf(text, sizeof(text), "%.*g", digits, value));
+}
+
+/*
+  append_string - quoted string literal
+
+  Escapes the characters MySQL's string parser treats specially, for
+  servers without NO_BACKSLASH_ESCAPES in sql_mode.
+*/
+bool ESP32_MySQL_Insert_Batcher::append_string(const char *value)
+{
+  if (!value)
+    return append("NULL", 4);
+
+  if (!append("'", 1))
+    return false;
+
+  for (const char *c = value; *c; c++)
+  {
+    char escaped = 0;
+
+    switch (*c)
+    {
+      case '\'':    escaped = '\'';   break;
+      case '"':     escaped = '"';    break;
+      case '\\':    escaped = '\\';   break;
+      case '\n':    escaped = 'n';    break;
+      case '\r':    escaped = 'r';    break;
+      case '\x1a':  escaped = 'Z';    break;
+    }
+
+    if (escaped)
+    {
+      const char pair[2] = { '\\', escaped };
+
+      if (!append(pair, 2))
+        return false;
+    }
+    else if (!append(c, 1))
+    {
+      return false;
+    }
+  }
+
+  return append("'", 1);
+}
+
+#endif    // ESP32_MYSQL_INSERT_BATCHER_IMPL_H
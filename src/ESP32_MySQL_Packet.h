@@ -32,14 +32,102 @@
 #define ESP32_MYSQL_OK_PACKET         0x00
 #define ESP32_MYSQL_EOF_PACKET        0xfe
 #define ESP32_MYSQL_ERROR_PACKET      0xff
+#define ESP32_MYSQL_LOCAL_INFILE_PACKET 0xfb    // the server asks for a LOAD DATA LOCAL INFILE file
 
-#define MAX_TRANSMISSION_UNIT   1500
+// Command codes (first payload byte of a command packet)
+#define ESP32_MYSQL_COM_INIT_DB       0x02
+#define ESP32_MYSQL_COM_QUERY         0x03
+#define ESP32_MYSQL_COM_PING          0x0e
+#define ESP32_MYSQL_COM_CHANGE_USER   0x11
+#define ESP32_MYSQL_COM_STMT_PREPARE  0x16
+#define ESP32_MYSQL_COM_STMT_EXECUTE  0x17
+#define ESP32_MYSQL_COM_STMT_SEND_LONG_DATA 0x18
+#define ESP32_MYSQL_COM_STMT_BULK_EXECUTE   0xfa    // MariaDB 10.2+
+#define ESP32_MYSQL_COM_STMT_CLOSE    0x19
+#define ESP32_MYSQL_COM_STMT_RESET    0x1a
+#define ESP32_MYSQL_COM_STMT_FETCH    0x1c
+#define ESP32_MYSQL_COM_RESET_CONNECTION  0x1f
+
+// Column and parameter types of the binary protocol
+typedef enum
+{
+  MYSQL_TYPE_DECIMAL      = 0x00,
+  MYSQL_TYPE_TINY         = 0x01,
+  MYSQL_TYPE_SHORT        = 0x02,
+  MYSQL_TYPE_LONG         = 0x03,
+  MYSQL_TYPE_FLOAT        = 0x04,
+  MYSQL_TYPE_DOUBLE       = 0x05,
+  MYSQL_TYPE_NULL         = 0x06,
+  MYSQL_TYPE_TIMESTAMP    = 0x07,
+  MYSQL_TYPE_LONGLONG     = 0x08,
+  MYSQL_TYPE_INT24        = 0x09,
+  MYSQL_TYPE_DATE         = 0x0a,
+  MYSQL_TYPE_TIME         = 0x0b,
+  MYSQL_TYPE_DATETIME     = 0x0c,
+  MYSQL_TYPE_YEAR         = 0x0d,
+  MYSQL_TYPE_VARCHAR      = 0x0f,
+  MYSQL_TYPE_BIT          = 0x10,
+  MYSQL_TYPE_JSON         = 0xf5,
+  MYSQL_TYPE_NEWDECIMAL   = 0xf6,
+  MYSQL_TYPE_ENUM         = 0xf7,
+  MYSQL_TYPE_SET          = 0xf8,
+  MYSQL_TYPE_TINY_BLOB    = 0xf9,
+  MYSQL_TYPE_MEDIUM_BLOB  = 0xfa,
+  MYSQL_TYPE_LONG_BLOB    = 0xfb,
+  MYSQL_TYPE_BLOB         = 0xfc,
+  MYSQL_TYPE_VAR_STRING   = 0xfd,
+  MYSQL_TYPE_STRING       = 0xfe,
+  MYSQL_TYPE_GEOMETRY     = 0xff
+} MySQL_Type;
+
+// DATE, DATETIME, TIMESTAMP and TIME values
+typedef struct
+{
+  uint16_t  year;
+  uint8_t   month;
+  uint8_t   day;          // TIME: whole days
+  uint8_t   hour;
+  uint8_t   minute;
+  uint8_t   second;
+  uint32_t  microsecond;
+  bool      negative;     // TIME only
+} MySQL_DateTime;
+
+// Column definition flags
+#define NOT_NULL_FLAG           0x0001
+#define PRI_KEY_FLAG            0x0002
+#define UNIQUE_KEY_FLAG         0x0004
+#define MULTIPLE_KEY_FLAG       0x0008
+#define BLOB_FLAG               0x0010
+#define UNSIGNED_FLAG           0x0020
+#define ZEROFILL_FLAG           0x0040
+#define BINARY_FLAG             0x0080
+#define ENUM_FLAG               0x0100
+#define AUTO_INCREMENT_FLAG     0x0200
+#define TIMESTAMP_FLAG          0x0400
+#define SET_FLAG                0x0800
+
+// Server status flags (Ok and EOF packets)
+#define SERVER_STATUS_IN_TRANS          0x0001
+#define SERVER_STATUS_AUTOCOMMIT        0x0002
+#define SERVER_MORE_RESULTS_EXISTS      0x0008
+#define SERVER_STATUS_CURSOR_EXISTS     0x0040
+#define SERVER_STATUS_LAST_ROW_SENT     0x0080
+
+// COM_STMT_EXECUTE flags
+#define CURSOR_TYPE_NO_CURSOR           0x00
+#define CURSOR_TYPE_READ_ONLY           0x01
+
+#ifndef MAX_TRANSMISSION_UNIT
+  #define MAX_TRANSMISSION_UNIT   1500    // largest packet read whole, see ESP32_MySQL_Query::stream_next_row()
+#endif
 
 // Minimal subset of capability bits we need when crafting the handshake response
 #define CLIENT_LONG_PASSWORD                   0x00000001UL
 #define CLIENT_FOUND_ROWS                      0x00000002UL
 #define CLIENT_LONG_FLAG                       0x00000004UL
 #define CLIENT_CONNECT_WITH_DB                 0x00000008UL
+#define CLIENT_LOCAL_FILES                     0x00000080UL
 #define CLIENT_PROTOCOL_41                     0x00000200UL
 #define CLIENT_INTERACTIVE                     0x00000400UL
 #define CLIENT_SSL                             0x00000800UL
@@ -48,8 +136,29 @@
 #define CLIENT_MULTI_STATEMENTS                0x00010000UL
 #define CLIENT_MULTI_RESULTS                   0x00020000UL
 #define CLIENT_PLUGIN_AUTH                     0x00080000UL
+#define CLIENT_SESSION_TRACK                   0x00800000UL
+
+// MariaDB servers clear CLIENT_LONG_PASSWORD (their CLIENT_MYSQL) and send
+// extended capabilities in the last 4 bytes of the handshake filler
+#define MARIADB_CLIENT_STMT_BULK_OPERATIONS    0x00000004UL
+
+// COM_STMT_BULK_EXECUTE flags and value indicators
+#define STMT_BULK_FLAG_SEND_TYPES_TO_SERVER    0x0080
+#define STMT_INDICATOR_NONE                    0x00
+#define STMT_INDICATOR_NULL                    0x01
 ///////
 
+// What a connection is waiting for, for use with an event loop (see ESP32_MySQL_Reactor)
+typedef enum
+{
+  IO_IDLE       = 0,    // no command outstanding
+  IO_WANT_READ,         // waiting for (the rest of) a server response
+  IO_WANT_WRITE         // waiting for the socket to accept data
+} IO_State;
+
+// Socket descriptor of the connected Client, e.g. WiFiClient::fd(); < 0 = none
+typedef int (*Socket_Fd_Provider)(void *context);
+
 enum AuthPlugin
 {
   AUTH_MYSQL_NATIVE_PASSWORD = 0,
@@ -63,7 +172,7 @@ class MySQL_Packet
   public:
     byte *buffer;           // buffer for reading packets
     
-    uint16_t largest_buffer_size = 0;
+    uint32_t largest_buffer_size = 0;
     //////
     
     int packet_len;         // length of current packet
@@ -72,6 +181,8 @@ class MySQL_Packet
     char  auth_plugin[32];  // authentication plugin name advertised by server
     uint8_t auth_plugin_data_len = 0;
     uint32_t server_capabilities = 0;
+    uint32_t server_ext_capabilities = 0;   // MariaDB, MARIADB_CLIENT_xxx
+    uint32_t client_ext_capabilities = 0;   // the ones we asked for
     AuthPlugin auth_plugin_type = AUTH_MYSQL_NATIVE_PASSWORD;
 
     MySQL_Packet(Client *client_instance);
@@ -100,6 +211,8 @@ class MySQL_Packet
     
     bool    complete_handshake(char *user, char *password);
     void    send_authentication_packet(char *user, char *password, char *db = NULL, uint32_t client_flags = 0, uint8_t sequence_id = 0x01);
+    bool    send_change_user_packet(char *user, char *password, char *db = NULL);
+    bool    send_auth_switch_response(char *password);
     void    parse_handshake_packet();
     AuthPlugin get_auth_plugin() const
     {
@@ -108,8 +221,12 @@ class MySQL_Packet
     void    reset_for_connect()
     {
       cache_password(NULL);
+      sock_fd = -1;
+      io_state = IO_IDLE;
       ssl_request_sent = false;
       next_sequence_id = 0x01;
+      staged_len = 0;
+      staged_pos = 0;
       tls_established = false;
       cleanup_tls();
     }
@@ -131,8 +248,62 @@ class MySQL_Packet
     {
       return tls_requested;
     }
+    // MariaDB's COM_STMT_BULK_EXECUTE, see ESP32_MySQL_Statement::execute_batch()
+    bool    supports_bulk_execute() const
+    {
+      return (client_ext_capabilities & MARIADB_CLIENT_STMT_BULK_OPERATIONS) != 0;
+    }
     bool    write_bytes(const uint8_t *data, size_t len);
     bool    read_bytes(uint8_t *out, size_t len);
+    int     bytes_available();
+    bool    packet_ready();
+    bool    reserve_buffer(const int& size);
+    
+    // Per-read deadline, ESP32_MYSQL_DATA_TIMEOUT by default
+    uint32_t get_data_timeout() const
+    {
+      return data_timeout;
+    }
+    void    set_data_timeout(const uint32_t& timeout_ms)
+    {
+      data_timeout = timeout_ms;
+    }
+    
+    // Time since the last packet was sent or received
+    uint32_t idle_ms() const
+    {
+      return (uint32_t) (millis() - last_io_ms);
+    }
+    
+    // Readiness as an event source. The Client interface has no descriptor,
+    // and every connect forgets it: give a provider, asked after each
+    // connect, or set it again after each one with set_socket_fd()
+    int     socket_fd() const
+    {
+      return sock_fd;
+    }
+    void    set_socket_fd(int fd)
+    {
+      sock_fd = fd;
+    }
+    void    set_socket_fd_provider(Socket_Fd_Provider provider, void *context = NULL)
+    {
+      fd_provider = provider;
+      fd_context  = context;
+    }
+    void    refresh_socket_fd()
+    {
+      if (fd_provider)
+        sock_fd = fd_provider(fd_context);
+    }
+    IO_State get_io_state() const
+    {
+      return io_state;
+    }
+    void    set_io_state(IO_State state)
+    {
+      io_state = state;
+    }
     uint32_t build_client_flags(bool use_tls) const;
     bool    send_ssl_request(uint32_t client_flags, uint8_t sequence_id = 0x01);
     bool    start_tls_handshake();
@@ -148,6 +319,9 @@ class MySQL_Packet
                                  uint8_t *encrypted, size_t *encrypted_len);
     void    cache_password(const char *password)
     {
+      if (password && (password == cached_password))
+        return;
+
       if (cached_password)
       {
         free(cached_password);
@@ -174,10 +348,13 @@ class MySQL_Packet
     bool    read_packet();
     
     int     get_packet_type();
+    uint16_t get_status_flags();
+    int     skip_result_set();
     void    parse_error_packet();
     int     get_lcb_len(const int& offset);
     int     read_int(const int& offset, const int& size = 0);
     void    store_int(byte *buff, const long& value, const int& size);
+    int     store_lcb_int(byte *buff, const uint32_t& value);
     int     read_lcb_int(const int& offset);
     int     wait_for_bytes(const int& bytes_need);
 
@@ -191,6 +368,15 @@ class MySQL_Packet
     bool ssl_request_sent = false;
     uint8_t next_sequence_id = 0x01;
     char *cached_password = NULL;
+    int sock_fd = -1;
+    Socket_Fd_Provider fd_provider = NULL;
+    void *fd_context = NULL;
+    IO_State io_state = IO_IDLE;
+    uint32_t data_timeout = 0;
+    unsigned long last_io_ms = 0;
+    uint8_t staged_header[4];         // header taken by packet_ready(), read first
+    uint8_t staged_len = 0;
+    uint8_t staged_pos = 0;
     AuthPlugin plugin_from_name(const char *name) const;
     bool cleanup_tls();
     static int tls_send_cb(void *ctx, const unsigned char *buf, size_t len);
@@ -204,6 +390,7 @@ class MySQL_Packet
     mbedtls_ctr_drbg_context tls_ctr_drbg;
     mbedtls_entropy_context tls_entropy;
 #endif
+    uint8_t scramble_for_plugin(char *password, byte *scramble);
     bool scramble_password_caching_sha2(char *password, byte *pwd_hash);
     bool scramble_password_sha256(char *password, byte *pwd_hash);
 };
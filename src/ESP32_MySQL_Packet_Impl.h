@@ -58,6 +58,41 @@ MySQL_Packet::MySQL_Packet(Client *client_instance)
   tls_established = false;
   ssl_request_sent = false;
   next_sequence_id = 0x01;
+  sock_fd = -1;
+  io_state = IO_IDLE;
+  data_timeout = ESP32_MYSQL_DATA_TIMEOUT;
+  last_io_ms = 0;
+}
+
+/*
+  reserve_buffer - make sure the packet buffer holds at least size bytes
+
+  Grows the buffer as needed. The buffer is never shrunk, so repeated
+  commands of similar size reuse the same allocation.
+
+  size[in]        bytes needed (including the 4-byte packet header)
+
+  Returns bool - False = out of memory (the old buffer is kept)
+*/
+bool MySQL_Packet::reserve_buffer(const int& size)
+{
+  if ( (buffer != NULL) && (largest_buffer_size >= (uint32_t) size) )
+    return true;
+
+  byte *grown = (byte *) realloc(buffer, size);
+
+  if (grown == NULL)
+  {
+    ESP32_MYSQL_LOGERROR1("MySQL_Packet::reserve_buffer: can't allocate, size = ", size);
+    return false;
+  }
+
+  ESP32_MYSQL_LOGINFO1("MySQL_Packet::reserve_buffer: size = ", size);
+
+  buffer = grown;
+  largest_buffer_size = size;
+
+  return true;
 }
 
 uint32_t MySQL_Packet::build_client_flags(bool use_tls) const
@@ -113,7 +148,7 @@ int MySQL_Packet::tls_recv_cb(void *ctx, unsigned char *buf, size_t len)
 
   unsigned long start = millis();
 
-  while ((self->client->available() == 0) && ((millis() - start) < ESP32_MYSQL_DATA_TIMEOUT))
+  while ((self->client->available() == 0) && ((millis() - start) < self->data_timeout))
   {
     delay(1);
     yield();
@@ -144,7 +179,7 @@ int MySQL_Packet::blocking_read(unsigned char *buf, size_t len)
   size_t offset = 0;
   unsigned long start = millis();
 
-  while ((offset < len) && ((millis() - start) < ESP32_MYSQL_DATA_TIMEOUT))
+  while ((offset < len) && ((millis() - start) < data_timeout))
   {
     int avail = client->available();
 
@@ -171,7 +206,7 @@ int MySQL_Packet::blocking_read_tls(unsigned char *buf, size_t len)
   size_t offset = 0;
   unsigned long start = millis();
 
-  while ((offset < len) && ((millis() - start) < ESP32_MYSQL_DATA_TIMEOUT))
+  while ((offset < len) && ((millis() - start) < data_timeout))
   {
     int ret = mbedtls_ssl_read(&tls_ctx, buf + offset, len - offset);
 
@@ -205,7 +240,7 @@ int MySQL_Packet::blocking_write_tls(const unsigned char *buf, size_t len)
   size_t offset = 0;
   unsigned long start = millis();
 
-  while ((offset < len) && ((millis() - start) < ESP32_MYSQL_DATA_TIMEOUT))
+  while ((offset < len) && ((millis() - start) < data_timeout))
   {
     int ret = mbedtls_ssl_write(&tls_ctx, buf + offset, len - offset);
 
@@ -215,6 +250,7 @@ int MySQL_Packet::blocking_write_tls(const unsigned char *buf, size_t len)
     }
     else if ((ret == MBEDTLS_ERR_SSL_WANT_READ) || (ret == MBEDTLS_ERR_SSL_WANT_WRITE))
     {
+      io_state = (ret == MBEDTLS_ERR_SSL_WANT_WRITE) ? IO_WANT_WRITE : IO_WANT_READ;
       delay(1);
       yield();
       continue;
@@ -241,12 +277,24 @@ bool MySQL_Packet::write_bytes(const uint8_t *data, size_t len)
   if (tls_established)
   {
     int ret = blocking_write_tls(data, len);
-    return ret == (int) len;
+    
+    if (ret != (int) len)
+      return false;
+      
+    io_state = IO_WANT_READ;
+    last_io_ms = millis();
+    return true;
   }
 
   size_t written = client->write(data, len);
 
-  return written == len;
+  if (written != len)
+    return false;
+
+  // Every packet we send is answered by the server
+  io_state = IO_WANT_READ;
+  last_io_ms = millis();
+  return true;
 }
 
 bool MySQL_Packet::read_bytes(uint8_t *out, size_t len)
@@ -254,9 +302,87 @@ bool MySQL_Packet::read_bytes(uint8_t *out, size_t len)
   if (!client || (out == NULL))
     return false;
 
+  // A header taken by packet_ready() comes first
+  while ( (staged_pos < staged_len) && (len > 0) )
+  {
+    *out++ = staged_header[staged_pos++];
+    len--;
+  }
+
+  if (staged_pos == staged_len)
+  {
+    staged_len = 0;
+    staged_pos = 0;
+  }
+
+  if (len == 0)
+    return true;
+
   int ret = tls_established ? blocking_read_tls(out, len) : blocking_read(out, len);
 
-  return ret == (int) len;
+  if (ret != (int) len)
+    return false;
+
+  last_io_ms = millis();
+
+  return true;
+}
+
+/*
+  bytes_available - number of bytes that can be read without blocking
+
+  Counts data already decrypted by TLS as well as data waiting in the
+  client, so it is safe to use as a readiness check on TLS connections.
+*/
+int MySQL_Packet::bytes_available()
+{
+  if (!client)
+    return 0;
+
+#if defined(ESP32)
+  if (tls_established)
+  {
+    const size_t pending = mbedtls_ssl_get_bytes_avail(&tls_ctx);
+
+    if (pending > 0)
+      return (int) pending;
+  }
+#endif
+
+  return client->available();
+}
+
+/*
+  packet_ready - whether the next packet can be read without blocking
+
+  Once its 4 byte header has arrived, the header is taken off the
+  client, so that the payload length is known, and read_bytes() returns
+  it first. A packet over MAX_TRANSMISSION_UNIT counts as ready, for
+  read_packet() to fail it. On TLS connections any data counts, as the
+  record layer hides how much of the packet has arrived.
+
+  Returns bool - True = header and payload have arrived
+*/
+bool MySQL_Packet::packet_ready()
+{
+  if (tls_established || (staged_pos > 0))
+    return (staged_pos < staged_len) || (bytes_available() > 0);
+
+  if (staged_len == 0)
+  {
+    if (bytes_available() < (int) sizeof(staged_header))
+      return false;
+
+    // Let the read fail in the caller
+    if (!read_bytes(staged_header, sizeof(staged_header)))
+      return true;
+
+    staged_len = sizeof(staged_header);
+  }
+
+  const uint32_t length = staged_header[0] | (staged_header[1] << 8) | ((uint32_t) staged_header[2] << 16);
+
+  return (length > MAX_TRANSMISSION_UNIT) || (bytes_available() >= (int) length);
 }
 
 bool MySQL_Packet::send_ssl_request(uint32_t client_flags, uint8_t sequence_id)
@@ -287,6 +413,10 @@ bool MySQL_Packet::send_ssl_request(uint32_t client_flags, uint8_t sequence_id)
   for (int i = 0; i < 23; i++)
     packet[offset + i] = 0x00;
 
+  // MariaDB extended capabilities
+  if ( !(client_flags & CLIENT_LONG_PASSWORD) )
+    store_int(&packet[offset + 19], client_ext_capabilities, 4);
+
   offset += 23;
 
   ssl_request_sent = write_bytes(packet, offset);
@@ -531,6 +661,10 @@ void MySQL_Packet::send_authentication_packet(char *user, char *password, char *
   for (int i = 0; i < 23; i++)
     this_buffer[size_send + i] = 0x00;
 
+  // MariaDB extended capabilities
+  if ( !(client_flags & CLIENT_LONG_PASSWORD) )
+    store_int(&this_buffer[size_send + 19], client_ext_capabilities, 4);
+
   size_send += 23;
 
   // user name
@@ -538,27 +672,9 @@ void MySQL_Packet::send_authentication_packet(char *user, char *password, char *
   size_send += strlen(user) + 1;
   this_buffer[size_send - 1] = 0x00;
 
-  AuthPlugin plugin = (auth_plugin_type == AUTH_UNKNOWN) ? AUTH_MYSQL_NATIVE_PASSWORD : auth_plugin_type;
-  bool has_scramble = false;
-  uint8_t scramble_len = 0;
-
-  if (plugin == AUTH_CACHING_SHA2_PASSWORD)
-  {
-    has_scramble = scramble_password_caching_sha2(password, scramble);
-    scramble_len = SHA256_HASH_SIZE;
-  }
-  else if (plugin == AUTH_SHA256_PASSWORD)
-  {
-    has_scramble = scramble_password_sha256(password, scramble);
-    scramble_len = SHA256_HASH_SIZE;
-  }
-  else
-  {
-    has_scramble = scramble_password(password, scramble);
-    scramble_len = 20;
-  }
+  const uint8_t scramble_len = scramble_for_plugin(password, scramble);
 
-  if (has_scramble)
+  if (scramble_len > 0)
   {
     this_buffer[size_send] = scramble_len;
     size_send += 1;
@@ -606,6 +722,143 @@ void MySQL_Packet::send_authentication_packet(char *user, char *password, char *
   write_bytes((uint8_t*)this_buffer, size_send);
 }
 
+/*
+  scramble_for_plugin - Scramble the password for the current auth plugin
+
+  password[in]    User's password in clear text
+  scramble[out]   At least SHA256_HASH_SIZE bytes
+
+  Returns uint8_t - scramble length, 0 = empty password
+*/
+uint8_t MySQL_Packet::scramble_for_plugin(char *password, byte *scramble)
+{
+  AuthPlugin plugin = (auth_plugin_type == AUTH_UNKNOWN) ? AUTH_MYSQL_NATIVE_PASSWORD : auth_plugin_type;
+
+  if (plugin == AUTH_CACHING_SHA2_PASSWORD)
+    return scramble_password_caching_sha2(password, scramble) ? SHA256_HASH_SIZE : 0;
+
+  if (plugin == AUTH_SHA256_PASSWORD)
+    return scramble_password_sha256(password, scramble) ? SHA256_HASH_SIZE : 0;
+
+  return scramble_password(password, scramble) ? 20 : 0;
+}
+
+/*
+  send_change_user_packet - Log in again on the open connection
+
+  Sends COM_CHANGE_USER, which ends the current session and starts a new
+  one without a new TCP (and TLS) connection. The password is scrambled
+  with the seed of the original handshake. The server answers like it
+  answers the authentication packet, or with an auth switch request (see
+  send_auth_switch_response()).
+
+  Bytes                        Name
+  -----                        ----
+  1                            command (COM_CHANGE_USER)
+  n (Null-Terminated String)   user
+  n (Length Coded Binary)      scramble_buff (1 + x bytes)
+  n (Null-Terminated String)   databasename
+  2                            charset_number
+  n (Null-Terminated String)   auth plugin name
+
+  user[in]        User name
+  password[in]    password
+  db[in]          default database
+
+  Returns bool - True = packet written
+*/
+bool MySQL_Packet::send_change_user_packet(char *user, char *password, char *db)
+{
+  byte scramble[SHA256_HASH_SIZE];
+
+  const uint8_t scramble_len = scramble_for_plugin(password, scramble);
+  const char *plugin_name = (auth_plugin[0] != 0) ? auth_plugin : "mysql_native_password";
+
+  const size_t user_len   = strlen(user);
+  const size_t db_len     = db ? strlen(db) : 0;
+  const size_t plugin_len = strlen(plugin_name);
+
+  int size_send = 4;
+
+  if (!reserve_buffer(4 + 1 + (user_len + 1) + (1 + scramble_len) + (db_len + 1) + 2 + (plugin_len + 1)))
+    return false;
+
+  buffer[size_send++] = ESP32_MYSQL_COM_CHANGE_USER;
+
+  memcpy(&buffer[size_send], user, user_len + 1);
+  size_send += user_len + 1;
+
+  buffer[size_send++] = scramble_len;
+  memcpy(&buffer[size_send], scramble, scramble_len);
+  size_send += scramble_len;
+
+  if (db)
+    memcpy(&buffer[size_send], db, db_len);
+
+  buffer[size_send + db_len] = 0x00;
+  size_send += db_len + 1;
+
+  // charset - default is 8, as in the authentication packet
+  store_int(&buffer[size_send], 0x08, 2);
+  size_send += 2;
+
+  memcpy(&buffer[size_send], plugin_name, plugin_len + 1);
+  size_send += plugin_len + 1;
+
+  store_int(&buffer[0], size_send - 4, 3);
+  buffer[3] = 0x00;
+
+  return write_bytes(buffer, size_send);
+}
+
+/*
+  send_auth_switch_response - Answer an auth switch request
+
+  The server may ask to continue with another plugin and a new seed
+  (0xfe, plugin name, seed). Adopts both and sends the new scramble.
+
+  password[in]    User's password in clear text
+
+  Returns bool - True = response written
+*/
+bool MySQL_Packet::send_auth_switch_response(char *password)
+{
+  if (!buffer || (packet_len < 2) || (buffer[4] != ESP32_MYSQL_EOF_PACKET))
+    return false;
+
+  const int end = packet_len + 4;
+  int offset = 5;
+
+  while ((offset < end) && (buffer[offset] != 0x00))
+    offset++;
+
+  const size_t name_len = min((size_t) (offset - 5), sizeof(auth_plugin) - 1);
+
+  memcpy(auth_plugin, &buffer[5], name_len);
+  auth_plugin[name_len] = 0;
+  auth_plugin_type = plugin_from_name(auth_plugin);
+
+  // Seed follows the name, usually 20 bytes plus a terminating zero
+  offset++;
+
+  for (int j = 0; (j < 20) && (offset + j < end); j++)
+    seed[j] = buffer[offset + j];
+
+  ESP32_MYSQL_LOGINFO1("Auth switch to", auth_plugin);
+
+  byte response[4 + SHA256_HASH_SIZE];
+
+  const uint8_t scramble_len = scramble_for_plugin(password, &response[4]);
+  const uint8_t sequence_id  = buffer[3] + 1;
+
+  store_int(&response[0], scramble_len, 3);
+  response[3] = sequence_id;
+
+  next_sequence_id = sequence_id + 1;
+
+  return write_bytes(response, 4 + scramble_len);
+}
+
 /*
   scramble_password - Build a SHA1 scramble of the user password
 
@@ -811,37 +1064,14 @@ bool MySQL_Packet::read_packet()
     return false;
   }
 
-  if ( largest_buffer_size < packet_len + PACKET_HEADER_SZ )
-  {
-    if (largest_buffer_size == 0 )
-    {
-      // Check if we need to allocate buffer the first time
-      largest_buffer_size = packet_len + PACKET_HEADER_SZ;
-      ESP32_MYSQL_LOGINFO1("MySQL_Packet::read_packet: First time allocate buffer, size = ", largest_buffer_size);
-      
-      buffer = (byte *) malloc(largest_buffer_size);
-    }
-    else
-    {
-      // Check if we need to reallocate buffer
-      largest_buffer_size = packet_len + PACKET_HEADER_SZ;
-      ESP32_MYSQL_LOGINFO1("MySQL_Packet::read_packet: Reallocate buffer, size = ", largest_buffer_size);
-      
-      buffer = (byte *) realloc(buffer, largest_buffer_size);
-    }
-  }
-  
-  if (buffer == NULL)
+  if ( !reserve_buffer(packet_len + PACKET_HEADER_SZ) )
   {
     ESP32_MYSQL_LOGERROR("MySQL_Packet::read_packet: NULL buffer");
-    largest_buffer_size = 0;
     
     return false;
   }
-  else
-  {
-    memset(buffer, 0, largest_buffer_size);
-  }
+  
+  memset(buffer, 0, largest_buffer_size);
 
   memcpy(buffer, local, PACKET_HEADER_SZ);
 
@@ -854,6 +1084,8 @@ bool MySQL_Packet::read_packet()
     }
   }
 
+  last_io_ms = millis();
+
   ESP32_MYSQL_LOGDEBUG("MySQL_Packet::read_packet: exit");
   
   return true;
@@ -878,7 +1110,9 @@ bool MySQL_Packet::read_packet()
    2                            server_status
    2                            server capabilities (two upper bytes)
    1                            length of the scramble seed
-  10                            (filler)  always 0
+   6                            (filler)  always 0
+   4                            MariaDB: extended capabilities, if
+                                 CLIENT_LONG_PASSWORD is not set
    n                            rest of the plugin provided data
                                 (at least 12 bytes)
    1                            \0 byte, terminating the second part of
@@ -899,6 +1133,7 @@ void MySQL_Packet::parse_handshake_packet()
   auth_plugin_type = AUTH_MYSQL_NATIVE_PASSWORD;
   auth_plugin_data_len = 0;
   server_capabilities = 0;
+  server_ext_capabilities = 0;
 
   // Payload starts after the 4-byte packet header
   size_t offset = 4;
@@ -979,7 +1214,10 @@ void MySQL_Packet::parse_handshake_packet()
     offset++;
   }
 
-  // Reserved bytes
+  // Reserved bytes, MariaDB has its own capabilities in the last four
+  if ( !(server_capabilities & CLIENT_LONG_PASSWORD) && (offset + 10 <= end) )
+    server_ext_capabilities = read_int(offset + 6, 4);
+
   offset += 10;
 
   size_t second_seed_len = (auth_plugin_data_len > 0) ? max((int) auth_plugin_data_len - 8, 12) : 12;
@@ -1018,6 +1256,76 @@ void MySQL_Packet::parse_handshake_packet()
   ESP32_MYSQL_LOGINFO1("Auth plugin from server:", auth_plugin);
 }
 
+/*
+  get_status_flags - Server status of the Ok or EOF packet in the buffer
+
+  Returns uint16_t - SERVER_xxx flags, 0 for other packets
+*/
+uint16_t MySQL_Packet::get_status_flags()
+{
+  if ( !buffer || (packet_len < 1) )
+    return 0;
+
+  // EOF: 0xfe, warnings (2), status (2)
+  if ( (buffer[4] == ESP32_MYSQL_EOF_PACKET) && (packet_len < 9) )
+    return (packet_len >= 5) ? (buffer[7] | (buffer[8] << 8)) : 0;
+
+  if (buffer[4] != ESP32_MYSQL_OK_PACKET)
+    return 0;
+
+  // Ok: 0x00, affected rows (lcb), insert id (lcb), status (2)
+  int offset = 5;
+
+  for (int i = 0; i < 2; i++)
+    offset += get_lcb_len(offset);
+
+  if (offset + 2 > packet_len + 4)
+    return 0;
+
+  return buffer[offset] | (buffer[offset + 1] << 8);
+}
+
+/*
+  skip_result_set - read past the column definitions and rows of a
+                    result set, from the packet after the column count
+
+  An error packet in place of a row ends the result set early; it is
+  parsed and left in the buffer, so get_packet_type() tells it from the
+  final EOF packet.
+
+  Returns integer - rows read, -1 = read failed, the rest still on the way
+*/
+int MySQL_Packet::skip_result_set()
+{
+  int rows = 0;
+  int eofs = 0;
+
+  // Column definitions up to an EOF packet, then rows up to another one
+  while (eofs < 2)
+  {
+    if ( !read_packet() || (packet_len <= 0) )
+      return -1;
+
+    const int type = get_packet_type();
+
+    if ( (type == ESP32_MYSQL_EOF_PACKET) && (packet_len < 9) )
+    {
+      eofs++;
+    }
+    else if ( (type == ESP32_MYSQL_ERROR_PACKET) && (eofs == 1) )
+    {
+      parse_error_packet();
+      break;
+    }
+    else if (eofs == 1)
+    {
+      rows++;
+    }
+  }
+
+  return rows;
+}
+
 /*
   parse_error_packet - Display the error returned from the server
 
@@ -1125,11 +1433,11 @@ int MySQL_Packet::get_packet_type()
   get_lcb_len - Retrieves the length of a length coded binary value
 
   This reads the first byte from the offset into the buffer and returns
-  the number of bytes (size) that the integer consumes. It is used in
-  conjunction with read_int() to read length coded binary integers
-  from the buffer.
+  the number of bytes the length coded binary takes, including that
+  first byte: 1 for values below 251 (and for NULL, 0xfb), 3 after 0xfc,
+  4 after 0xfd and 9 after 0xfe. Use read_lcb_int() for the value.
 
-  Returns integer - number of bytes integer consumes
+  Returns integer - number of bytes the length coded binary consumes
 */
 
 int MySQL_Packet::get_lcb_len(const int& offset) 
@@ -1140,24 +1448,17 @@ int MySQL_Packet::get_lcb_len(const int& offset)
     return 0;
   }
 
-  int read_len = buffer[offset];
+  int read_len = 1;
   
-  if (read_len > 250) 
-  {
-    // read type:
-    byte type = buffer[offset + 1];
-    
-    if (type == 0xfc)
-      read_len = 2;
-    else if (type == 0xfd)
-      read_len = 3;
-    else if (type == 0xfe)
-      read_len = 8;
-  } 
-  else 
-  {
-    read_len = 1;
-  }
+  // read type:
+  byte type = buffer[offset];
+  
+  if (type == 0xfc)
+    read_len = 3;
+  else if (type == 0xfd)
+    read_len = 4;
+  else if (type == 0xfe)
+    read_len = 9;
 
   ESP32_MYSQL_LOGDEBUG1("MySQL_Packet::get_lcb_len: read_len= ", read_len);
 
@@ -1171,7 +1472,8 @@ int MySQL_Packet::get_lcb_len(const int& offset)
   the number of bytes specified (size).
 
   offset[in]      offset from start of buffer
-  size[in]        number of bytes to use to store the integer
+  size[in]        number of bytes to use to store the integer, 0 = a
+                  length coded binary
 
   Returns integer - integer from the buffer
 */
@@ -1179,7 +1481,6 @@ int MySQL_Packet::get_lcb_len(const int& offset)
 int MySQL_Packet::read_int(const int& offset, const int& size) 
 {
   int value = 0;
-  int new_size = 0;
   
   if (!buffer)
   {
@@ -1188,17 +1489,16 @@ int MySQL_Packet::read_int(const int& offset, const int& size)
   }
     
   if (size == 0)
-    new_size = get_lcb_len(offset);
+    return read_lcb_int(offset);
     
   if (size == 1)
     return buffer[offset];
     
-  new_size = size;
-  int shifter = (new_size - 1) * 8;
+  int shifter = (size - 1) * 8;
   
-  for (int i = new_size; i > 0; i--) 
+  for (int i = size; i > 0; i--) 
   {
-    value += (buffer[i - 1] << shifter);
+    value += (buffer[offset + i - 1] << shifter);
     shifter -= 8;
   }
   
@@ -1250,6 +1550,50 @@ void MySQL_Packet::store_int(byte *buff, const long& value, const int& size)
   }
 }
 
+/*
+  store_lcb_int - Store an integer as a length coded binary
+
+  Values below 251 take one byte, larger ones a marker byte (0xfc, 0xfd,
+  0xfe) and 2, 3 or 8 bytes.
+
+  buff[in]        where to store the integer, NULL = only count
+  value[in]       integer value to be stored
+
+  Returns integer - number of bytes used
+*/
+int MySQL_Packet::store_lcb_int(byte *buff, const uint32_t& value)
+{
+  int size = 3;
+  byte marker = 0xfc;
+
+  if (value < 251)
+  {
+    if (buff)
+      buff[0] = (byte) value;
+
+    return 1;
+  }
+
+  if (value > 0xffffff)
+  {
+    size = 9;
+    marker = 0xfe;
+  }
+  else if (value > 0xffff)
+  {
+    size = 4;
+    marker = 0xfd;
+  }
+
+  if (buff)
+  {
+    buff[0] = marker;
+    store_int(&buff[1], value, size - 1);
+  }
+
+  return size;
+}
+
 /*
   read_lcb_int - Read an integer with len encoded byte
 
@@ -1264,7 +1608,7 @@ void MySQL_Packet::store_int(byte *buff, const long& value, const int& size)
 int MySQL_Packet::read_lcb_int(const int& offset) 
 {
   int len_size = 0;
-  int value = 0;
+  uint64_t value = 0;
   
   if (!buffer)
   {
@@ -1291,15 +1635,13 @@ int MySQL_Packet::read_lcb_int(const int& offset)
     len_size = 8;
   }
   
-  int shifter = (len_size - 1) * 8;
-  
   for (int i = len_size; i > 0; i--) 
   {
-    value += (buffer[offset + i] << shifter);
-    shifter -= 8;
+    value = (value << 8) | buffer[offset + i];
   }
   
-  return value;
+  // Too large for an int
+  return (value > 0x7fffffff) ? -1 : (int) value;
 }
 
 /*
@@ -0,0 +1,126 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Pipeline.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Command pipelining
+
+  ESP32_MySQL_Query waits for each response before the next statement
+  goes out, so N statements cost N network round trips. A pipeline
+  queues the statements, writes them back to back and then reads the
+  responses in order, so N statements cost about one round trip:
+
+    ESP32_MySQL_Pipeline pipe(&conn);
+
+    pipe.add("INSERT INTO test.t VALUES (1)");
+    pipe.add("INSERT INTO test.t VALUES (2)");
+    pipe.add("UPDATE test.t SET v = 0 WHERE id = 7");
+
+    if (!pipe.flush())
+    {
+      for (uint8_t i = 0; i < pipe.count(); i++)
+        if (pipe.result(i).status != PIPELINE_OK)
+          Serial.println(pipe.result(i).error_code);
+    }
+
+  The server runs the statements one after the other; one failing does
+  not stop the rest. Rows of a statement that returns a result set are
+  read and discarded, so queue statements whose rows you don't need.
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_PIPELINE_H
+#define ESP32_MYSQL_PIPELINE_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <ESP32_MySQL_Connection.h>
+
+#ifndef ESP32_MYSQL_PIPELINE_DEPTH
+  #define ESP32_MYSQL_PIPELINE_DEPTH    16      // statements per flush()
+#endif
+
+typedef enum
+{
+  PIPELINE_QUEUED = 0,    // not sent yet
+  PIPELINE_SENT,          // waiting for the response
+  PIPELINE_OK,            // Ok packet
+  PIPELINE_RESULT_SET,    // result set, rows discarded
+  PIPELINE_ERROR,         // error packet, see error_code
+  PIPELINE_NO_RESPONSE    // connection failed before the response arrived
+} Pipeline_Status;
+
+typedef struct
+{
+  Pipeline_Status status;
+  uint16_t        error_code;       // server error number for PIPELINE_ERROR
+  int             rows_affected;    // Ok packet, or rows discarded for PIPELINE_RESULT_SET
+  int             last_insert_id;   // Ok packet
+} Pipeline_Result;
+
+class ESP32_MySQL_Pipeline
+{
+  public:
+    ESP32_MySQL_Pipeline(ESP32_MySQL_Connection *connection);
+    ~ESP32_MySQL_Pipeline();
+
+    bool add(const char *query, bool progmem = false);
+
+    // flush() in two steps, like ESP32_MySQL_Query::send() / read_result()
+    bool send();
+    bool read_results();
+
+    bool flush();
+    void clear();
+
+    uint8_t count() const
+    {
+      return num_queued;
+    }
+
+    bool full() const
+    {
+      return num_queued >= ESP32_MYSQL_PIPELINE_DEPTH;
+    }
+
+    const Pipeline_Result& result(const uint8_t& index) const
+    {
+      return results[(index < ESP32_MYSQL_PIPELINE_DEPTH) ? index : 0];
+    }
+
+    ESP32_MySQL_Connection *connection()
+    {
+      return conn;
+    }
+
+  private:
+    bool  read_response(Pipeline_Result *result);
+    bool  skip_result_set(Pipeline_Result *result);
+    void  release_connection();
+
+    ESP32_MySQL_Connection *conn;
+
+    // Queued command packets, back to back
+    uint8_t   *out;
+    size_t    out_len;
+    size_t    out_size;
+
+    uint8_t   num_queued;
+    uint8_t   num_sent;
+    bool      holds_lock;
+
+    Pipeline_Result results[ESP32_MYSQL_PIPELINE_DEPTH];
+};
+
+#endif    // ESP32_MYSQL_PIPELINE_H
@@ -0,0 +1,338 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Pipeline_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_PIPELINE_IMPL_H
+#define ESP32_MYSQL_PIPELINE_IMPL_H
+
+#include <ESP32_MySQL_Pipeline.h>
+
+ESP32_MySQL_Pipeline::ESP32_MySQL_Pipeline(ESP32_MySQL_Connection *connection)
+{
+  conn        = connection;
+  out         = NULL;
+  out_len     = 0;
+  out_size    = 0;
+  num_queued  = 0;
+  num_sent    = 0;
+  holds_lock  = false;
+
+  memset(results, 0, sizeof(results));
+}
+
+ESP32_MySQL_Pipeline::~ESP32_MySQL_Pipeline()
+{
+  release_connection();
+
+  if (out)
+    free(out);
+}
+
+/*
+  add - queue a statement
+
+  Nothing is written until send() or flush().
+
+  query[in]       SQL statement (using normal memory access)
+  progmem[in]     True if string is in program memory
+
+  Returns bool - False = pipeline full (flush() first) or out of memory
+*/
+bool ESP32_MySQL_Pipeline::add(const char *query, bool progmem)
+{
+  if (num_sent > 0)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Pipeline::add: responses not read yet");
+    return false;
+  }
+
+  // First statement after a flush(): start over
+  if (out_len == 0)
+    num_queued = 0;
+
+  if (full())
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Pipeline::add: pipeline full");
+    return false;
+  }
+
+  const size_t query_len = progmem ? strlen_P(query) : strlen(query);
+  const size_t needed    = out_len + query_len + 5;
+
+  if (needed > out_size)
+  {
+    uint8_t *grown = (uint8_t *) realloc(out, needed);
+
+    if (!grown)
+    {
+      ESP32_MYSQL_LOGERROR("ESP32_MySQL_Pipeline::add: out of memory");
+      return false;
+    }
+
+    out       = grown;
+    out_size  = needed;
+  }
+
+  uint8_t *packet = &out[out_len];
+
+  conn->store_int(packet, query_len + 1, 3);
+  packet[3] = 0x00;
+  packet[4] = ESP32_MYSQL_COM_QUERY;
+
+  if (progmem)
+  {
+    for (size_t c = 0; c < query_len; c++)
+      packet[c + 5] = pgm_read_byte_near(query + c);
+  }
+  else
+  {
+    memcpy(&packet[5], query, query_len);
+  }
+
+  out_len += query_len + 5;
+
+  results[num_queued].status          = PIPELINE_QUEUED;
+  results[num_queued].error_code      = 0;
+  results[num_queued].rows_affected   = -1;
+  results[num_queued].last_insert_id  = -1;
+  num_queued++;
+
+  return true;
+}
+
+/*
+  send - write all queued statements in one go
+
+  Locks the connection until read_results() has read every response.
+
+  Returns bool - True = statements sent
+*/
+bool ESP32_MySQL_Pipeline::send()
+{
+  if (num_queued == 0)
+    return true;
+
+  if (num_sent > 0)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Pipeline::send: responses not read yet");
+    return false;
+  }
+
+  if (!conn->lock())
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Pipeline::send: connection busy");
+    return false;
+  }
+
+  holds_lock = true;
+
+  if ( !conn->keepalive() || !conn->write_bytes(out, out_len) )
+  {
+    ESP32_MYSQL_LOGERROR(NOT_CONNECTED);
+
+    // A partial write leaves the stream unusable
+    conn->close();
+    release_connection();
+
+    return false;
+  }
+
+  for (uint8_t i = 0; i < num_queued; i++)
+    results[i].status = PIPELINE_SENT;
+
+  num_sent = num_queued;
+
+  return true;
+}
+
+/*
+  read_results - read the responses to send(), in order
+
+  After a read failure the remaining statements are marked
+  PIPELINE_NO_RESPONSE and the connection is closed, as their responses
+  can no longer be matched. The queue is emptied either way; results stay
+  readable until the next add().
+
+  Returns bool - True = every statement succeeded
+*/
+bool ESP32_MySQL_Pipeline::read_results()
+{
+  bool all_ok = true;
+  bool stream_ok = true;
+
+  for (uint8_t i = 0; i < num_sent; i++)
+  {
+    if (stream_ok && !read_response(&results[i]))
+    {
+      ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Pipeline: no response for statement", i);
+
+      stream_ok = false;
+      conn->close();
+    }
+
+    if (!stream_ok)
+      results[i].status = PIPELINE_NO_RESPONSE;
+
+    if ( (results[i].status != PIPELINE_OK) && (results[i].status != PIPELINE_RESULT_SET) )
+      all_ok = false;
+  }
+
+  // Keep the results, drop the packets
+  out_len   = 0;
+  num_sent  = 0;
+
+  release_connection();
+
+  return all_ok;
+}
+
+/*
+  flush - send all queued statements and read their responses
+
+  Returns bool - True = every statement succeeded, see result() otherwise
+*/
+bool ESP32_MySQL_Pipeline::flush()
+{
+  if (num_queued == 0)
+    return true;
+
+  if (!send())
+  {
+    for (uint8_t i = 0; i < num_queued; i++)
+      results[i].status = PIPELINE_NO_RESPONSE;
+
+    out_len = 0;
+
+    return false;
+  }
+
+  return read_results();
+}
+
+/*
+  clear - forget queued statements and results
+*/
+void ESP32_MySQL_Pipeline::clear()
+{
+  if (num_sent > 0)
+    read_results();
+
+  out_len     = 0;
+  num_queued  = 0;
+}
+
+/*
+  read_response - read the response to one queued entry
+
+  An entry with several statements (or a CALL) gets one result per
+  statement; all are read and the last one is reported.
+
+  Returns bool - False = nothing readable, the stream is out of step
+*/
+bool ESP32_MySQL_Pipeline::read_response(Pipeline_Result *result)
+{
+  do
+  {
+    if ( !conn->read_packet() || (conn->packet_len <= 0) )
+      return false;
+
+    // LOAD DATA LOCAL INFILE: the server reads the file from the packets
+    // after the statement, which are only ours to send for the last one
+    if (conn->get_packet_type() == ESP32_MYSQL_LOCAL_INFILE_PACKET)
+    {
+      if (result != &results[num_sent - 1])
+      {
+        ESP32_MYSQL_LOGERROR("ESP32_MySQL_Pipeline: LOAD DATA LOCAL INFILE must be the last statement");
+        return false;
+      }
+
+      if ( !conn->send_local_infile() || !conn->read_packet() || (conn->packet_len <= 0) )
+        return false;
+    }
+
+    const int type = conn->get_packet_type();
+
+    if (type == ESP32_MYSQL_ERROR_PACKET)
+    {
+      // The server skips the remaining statements of the entry
+      conn->parse_error_packet();
+
+      result->status      = PIPELINE_ERROR;
+      result->error_code  = conn->buffer[5] | (conn->buffer[6] << 8);
+
+      return true;
+    }
+
+    if (type == ESP32_MYSQL_OK_PACKET)
+    {
+      const int insert_id_offset = 5 + conn->get_lcb_len(5);
+
+      result->status        = PIPELINE_OK;
+      result->rows_affected = conn->read_lcb_int(5);
+
+      if (result->rows_affected > 0)
+        result->last_insert_id = conn->read_lcb_int(insert_id_offset);
+    }
+    else if (!skip_result_set(result))
+    {
+      return false;
+    }
+    else if (result->status == PIPELINE_ERROR)
+    {
+      return true;
+    }
+  } while (conn->get_status_flags() & SERVER_MORE_RESULTS_EXISTS);
+
+  return true;
+}
+
+/*
+  skip_result_set - read past column definitions and rows
+
+  Returns bool - False = the result set ended early
+*/
+bool ESP32_MySQL_Pipeline::skip_result_set(Pipeline_Result *result)
+{
+  const int rows = conn->skip_result_set();
+
+  if (rows < 0)
+    return false;
+
+  if (conn->get_packet_type() == ESP32_MYSQL_ERROR_PACKET)
+  {
+    // The statement failed while sending rows
+    result->status      = PIPELINE_ERROR;
+    result->error_code  = conn->buffer[5] | (conn->buffer[6] << 8);
+
+    return true;
+  }
+
+  result->status        = PIPELINE_RESULT_SET;
+  result->rows_affected = rows;
+
+  return true;
+}
+
+void ESP32_MySQL_Pipeline::release_connection()
+{
+  if (holds_lock)
+  {
+    holds_lock = false;
+    conn->set_io_state(IO_IDLE);
+    conn->unlock();
+  }
+}
+
+#endif    // ESP32_MYSQL_PIPELINE_IMPL_H
@@ -24,31 +24,51 @@
 // Comment this if you don't need SELECT queries to reduce memory footprint of the library.
 #define WITH_SELECT          
 
-#define MAX_FIELDS    0x20   // Maximum number of fields. Reduce to save memory. Default=32
-
 #ifdef WITH_SELECT
 
-// Structure for retrieving a field (minimal implementation).
+#ifndef ESP32_MYSQL_CHUNK_SIZE
+  #define ESP32_MYSQL_CHUNK_SIZE    256     // bytes per call of a Value_Chunk_Callback
+#endif
+
+#ifndef ESP32_MYSQL_VALUE_BUFFER
+  #define ESP32_MYSQL_VALUE_BUFFER  64      // most bytes reserved per column from its length
+#endif
+
+// Structure for retrieving a field.
 typedef struct 
 {
-  char *db;
-  char *table;
-  char *name;
+  char      *db;
+  char      *table;
+  char      *name;
+  uint16_t  charset;    // character set number, 63 = binary
+  uint32_t  length;     // maximum length of a value in bytes
+  uint8_t   type;       // MYSQL_TYPE_xxx
+  uint16_t  flags;      // NOT_NULL_FLAG, UNSIGNED_FLAG, ...
+  uint8_t   decimals;
 } field_struct;
 
 // Structure for storing result set metadata.
 typedef struct 
 {
   int num_fields;     // actual number of fields
-  field_struct *fields[MAX_FIELDS];
+  field_struct **fields;
 } column_names;
 
 // Structure for storing row data.
 typedef struct 
 {
-  char *values[MAX_FIELDS];
+  char **values;      // num_fields values
 } row_values;
 
+/*
+  Receives the values of a row read by stream_next_row(), piece by piece:
+  length bytes at data, starting offset bytes into a value of total
+  bytes. data is NULL for SQL NULL. Return false to skip the rest of
+  the value.
+*/
+typedef bool (*Value_Chunk_Callback)(const int& column, const uint8_t *data, const size_t& length,
+                                     const size_t& offset, const size_t& total, void *context);
+
 #endif  // WITH_SELECT
 
 class ESP32_MySQL_Query 
@@ -57,9 +77,36 @@ class ESP32_MySQL_Query
     ESP32_MySQL_Query(ESP32_MySQL_Connection *connection);
     ~ESP32_MySQL_Query();
     bool execute(const char *query, bool progmem = false);
+    
+    // execute() in two steps: write the query now, read the response later
+    bool send(const char *query, bool progmem = false);
+    bool read_result();
+    
+    // Give up on the response: closes the connection and releases it
+    void abort();
+    
+    // Multi-statement queries and stored procedures: one result per statement
+    bool next_result();
+    
+    bool has_more_results() const
+    {
+      return more_results;
+    }
+    
+    // SERVER_xxx flags of the last Ok or EOF packet
+    uint16_t get_server_status() const
+    {
+      return server_status;
+    }
+    
+    ESP32_MySQL_Connection *connection()
+    {
+      return conn;
+    }
 
   private:
-    bool execute_query(const int& query_len);
+    bool send_query(const int& query_len);
+    void release_connection();
     
 #ifdef WITH_SELECT
 
@@ -67,8 +114,43 @@ class ESP32_MySQL_Query
     void close();
     column_names  *get_columns();
     row_values    *get_next_row();
+    
+    // get_columns() a packet at a time
+    bool          start_columns();
+    int           read_column();
+    
+    column_names  *get_column_list()
+    {
+      return columns_read ? &columns : NULL;
+    }
+    
+    bool          stream_next_row(Value_Chunk_Callback callback, void *context = NULL);
     void          show_results();
     
+    // Values of the current row, converted according to the column type
+    bool      is_null(const int& column) const;
+    int64_t   get_int64(const int& column) const;
+    double    get_double(const int& column) const;
+    bool      get_datetime(const int& column, MySQL_DateTime *value) const;
+    
+    // Stored procedures
+    bool call(const char *procedure, const char *out_params = NULL, const char *set_params = NULL);
+    
+    bool has_result_set() const
+    {
+      return rows_pending;
+    }
+    
+    int get_out_param_count() const
+    {
+      return num_out_params;
+    }
+    
+    const char *get_out_param(const int& index) const
+    {
+      return ((index >= 0) && (index < num_out_params)) ? out_params.values[index] : NULL;
+    }
+    
     int get_rows_affected() 
     {
       return rows_affected;
@@ -82,27 +164,47 @@ class ESP32_MySQL_Query
   private:
     void  free_columns_buffer();
     void  free_row_buffer();
-    bool  clear_ok_packet();
-
-    char  *read_string(int *offset);
+    void  free_out_params();
+    bool  reserve_columns(const int& count);
+    void  finish_call();
+    void  end_of_rows(const int& res);
+    bool  read_row_bytes(uint8_t *out, const size_t& len, size_t *remaining);
+
+    char  *read_string(int *offset, const int& column = -1);
+    char  *value_buffer(const int& column, const uint32_t& size);
+    const char *value_text(const int& column) const;
     int   get_field(field_struct *fs);
     int   get_row();
-    bool  get_fields();
+    void  fail_columns();
     int   get_row_values();
     column_names *query_result();
 
     bool          columns_read;
+    bool          rows_pending;   // result set not read to the end
     int           num_cols;
+    int           fields_read;    // column definitions read by read_column()
+    int           cols_allocated; // capacity of columns, row, row_nulls and value_bufs
     
     column_names  columns;
     row_values    row;
+    uint8_t       *row_nulls;     // bit per column, SQL NULL
+    char          **value_bufs;   // value of each column, reused from row to row
+    uint32_t      *value_sizes;   // bytes of each
     
     int           rows_affected;
     int           last_insert_id;
     
+    bool          in_call;        // results of call() not read to the final Ok packet
+    bool          call_has_out;   // call() appended SELECT of the OUT parameters
+    int           num_out_params;
+    row_values    out_params;
+    
 #endif
 
     ESP32_MySQL_Connection *conn;
+    bool          holds_lock;   // connection locked until the result set is consumed
+    bool          more_results; // another result follows the current one
+    uint16_t      server_status;
 };
 
 
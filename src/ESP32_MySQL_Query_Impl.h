@@ -29,20 +29,30 @@
 */
 ESP32_MySQL_Query::ESP32_MySQL_Query(ESP32_MySQL_Connection *connection) 
 {
-  conn = connection;
+  conn          = connection;
+  holds_lock    = false;
+  more_results  = false;
+  server_status = 0;
   
 #ifdef WITH_SELECT
-  columns.num_fields = 0;
-  
-  for (int f = 0; f < MAX_FIELDS; f++) 
-  {
-    columns.fields[f] = NULL;
-    row.values[f]     = NULL;
-  }
+  columns.num_fields  = 0;
+  columns.fields      = NULL;
+  row.values          = NULL;
+  out_params.values   = NULL;
+  row_nulls           = NULL;
+  value_bufs          = NULL;
+  value_sizes         = NULL;
   
+  num_cols        = 0;
+  fields_read     = 0;
+  cols_allocated  = 0;
   columns_read    = false;
+  rows_pending    = false;
   rows_affected   = -1;
   last_insert_id  = -1;
+  in_call         = false;
+  call_has_out    = false;
+  num_out_params  = 0;
 #endif
 }
 
@@ -54,33 +64,73 @@ ESP32_MySQL_Query::~ESP32_MySQL_Query()
 #ifdef WITH_SELECT
   close();
 #endif
+  release_connection();
 }
 
 /*
   execute - Execute a SQL statement
 
-  This method executes the query specified as a character array. It copies
-  the query to the local buffer then calls the execute_query() method to
-  execute the query.
+  This method executes the query specified as a character array. It sends
+  the query with send() then reads the response with read_result().
 
   If a result set is available after the query executes, the field
   packets and rows can be read separately using the get_field() and
   get_row() methods.
 
+  When the connection is in thread-safe mode, the connection stays locked
+  from here until the result set has been consumed (get_next_row()
+  returns NULL) or close() is called.
+
   query[in]       SQL statement (using normal memory access)
   progmem[in]     True if string is in program memory
 
   Returns bool - True = a result set is available for reading
 */
 
-// TODO: Pass buffer pointer instead of using global buffer
 bool ESP32_MySQL_Query::execute(const char *query, bool progmem)
+{
+  if (!send(query, progmem))
+    return false;
+
+  return read_result();
+}
+
+
+/*
+  send - Send a SQL statement without waiting for the response
+
+  This method copies the query to the connection buffer and writes it to
+  the server. The response must then be read with read_result(). Use it
+  to do other work (or serve other connections) while the server is busy.
+
+  query[in]       SQL statement (using normal memory access)
+  progmem[in]     True if string is in program memory
+
+  Returns bool - True = query sent
+*/
+
+// TODO: Pass buffer pointer instead of using global buffer
+bool ESP32_MySQL_Query::send(const char *query, bool progmem)
 {
   int query_len;   // length of query
 
-  if (!conn->connected()) 
+  // Drop a lock left over by an unconsumed result set
+  release_connection();
+  
+  if (!conn->lock())
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::send: connection busy");
+    
+    return false;
+  }
+  
+  holds_lock = true;
+
+  // Also pings (and reconnects) first if the connection sat idle too long
+  if (!conn->keepalive()) 
   {
     ESP32_MYSQL_LOGERROR(NOT_CONNECTED);
+    release_connection();
     
     return false;
   }
@@ -94,40 +144,15 @@ bool ESP32_MySQL_Query::execute(const char *query, bool progmem)
     query_len = (int) strlen(query);
   }
   
-  if ( conn->largest_buffer_size < query_len + COMMAND_HEADER_LEN )
-  {
-    if ( conn->largest_buffer_size == 0 )
-    {
-      // Check if we need to allocate buffer the first time. Don't need, but to be safe
-      conn->largest_buffer_size = query_len + COMMAND_HEADER_LEN;
-      ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Query::execute: First time allocate buffer, size = ", conn->largest_buffer_size);
-      
-      conn->buffer = (byte *) malloc(conn->largest_buffer_size);
-    }
-    else
-    {
-      // Check if we need to reallocate buffer
-      conn->largest_buffer_size = query_len + COMMAND_HEADER_LEN;
-      ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Query::execute: Reallocate buffer, size = ", conn->largest_buffer_size);
-      
-      conn->buffer = (byte *) realloc(conn->buffer, conn->largest_buffer_size);    
-    }
-  }
-  else
-  {
-    ESP32_MYSQL_LOGDEBUG3("ESP32_MySQL_Query::execute: Reuse allocated buffer, conn->largest_buffer_size = ", conn->largest_buffer_size, " > ", query_len + COMMAND_HEADER_LEN);
-  }
-   
-  if (conn->buffer == NULL)
+  if ( !conn->reserve_buffer(query_len + COMMAND_HEADER_LEN) )
   {
-    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::execute: NULL buffer");
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::send: NULL buffer");
+    release_connection();
    
     return false;
   }
-  else
-  {
-    memset(conn->buffer, 0, conn->largest_buffer_size);
-  }
+  
+  memset(conn->buffer, 0, conn->largest_buffer_size);
   //////
     
   // Write query to packet
@@ -141,60 +166,145 @@ bool ESP32_MySQL_Query::execute(const char *query, bool progmem)
     memcpy(&conn->buffer[COMMAND_HEADER_LEN], query, query_len);
   }
 
-  ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Query::execute: query = ", (char *) &conn->buffer[COMMAND_HEADER_LEN] );
+  ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Query::send: query = ", (char *) &conn->buffer[COMMAND_HEADER_LEN] );
   
   // Send the query
-  return execute_query(query_len);
+  if (!send_query(query_len))
+  {
+    release_connection();
+    
+    return false;
+  }
+
+  return true;
 }
 
 
 /*
-  execute_query - execute a query
+  abort - give up on the response to send(), e.g. after a timeout
+
+  The rest of the response may still arrive, so the connection is closed
+  before the lock taken by send() is released.
+*/
+void ESP32_MySQL_Query::abort()
+{
+  if (!holds_lock)
+    return;
+
+  conn->close();
+
+#ifdef WITH_SELECT
+  rows_pending  = false;
+  in_call       = false;
+#endif
+
+  more_results  = false;
+
+  release_connection();
+}
 
-  This method sends the query string to the server and waits for a
-  response. If the result is a result set, it returns true, if it is
-  an error, it processes the error packet and prints the error via
-  Serial.print(). If it is an Ok packet, it parses the packet and
-  returns false.
+
+/*
+  release_connection - the response to send() has been consumed
+
+  Marks the connection idle again and gives up the connection lock
+  taken by send().
+*/
+void ESP32_MySQL_Query::release_connection()
+{
+  if (holds_lock)
+  {
+    holds_lock = false;
+    conn->set_io_state(IO_IDLE);
+    conn->unlock();
+  }
+}
+
+
+/*
+  send_query - frame the query in the buffer as COM_QUERY and send it
 
   query_len[in]   Number of bytes in the query string
 
-  Returns bool - true = result set available,
-                    false = no result set returned.
+  Returns bool - True = packet written
 */
 // TODO: Pass buffer pointer instead of using global buffer
-bool ESP32_MySQL_Query::execute_query(const int& query_len)
+bool ESP32_MySQL_Query::send_query(const int& query_len)
 {
   if (!conn->buffer)
   {
-    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::execute_query: NULL buffer");
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::send_query: NULL buffer");
     return false;
   }
 
-  // Reset the rows affected and last insert id before query.
-  rows_affected  = -1;
-  last_insert_id = -1;
-
   conn->store_int(&conn->buffer[0], query_len + 1, 3);
   conn->buffer[3] = byte(0x00);
-  conn->buffer[4] = byte(0x03);  // command packet
+  conn->buffer[4] = byte(ESP32_MYSQL_COM_QUERY);  // command packet
 
   // Send the query
-  ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Query::execute_query: query = ", (char *) &conn->buffer[COMMAND_HEADER_LEN] );
+  ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Query::send_query: query = ", (char *) &conn->buffer[COMMAND_HEADER_LEN] );
   
-  if (!conn->write_bytes((uint8_t*)conn->buffer, query_len + COMMAND_HEADER_LEN))
-    return false;
+  return conn->write_bytes((uint8_t*)conn->buffer, query_len + COMMAND_HEADER_LEN);
+}
+
+
+/*
+  read_result - read the response to a query sent with send()
+
+  This method waits for the response to the query. If the result is a
+  result set, it returns true, if it is an error, it processes the error
+  packet and prints the error via Serial.print(). If it is an Ok packet,
+  it parses the packet and returns true.
+
+  For a query with several statements (or a CALL) this reads the first
+  result; next_result() reads the following ones.
+
+  Returns bool - true = query succeeded (result set available or Ok packet),
+                    false = error or no response.
+*/
+bool ESP32_MySQL_Query::read_result()
+{
+  // Reset the rows affected and last insert id before query.
+  rows_affected  = -1;
+  last_insert_id = -1;
+  more_results   = false;
+#ifdef WITH_SELECT
+  rows_pending   = false;
+#endif
 
   // Read a response packet and check it for Ok or Error.
   if ( !conn->read_packet() || ( conn->packet_len <= 0 ) || ( conn->packet_len > MAX_TRANSMISSION_UNIT ) )
+  {
+    release_connection();
     return false;
+  }
   //////
   
   int res = conn->get_packet_type();
   
+  // LOAD DATA LOCAL INFILE: send the file, the statement's result follows
+  if (res == ESP32_MYSQL_LOCAL_INFILE_PACKET)
+  {
+    if (!conn->send_local_infile())
+    {
+      conn->close();
+      release_connection();
+      return false;
+    }
+
+    if ( !conn->read_packet() || ( conn->packet_len <= 0 ) || ( conn->packet_len > MAX_TRANSMISSION_UNIT ) )
+    {
+      release_connection();
+      return false;
+    }
+
+    res = conn->get_packet_type();
+  }
+  
   if (res == ESP32_MYSQL_ERROR_PACKET) 
   {
     conn->parse_error_packet();
+    release_connection();
     return false;
   } 
   else if (res == ESP32_MYSQL_OK_PACKET || res == ESP32_MYSQL_EOF_PACKET) 
@@ -227,16 +337,83 @@ bool ESP32_MySQL_Query::execute_query(const int& query_len)
       last_insert_id = conn->read_lcb_int(loc2);
     }
     
+    server_status = conn->get_status_flags();
+    more_results  = (server_status & SERVER_MORE_RESULTS_EXISTS) != 0;
+    
+    // No result set follows, but maybe the result of the next statement
+    if (!more_results)
+      release_connection();
+    
     return true;
   }
 
   // Not an Ok packet, so we now have the result set to process.
 #ifdef WITH_SELECT
   columns_read = false;
+  rows_pending = true;
+#else
+  // Nobody can read a result set, so don't keep the connection
+  release_connection();
 #endif
   return true;
 }
 
+/*
+  next_result - move on to the result of the next statement
+
+  A query such as "INSERT ...; INSERT ...; SELECT ..." sends one result
+  per statement, and a CALL sends one per SELECT in the procedure plus a
+  final Ok packet. After the first result (from execute() or
+  read_result()), call this until it returns false:
+
+    query.execute("INSERT INTO t VALUES (1); SELECT * FROM t");
+    do
+    {
+      ... get_rows_affected(), or get_columns() / get_next_row() ...
+    } while (query.next_result());
+
+  Rows of the current result set that were not read are skipped. The
+  server stops at the first statement that fails, so an error ends the
+  sequence.
+
+  Returns bool - True = the next result has been read
+*/
+bool ESP32_MySQL_Query::next_result()
+{
+#ifdef WITH_SELECT
+  if (rows_pending)
+  {
+    if (columns_read || get_columns())
+    {
+      while (get_next_row())
+        ;
+    }
+  }
+  
+  free_columns_buffer();
+  free_row_buffer();
+#endif
+
+  if (!more_results)
+    return false;
+
+  if (!read_result())
+  {
+#ifdef WITH_SELECT
+    in_call = false;
+#endif
+    return false;
+  }
+
+#ifdef WITH_SELECT
+  // The Ok packet ends the results of a procedure
+  if (in_call && !rows_pending)
+    finish_call();
+#endif
+
+  return true;
+}
+
 #ifdef WITH_SELECT
 /*
   Close
@@ -247,6 +424,217 @@ void ESP32_MySQL_Query::close()
 {
   free_columns_buffer();
   free_row_buffer();
+  free_out_params();
+  release_connection();
+  
+  for (int f = 0; f < cols_allocated; f++)
+    free(value_bufs[f]);
+  
+  free(columns.fields);
+  free(row.values);
+  free(row_nulls);
+  free(value_bufs);
+  free(value_sizes);
+  
+  columns.fields  = NULL;
+  row.values      = NULL;
+  row_nulls       = NULL;
+  value_bufs      = NULL;
+  value_sizes     = NULL;
+  cols_allocated  = 0;
+}
+
+/*
+  reserve_columns - make room for count columns
+
+  The column, row, NULL and value buffer arrays grow to the largest
+  result set read so far and are released by close().
+
+  Returns bool - False = out of memory
+*/
+bool ESP32_MySQL_Query::reserve_columns(const int& count)
+{
+  if (count <= cols_allocated)
+    return true;
+    
+  field_struct  **fields  = (field_struct **) realloc(columns.fields, count * sizeof(field_struct *));
+  
+  if (fields)
+    columns.fields = fields;
+    
+  char          **values  = fields ? (char **) realloc(row.values, count * sizeof(char *)) : NULL;
+  
+  if (values)
+    row.values = values;
+    
+  uint8_t       *nulls    = values ? (uint8_t *) realloc(row_nulls, (count + 7) / 8) : NULL;
+  
+  if (nulls)
+    row_nulls = nulls;
+    
+  char          **bufs    = nulls ? (char **) realloc(value_bufs, count * sizeof(char *)) : NULL;
+  
+  if (bufs)
+    value_bufs = bufs;
+    
+  uint32_t      *sizes    = bufs ? (uint32_t *) realloc(value_sizes, count * sizeof(uint32_t)) : NULL;
+  
+  if (!sizes)
+  {
+    ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Query: out of memory for columns:", count);
+    return false;
+  }
+  
+  value_sizes = sizes;
+  
+  for (int f = cols_allocated; f < count; f++)
+  {
+    columns.fields[f] = NULL;
+    row.values[f]     = NULL;
+    value_bufs[f]     = NULL;
+    value_sizes[f]    = 0;
+  }
+  
+  memset(row_nulls, 0xff, (count + 7) / 8);
+  
+  cols_allocated = count;
+  
+  return true;
+}
+
+
+/*
+  call - call a stored procedure
+
+  Every SELECT in the procedure returns a result set, then the procedure
+  ends with an Ok packet carrying the affected rows of its last
+  statement. Read them like the results of a multi-statement query:
+
+    if (query.call("transfer(1, 2, 10.5, @ok, @balance)", "@ok, @balance"))
+    {
+      do
+      {
+        if (query.has_result_set())
+        {
+          ... get_columns() / get_next_row() ...
+        }
+      } while (query.next_result());
+
+      Serial.println(query.get_out_param(1));   // @balance
+    }
+
+  OUT and INOUT parameters are passed as session variables. Their values
+  are selected in the same round trip as the CALL and are available from
+  get_out_param() once next_result() has returned false, while
+  get_rows_affected() and get_server_status() then report the final Ok
+  packet of the procedure.
+
+  procedure[in]   procedure name and argument list, without CALL
+  out_params[in]  (optional) variables to read back, e.g. "@ok, @balance"
+  set_params[in]  (optional) INOUT values to set first, e.g. "@count = 5"
+
+  Returns bool - True = the first result is available
+*/
+bool ESP32_MySQL_Query::call(const char *procedure, const char *out_params, const char *set_params)
+{
+  free_out_params();
+
+  const size_t len = (set_params ? strlen("SET ") + strlen(set_params) + strlen("; ") : 0)
+                     + strlen("CALL ") + strlen(procedure)
+                     + (out_params ? strlen("; SELECT ") + strlen(out_params) : 0) + 1;
+
+  char *sql = (char *) malloc(len);
+
+  if (!sql)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::call: out of memory");
+    return false;
+  }
+
+  sql[0] = 0;
+
+  if (set_params)
+  {
+    strcat(sql, "SET ");
+    strcat(sql, set_params);
+    strcat(sql, "; ");
+  }
+
+  strcat(sql, "CALL ");
+  strcat(sql, procedure);
+
+  if (out_params)
+  {
+    strcat(sql, "; SELECT ");
+    strcat(sql, out_params);
+  }
+
+  const bool sent = send(sql);
+
+  free(sql);
+
+  if (!sent)
+    return false;
+
+  // Ok packet of the SET
+  if ( set_params && (!read_result() || !more_results) )
+    return false;
+
+  if (!read_result())
+    return false;
+
+  in_call       = true;
+  call_has_out  = (out_params != NULL);
+
+  if (!rows_pending)
+    finish_call();
+
+  return true;
+}
+
+
+/*
+  finish_call - the procedure has sent its final Ok packet
+
+  Reads the row of OUT parameters that call() selected after the CALL,
+  keeping the Ok packet's counters as the current result.
+*/
+void ESP32_MySQL_Query::finish_call()
+{
+  in_call = false;
+
+  if (!call_has_out || !more_results)
+    return;
+
+  const int       affected  = rows_affected;
+  const int       insert_id = last_insert_id;
+  const uint16_t  status    = server_status;
+
+  if (read_result() && rows_pending && get_columns())
+  {
+    row_values *values = get_next_row();
+
+    out_params.values = values ? (char **) malloc(num_cols * sizeof(char *)) : NULL;
+
+    if (out_params.values)
+    {
+      // Copied: the row lives in buffers reused by the next result set
+      for (int f = 0; f < num_cols; f++)
+        out_params.values[f] = SQL_strdup(values->values[f]);
+
+      num_out_params = num_cols;
+
+      while (get_next_row())
+        ;
+    }
+  }
+
+  free_columns_buffer();
+  free_row_buffer();
+
+  rows_affected   = affected;
+  last_insert_id  = insert_id;
+  server_status   = status;
 }
 
 
@@ -260,48 +648,338 @@ void ESP32_MySQL_Query::close()
         the field data to free memory.
 */
 column_names *ESP32_MySQL_Query::get_columns() 
+{
+  if (!start_columns())
+    return NULL;
+    
+  int res;
+  
+  while ( (res = read_column()) == ESP32_MYSQL_OK_PACKET )
+    ;
+    
+  return (res == ESP32_MYSQL_EOF_PACKET) ? &columns : NULL;
+}
+
+/*
+  start_columns - get_columns() a packet at a time
+
+  For callers that must not wait on the server: after start_columns(),
+  call read_column() each time a packet has arrived, until it returns
+  ESP32_MYSQL_EOF_PACKET (columns in get_column_list()) or
+  ESP32_MYSQL_ERROR_PACKET.
+
+  Returns bool - False = not a result set, connection released
+*/
+bool ESP32_MySQL_Query::start_columns()
 {
   free_columns_buffer();
   free_row_buffer();
   num_cols = 0;
+  fields_read = 0;
+  
+  if (conn->buffer == NULL) 
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::start_columns: NULL buffer");
+    fail_columns();
+    
+    return false;
+  }
+  
+  const int num_fields = conn->read_lcb_int(4); // From result header packet
+  
+  if ( (num_fields <= 0) || !reserve_columns(num_fields) )
+  {
+    fail_columns();
+    
+    return false;
+  }
+  
+  columns.num_fields = num_fields;
+  num_cols = num_fields; // Save this for later use
+  
+  return true;
+}
+
+/*
+  read_column - read one column definition, or the EOF packet after them
+
+  Returns integer - ESP32_MYSQL_OK_PACKET = more to read,
+                    ESP32_MYSQL_EOF_PACKET = all columns read,
+                    ESP32_MYSQL_ERROR_PACKET = failed, connection closed
+*/
+int ESP32_MySQL_Query::read_column()
+{
+  if (fields_read < num_cols)
+  {
+    field_struct *field = (field_struct *) calloc(1, sizeof(field_struct));
+    
+    if (!field)
+    {
+      fail_columns();
+      return ESP32_MYSQL_ERROR_PACKET;
+    }
+    
+    // Owned by columns from here on, so free_columns_buffer() finds it
+    columns.fields[fields_read] = field;
+    
+    if (get_field(field) != ESP32_MYSQL_OK_PACKET)
+    {
+      ESP32_MYSQL_LOGERROR(BAD_MOJO);
+      fail_columns();
+      
+      return ESP32_MYSQL_ERROR_PACKET;
+    }
+    
+    fields_read++;
+    
+    return ESP32_MYSQL_OK_PACKET;
+  }
+
+  // Room for the longest value of each column, up to ESP32_MYSQL_VALUE_BUFFER;
+  // longer values grow it. TEXT and BLOB columns report huge lengths.
+  for (int f = 0; f < num_cols; f++)
+  {
+    const uint32_t length = columns.fields[f]->length;
+    
+    value_buffer(f, ((length < ESP32_MYSQL_VALUE_BUFFER) ? length : ESP32_MYSQL_VALUE_BUFFER) + 1);
+  }
+
+  // EOF packet
+  ESP32_MYSQL_LOGDEBUG("ESP32_MySQL_Query::read_column: read_packet");
+  
+  if ( !conn->read_packet() || ( conn->packet_len <= 0 ) || ( conn->packet_len > MAX_TRANSMISSION_UNIT ) )
+  {
+    fail_columns();
+    return ESP32_MYSQL_ERROR_PACKET;
+  }
+  
+  columns_read = true;
+  
+  return ESP32_MYSQL_EOF_PACKET;
+}
+
+/*
+  fail_columns - give up on a result set whose columns can't be read
+*/
+void ESP32_MySQL_Query::fail_columns()
+{
+  // The rest of the result set is still coming, so the stream is out of step
+  conn->close();
+
+  rows_pending = false;
+  more_results = false;
+  release_connection();
+}
+
+
+/*
+  get_next_row - Iterator for reading rows from a result set
+
+  This method returns an instance of a structure (row_values)
+  that contains an array of strings representing the row
+  values returned from the server.
+
+  The caller can use the values however needed - by first
+  converting them to a specific type or as a string.
+*/
+row_values *ESP32_MySQL_Query::get_next_row() 
+{
+  int res = 0;
+
+  free_row_buffer();
+
+  // Read the rows
+  ESP32_MYSQL_LOGDEBUG("ESP32_MySQL_Query::get_next_row: get_row_values");
+  
+  res = get_row_values();
+  
+  if (res == ESP32_MYSQL_OK_PACKET) 
+  {
+    return &row;
+  }
+  
+  end_of_rows(res);
+  
+  return NULL;
+}
+
+/*
+  end_of_rows - the result set ended with res (EOF or error packet)
+*/
+void ESP32_MySQL_Query::end_of_rows(const int& res)
+{
+  // Result set fully consumed, the EOF packet tells whether another follows
+  rows_pending = false;
+  more_results = false;
+  
+  if (res == ESP32_MYSQL_EOF_PACKET)
+  {
+    server_status = conn->get_status_flags();
+    more_results  = (server_status & SERVER_MORE_RESULTS_EXISTS) != 0;
+  }
+  
+  if (!more_results)
+    release_connection();
+}
+
+/*
+  stream_next_row - read the next row without holding it in memory
+
+  get_next_row() reads a whole row packet into the connection buffer, so
+  a row can't be larger than MAX_TRANSMISSION_UNIT. This method reads the
+  row straight from the connection instead and passes each value to
+  callback in pieces of up to ESP32_MYSQL_CHUNK_SIZE bytes, so BLOB and
+  TEXT values of any size take a fixed amount of RAM. To collect a value
+  into a buffer of your own, copy length bytes to buffer + offset.
+
+  callback[in]    Called for every value of the row, in column order
+  context[in]     (optional) passed on to callback
+
+  Returns bool - True = a row was read, false = no more rows or an error
+*/
+bool ESP32_MySQL_Query::stream_next_row(Value_Chunk_Callback callback, void *context)
+{
+  uint8_t chunk[ESP32_MYSQL_CHUNK_SIZE];
+  
+  if (!columns_read) 
+  {
+    ESP32_MYSQL_LOGERROR(READ_COLS);
+    return false;
+  }
+  
+  free_row_buffer();
+  
+  // Header and the first byte of the payload
+  if (!conn->read_bytes(chunk, 5))
+  {
+    end_of_rows(ESP32_MYSQL_ERROR_PACKET);
+    return false;
+  }
+  
+  const size_t packet_len = chunk[0] | (chunk[1] << 8) | ((uint32_t) chunk[2] << 16);
+  const uint8_t first = chunk[4];
+  
+  // The EOF or error packet after the last row: read it whole
+  if ( (packet_len == 0) || ((first == ESP32_MYSQL_EOF_PACKET) && (packet_len < 9)) || (first == ESP32_MYSQL_ERROR_PACKET) )
+  {
+    bool ok = (packet_len > 0) && (packet_len <= MAX_TRANSMISSION_UNIT) && conn->reserve_buffer(packet_len + 4);
+    
+    if (ok)
+    {
+      memcpy(conn->buffer, chunk, 5);
+      ok = conn->read_bytes(conn->buffer + 5, packet_len - 1);
+    }
+    
+    conn->packet_len = ok ? packet_len : 0;
+    
+    if (ok && (first == ESP32_MYSQL_ERROR_PACKET))
+      conn->parse_error_packet();
+    else if (!ok)
+      conn->close();
+      
+    end_of_rows( (ok && (first == ESP32_MYSQL_EOF_PACKET)) ? ESP32_MYSQL_EOF_PACKET : ESP32_MYSQL_ERROR_PACKET );
+    
+    return false;
+  }
+  
+  // A row of 16 MB or more continues in further packets
+  if (packet_len == 0xffffff)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::stream_next_row: row too large");
+    
+    conn->close();
+    end_of_rows(ESP32_MYSQL_ERROR_PACKET);
+    
+    return false;
+  }
+  
+  size_t remaining = packet_len - 1;
+  bool ok = true;
+  
+  for (int f = 0; ok && (f < num_cols); f++)
+  {
+    uint8_t marker = first;
+    
+    if (f > 0)
+      ok = read_row_bytes(&marker, 1, &remaining);
+    
+    if (!ok)
+      break;
+      
+    if (marker == 0xfb)
+    {
+      callback(f, NULL, 0, 0, 0, context);
+      continue;
+    }
+    
+    // Length coded binary: the marker, or 2, 3 or 8 bytes after it
+    size_t total = marker;
+    
+    if (marker > 0xfb)
+    {
+      uint8_t size_bytes[8];
+      const size_t size = (marker == 0xfc) ? 2 : (marker == 0xfd) ? 3 : 8;
+      
+      ok = read_row_bytes(size_bytes, size, &remaining);
+      total = 0;
+      
+      for (int i = size - 1; ok && (i >= 0); i--)
+        total = (total << 8) | size_bytes[i];
+    }
+    
+    if ( !ok || (total > remaining) )
+    {
+      ok = false;
+      break;
+    }
+    
+    bool wanted = true;
+    
+    if (total == 0)
+      callback(f, chunk, 0, 0, 0, context);
+      
+    for (size_t done = 0; ok && (done < total); )
+    {
+      const size_t length = (total - done < sizeof(chunk)) ? total - done : sizeof(chunk);
+      
+      ok = read_row_bytes(chunk, length, &remaining);
+      
+      if (ok && wanted)
+        wanted = callback(f, chunk, length, done, total, context);
+        
+      done += length;
+    }
+  }
   
-  if (get_fields()) 
+  // Whatever follows the last column
+  while (ok && (remaining > 0))
+    ok = read_row_bytes(chunk, (remaining < sizeof(chunk)) ? remaining : sizeof(chunk), &remaining);
+    
+  if (!ok)
   {
-    columns_read = true;
-    return &columns;
+    // Part of the row is still on its way, so the stream is out of step
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::stream_next_row: bad or incomplete row");
+    
+    conn->close();
+    end_of_rows(ESP32_MYSQL_ERROR_PACKET);
+    
+    return false;
   }
-
-  return NULL;
+  
+  return true;
 }
 
-
 /*
-  get_next_row - Iterator for reading rows from a result set
-
-  This method returns an instance of a structure (row_values)
-  that contains an array of strings representing the row
-  values returned from the server.
-
-  The caller can use the values however needed - by first
-  converting them to a specific type or as a string.
+  read_row_bytes - read len bytes of the row packet being streamed
 */
-row_values *ESP32_MySQL_Query::get_next_row() 
+bool ESP32_MySQL_Query::read_row_bytes(uint8_t *out, const size_t& len, size_t *remaining)
 {
-  int res = 0;
-
-  free_row_buffer();
-
-  // Read the rows
-  ESP32_MYSQL_LOGDEBUG("ESP32_MySQL_Query::get_next_row: get_row_values");
-  
-  res = get_row_values();
-  
-  if (res != ESP32_MYSQL_EOF_PACKET) 
-  {
-    return &row;
-  }
+  if (len > *remaining)
+    return false;
+    
+  *remaining -= len;
   
-  return NULL;
+  return conn->read_bytes(out, len);
 }
 
 /*
@@ -315,93 +993,64 @@ row_values *ESP32_MySQL_Query::get_next_row()
   It is also a good example of how to read a result set from the
   because it uses the public methods designed to return result
   sets from the server.
+
+  Every result of a multi-statement query or stored procedure is shown.
 */
 void ESP32_MySQL_Query::show_results() 
 {
   column_names *cols;
-  int rows = 0;
 
-  // Get the columns
-  cols = get_columns();
-  
-  if (cols == NULL) 
-  {
-    return;
-  }
+  // Keep the connection until the last result has been read
+  ESP32_MySQL_Lock_Guard guard(conn);
 
-  for (int f = 0; f < columns.num_fields; f++) 
+  do
   {
-    ESP32_MYSQL_LOGERROR0(columns.fields[f]->name);
+    if (!rows_pending)
+      continue;
     
-    if (f < columns.num_fields - 1)
-      ESP32_MYSQL_LOGERROR0(',');
-  }
-  
-  ESP32_MYSQL_LOGERROR0LN("");
-
-  // Read the rows
-  while (get_next_row()) 
-  {
-    rows++;
+    int rows = 0;
+    
+    // Get the columns
+    cols = get_columns();
     
+    if (cols == NULL) 
+    {
+      return;
+    }
+
     for (int f = 0; f < columns.num_fields; f++) 
     {
-      ESP32_MYSQL_LOGERROR0(row.values[f]);
+      ESP32_MYSQL_LOGERROR0(columns.fields[f]->name);
       
       if (f < columns.num_fields - 1)
         ESP32_MYSQL_LOGERROR0(',');
     }
     
-    free_row_buffer();
     ESP32_MYSQL_LOGERROR0LN("");
-  }
-
-  // Report how many rows were read
-  ESP32_MYSQL_LOGERROR0(rows);
-  ESP32_MYSQL_LOGERROR0LN(ROWS);
-  
-  free_columns_buffer();
-
-  // Free any post-query messages in queue for stored procedures
-  clear_ok_packet();
-}
-
-
-/*
-  clear_ok_packet - clear last Ok packet (if present)
-
-  This method reads the header and status to see if this is an Ok packet.
-  If it is, it reads the packet and discards it. This is useful for
-  processing result sets from stored procedures.
-
-  Returns False if the packet was not an Ok packet.
-*/
-bool ESP32_MySQL_Query::clear_ok_packet() 
-{
-  int num = 0;
 
-  do 
-  {
-    num = conn->client->available();
-    
-    if (num > 0) 
+    // Read the rows
+    while (get_next_row()) 
     {
-      if ( !conn->read_packet() || ( conn->packet_len <= 0 ) || ( conn->packet_len > MAX_TRANSMISSION_UNIT ) )
-        return false;
-      //////
+      rows++;
       
-      if (conn->get_packet_type() != ESP32_MYSQL_OK_PACKET) 
+      for (int f = 0; f < columns.num_fields; f++) 
       {
-        conn->parse_error_packet();
-        return false;
+        ESP32_MYSQL_LOGERROR0(row.values[f]);
+        
+        if (f < columns.num_fields - 1)
+          ESP32_MYSQL_LOGERROR0(',');
       }
+      
+      free_row_buffer();
+      ESP32_MYSQL_LOGERROR0LN("");
     }
-  } while (num > 0);
-  
-  rows_affected = -1;
-  last_insert_id = -1;
-  
-  return true;
+
+    // Report how many rows were read
+    ESP32_MYSQL_LOGERROR0(rows);
+    ESP32_MYSQL_LOGERROR0LN(ROWS);
+    
+    free_columns_buffer();
+  } while (next_result());
 }
 
 
@@ -419,7 +1068,7 @@ bool ESP32_MySQL_Query::clear_ok_packet()
 void ESP32_MySQL_Query::free_columns_buffer() 
 {
   // clear the columns
-  for (int f = 0; f < MAX_FIELDS; f++) 
+  for (int f = 0; f < cols_allocated; f++) 
   {
     if (columns.fields[f] != NULL) 
     {
@@ -438,81 +1087,134 @@ void ESP32_MySQL_Query::free_columns_buffer()
 
 
 /*
-  free_row_buffer - Free memory allocated for row values
-
-  This method frees the memory allocated during the get_next_row()
-  method.
+  free_row_buffer - Drop the values of the current row
 
-  NOTICE: You must call this method at least once after you
-          have consumed the values you wish to process. Failing
-          to do will result in a memory leak equal to the sum
-          of the length of values and one byte for each max cols.
+  The values live in the buffers of their columns, which are kept for
+  the next row and released by close().
 */
 void ESP32_MySQL_Query::free_row_buffer() 
 {
   // clear the row
-  for (int f = 0; f < MAX_FIELDS; f++) 
-  {
-    if (row.values[f] != NULL) 
-    {
-      free(row.values[f]);
-    }
-    
+  for (int f = 0; f < cols_allocated; f++) 
     row.values[f] = NULL;
+  
+  // No row: every column reads as NULL
+  if (row_nulls)
+    memset(row_nulls, 0xff, (cols_allocated + 7) / 8);
+}
+
+
+/*
+  free_out_params - Free the OUT parameter values of the last call()
+*/
+void ESP32_MySQL_Query::free_out_params() 
+{
+  for (int f = 0; f < num_out_params; f++) 
+  {
+    free(out_params.values[f]);
   }
+  
+  free(out_params.values);
+  
+  out_params.values = NULL;
+  num_out_params    = 0;
 }
 
 
 /*
   read_string - Retrieve a string from the buffer
 
-  This reads a string from the buffer. It reads the length of the string
-  as the first byte.
+  This reads a length coded string from the buffer: its length as a
+  length coded binary (1, 3, 4 or 9 bytes), then the bytes themselves.
+  Values may contain zero bytes (BLOBs); the copy is NUL terminated
+  after length bytes.
 
-  offset[in]      offset from start of buffer
+  offset[in]      offset from start of buffer, moved past the string
+  column[in]      (optional) copy to the value buffer of this column
+                  instead of a new allocation
 
-  Returns string - String from the buffer
+  Returns string - String from the buffer, "NULL" for SQL NULL, NULL if
+                   the string runs past the packet or out of memory
 */
-char *ESP32_MySQL_Query::read_string(int *offset) 
+char *ESP32_MySQL_Query::read_string(int *offset, const int& column) 
 {
   char *str;
+  const int end = conn->packet_len + 4;
   
   ESP32_MYSQL_LOGLEVEL5("ESP32_MySQL_Query::read_string: step 1");
   
-  int len_bytes = conn->get_lcb_len(conn->buffer[*offset]);
-  int len = conn->read_int(*offset, len_bytes);
+  if (*offset >= end)
+    return NULL;
+  
+  if (conn->buffer[*offset] == 0xfb) 
+  {
+    // This is a null field.
+    str = (column < 0) ? (char *) malloc(5) : value_buffer(column, 5);
+    
+    if (str)
+      strcpy(str, "NULL");
+      
+    *offset += 1;
+    
+    return str;
+  }
+  
+  int len_bytes = conn->get_lcb_len(*offset);
+  int len = conn->read_lcb_int(*offset);
   
   ESP32_MYSQL_LOGINFO1("ESP32_MySQL_Query::read_string: offset = ", *offset);
   ESP32_MYSQL_LOGINFO3("ESP32_MySQL_Query::read_string: len = ", len, "len_bytes =", len_bytes);
   
-  if (len == 251) 
+  if ( (len < 0) || (*offset + len_bytes + len > end) )
   {
-    // This is a null field.
-    str = (char *) malloc(5);
-    strcpy(str, "NULL");
-    str[4] = 0x00;
-    *offset += len_bytes;
+    ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Query::read_string: string runs past the packet, len =", len);
+    
+    *offset = end;
+    
+    return NULL;
   }
 
-  if ( (len < 251) && (len > 0) )
+  str = (column < 0) ? (char *) malloc(len + 1) : value_buffer(column, len + 1);
+  
+  if (str)
   {
-    str = (char *) malloc(len + 1);
-    
-    ESP32_MYSQL_LOGINFO3("ESP32_MySQL_Query::read_string: len = ", len, "conn->buffer size =", conn->largest_buffer_size);
-    
-    strncpy(str, (char *)&conn->buffer[*offset + len_bytes], len);
+    memcpy(str, &conn->buffer[*offset + len_bytes], len);
     str[len] = 0x00;
-    *offset += len_bytes + len;
     
     ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Query::read_string: str = ", str);
-    
-    return str;
   }
   
-  ESP32_MYSQL_LOGDEBUG("ESP32_MySQL_Query::read_string: return NULL");
+  *offset += len_bytes + len;
   
-  return NULL;
-  ////// 
+  return str;
+}
+
+
+/*
+  value_buffer - the value buffer of column, at least size bytes
+
+  Sized by read_column() from the column length, it only grows for a
+  longer value and is reused for every row.
+
+  Returns char * - NULL = out of memory
+*/
+char *ESP32_MySQL_Query::value_buffer(const int& column, const uint32_t& size)
+{
+  if (size > value_sizes[column])
+  {
+    char *buf = (char *) realloc(value_bufs[column], size);
+    
+    if (!buf)
+    {
+      ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Query: out of memory for a value, bytes =", size);
+      return NULL;
+    }
+    
+    value_bufs[column]  = buf;
+    value_sizes[column] = size;
+  }
+  
+  return value_bufs[column];
 }
 
 
@@ -539,7 +1241,7 @@ char *ESP32_MySQL_Query::read_string(int *offset)
   2                          (filler), always 0x00
   n (Length Coded Binary)    default
 
-  Note: the sum of all db, column, and field names must be < 255 in length
+  Note: the whole definition must fit in MAX_TRANSMISSION_UNIT bytes
 */
 int ESP32_MySQL_Query::get_field(field_struct *fs) 
 {
@@ -565,7 +1267,7 @@ int ESP32_MySQL_Query::get_field(field_struct *fs)
   {
     // calculate location of db
     len_bytes = conn->get_lcb_len(4);
-    len = conn->read_int(4, len_bytes);
+    len = conn->read_lcb_int(4);
     offset = 4 + len_bytes + len;
     
     ESP32_MYSQL_LOGDEBUG("ESP32_MySQL_Query::get_field: read_string to fs->db");
@@ -579,7 +1281,7 @@ int ESP32_MySQL_Query::get_field(field_struct *fs)
     
     // calculate location of name
     len_bytes = conn->get_lcb_len(offset);
-    len = conn->read_int(offset, len_bytes);
+    len = conn->read_lcb_int(offset);
     offset += len_bytes + len;
     
     // get name
@@ -587,6 +1289,25 @@ int ESP32_MySQL_Query::get_field(field_struct *fs)
     fs->name = read_string(&offset);
     ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Query::get_field: fs->name = ", fs->name);
     
+    // skip org_name and the filler
+    len_bytes = conn->get_lcb_len(offset);
+    len = conn->read_lcb_int(offset);
+    offset += len_bytes + len + 1;
+    
+    // the fixed part, if the packet holds it
+    if (offset + 10 <= conn->packet_len + 4)
+    {
+      const byte *fixed = &conn->buffer[offset];
+      
+      fs->charset   = fixed[0] | (fixed[1] << 8);
+      fs->length    = (uint32_t) fixed[2] | ((uint32_t) fixed[3] << 8) | ((uint32_t) fixed[4] << 16) | ((uint32_t) fixed[5] << 24);
+      fs->type      = fixed[6];
+      fs->flags     = fixed[7] | (fixed[8] << 8);
+      fs->decimals  = fixed[9];
+    }
+    
+    ESP32_MYSQL_LOGDEBUG3("ESP32_MySQL_Query::get_field: type = ", fs->type, ", length = ", fs->length);
+    
     //return 0;
     return ESP32_MYSQL_OK_PACKET;
   }
@@ -613,7 +1334,8 @@ int ESP32_MySQL_Query::get_field(field_struct *fs)
   Note: each column is store as a length coded string concatenated
         as a single stream
 
-  Returns integer - ESP32_MYSQL_EOF_PACKET if no more rows, 0 if more rows available
+  Returns integer - ESP32_MYSQL_EOF_PACKET if no more rows, 0 if more rows available,
+                    ESP32_MYSQL_ERROR_PACKET on an error or no response
 */
 int ESP32_MySQL_Query::get_row() 
 {
@@ -621,64 +1343,28 @@ int ESP32_MySQL_Query::get_row()
   ESP32_MYSQL_LOGDEBUG("ESP32_MySQL_Query::get_row: read_packet");
 
   if ( !conn->read_packet() || ( conn->packet_len <= 0 ) || ( conn->packet_len > MAX_TRANSMISSION_UNIT ) )
-    return ESP32_MYSQL_EOF_PACKET;    //ESP32_MYSQL_ERROR_PACKET;
-  //////
-
-  if (conn->buffer && conn->buffer[4] != ESP32_MYSQL_EOF_PACKET)
-    return ESP32_MYSQL_OK_PACKET;
-    
-  return ESP32_MYSQL_EOF_PACKET;
-}
-
-
-/*
-  get_fields - reads the fields from the read buffer
-
-  This method is used to read the field names, types, etc.
-  from the read buffer and store them in the columns structure
-  in the class.
-*/
-bool ESP32_MySQL_Query::get_fields()
-{
-  int num_fields = 0;
-  int res = 0;
-
-  if (conn->buffer == NULL) 
   {
-    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Query::get_fields: NULL buffer");
-    return false;
+    // An oversize row is left unread, a failed read is half done
+    conn->close();
+    return ESP32_MYSQL_ERROR_PACKET;
   }
+  //////
+
+  // A row may start with 0xfe too (8 byte length), but is never that short
+  if ( (conn->buffer[4] == ESP32_MYSQL_EOF_PACKET) && (conn->packet_len < 9) )
+    return ESP32_MYSQL_EOF_PACKET;
   
-  num_fields = conn->buffer[4]; // From result header packet
-  columns.num_fields = num_fields;
-  num_cols = num_fields; // Save this for later use
-  
-  for (int f = 0; f < num_fields; f++) 
+  // The statement failed part way through the rows
+  if (conn->buffer[4] == ESP32_MYSQL_ERROR_PACKET)
   {
-    field_struct *field = (field_struct *) malloc(sizeof(field_struct));
-    res = get_field(field);
-    
-    //if (res == ESP32_MYSQL_EOF_PACKET) 
-    if ( (res == ESP32_MYSQL_EOF_PACKET) || (res == ESP32_MYSQL_ERROR_PACKET) )
-    {
-      ESP32_MYSQL_LOGERROR(BAD_MOJO);
-      
-      return false;
-    }
-    
-    columns.fields[f] = field;
+    conn->parse_error_packet();
+    return ESP32_MYSQL_ERROR_PACKET;
   }
-
-  // EOF packet
-  ESP32_MYSQL_LOGDEBUG("ESP32_MySQL_Query::get_fields: read_packet");
-  
-  if ( !conn->read_packet() || ( conn->packet_len <= 0 ) || ( conn->packet_len > MAX_TRANSMISSION_UNIT ) )
-    return false;
-  //////
-  
-  return true;
+    
+  return ESP32_MYSQL_OK_PACKET;
 }
 
+
 /*
   get_row_values - reads the row values from the read buffer
 
@@ -697,7 +1383,7 @@ int ESP32_MySQL_Query::get_row_values()
   {
     ESP32_MYSQL_LOGERROR(READ_COLS);
     
-    return ESP32_MYSQL_EOF_PACKET;
+    return ESP32_MYSQL_ERROR_PACKET;
   }
   
   // Drop any row data already read
@@ -712,15 +1398,171 @@ int ESP32_MySQL_Query::get_row_values()
   {
     offset = 4;
     
+    memset(row_nulls, 0, (num_cols + 7) / 8);
+    
     for (int f = 0; f < num_cols; f++) 
     {
-      row.values[f] = read_string(&offset);
+      // read_string() turns NULL into "NULL", so note it here
+      if (conn->buffer[offset] == 0xfb)
+        row_nulls[f / 8] |= (1 << (f % 8));
+        
+      row.values[f] = read_string(&offset, f);
     }
   }
   
   return res;
 }
 
+/*
+  is_null - whether column of the current row is SQL NULL
+
+  Returns bool - True = NULL, or no such column
+*/
+bool ESP32_MySQL_Query::is_null(const int& column) const
+{
+  if ( (column < 0) || (column >= num_cols) || !columns_read )
+    return true;
+    
+  return row_nulls[column / 8] & (1 << (column % 8));
+}
+
+// Text of column in the current row, "" for an empty value
+const char *ESP32_MySQL_Query::value_text(const int& column) const
+{
+  return row.values[column] ? row.values[column] : "";
+}
+
+/*
+  get_int64 - column of the current row as an integer
+
+  UNSIGNED BIGINT values above INT64_MAX wrap, as they would in a cast.
+  Floating point and DECIMAL values are truncated.
+
+  Returns int64_t - 0 for NULL and for dates and times
+*/
+int64_t ESP32_MySQL_Query::get_int64(const int& column) const
+{
+  if (is_null(column))
+    return 0;
+    
+  const field_struct *field = columns.fields[column];
+  const char *value = value_text(column);
+  
+  switch (field->type)
+  {
+    case MYSQL_TYPE_FLOAT:
+    case MYSQL_TYPE_DOUBLE:
+    case MYSQL_TYPE_DECIMAL:
+    case MYSQL_TYPE_NEWDECIMAL:
+      return (int64_t) strtod(value, NULL);
+      
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+    case MYSQL_TYPE_TIME:
+      return 0;
+      
+    default:
+      break;
+  }
+  
+  if (field->flags & UNSIGNED_FLAG)
+    return (int64_t) strtoull(value, NULL, 10);
+    
+  return strtoll(value, NULL, 10);
+}
+
+/*
+  get_double - column of the current row as a double
+
+  Returns double - 0 for NULL and for dates and times
+*/
+double ESP32_MySQL_Query::get_double(const int& column) const
+{
+  if (is_null(column))
+    return 0;
+    
+  switch (columns.fields[column]->type)
+  {
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+    case MYSQL_TYPE_TIME:
+      return 0;
+      
+    default:
+      break;
+  }
+  
+  return strtod(value_text(column), NULL);
+}
+
+/*
+  get_datetime - DATE, DATETIME, TIMESTAMP or TIME column of the current row
+
+  Parses "YYYY-MM-DD", "YYYY-MM-DD hh:mm:ss[.ffffff]" and, for TIME,
+  "[-]hhh:mm:ss[.ffffff]" with hours split into days and hours.
+
+  value[out]      Parts of the value
+
+  Returns bool - False = NULL or not a date / time column
+*/
+bool ESP32_MySQL_Query::get_datetime(const int& column, MySQL_DateTime *value) const
+{
+  memset(value, 0, sizeof(MySQL_DateTime));
+  
+  if (is_null(column))
+    return false;
+    
+  const uint8_t type = columns.fields[column]->type;
+  const char *text = value_text(column);
+  char *end;
+  
+  if (type == MYSQL_TYPE_TIME)
+  {
+    if (*text == '-')
+    {
+      value->negative = true;
+      text++;
+    }
+    
+    const unsigned long hours = strtoul(text, &end, 10);
+    
+    value->day    = hours / 24;
+    value->hour   = hours % 24;
+    value->minute = (*end == ':') ? strtoul(end + 1, &end, 10) : 0;
+    value->second = (*end == ':') ? strtoul(end + 1, &end, 10) : 0;
+  }
+  else if ( (type == MYSQL_TYPE_DATE) || (type == MYSQL_TYPE_DATETIME) || (type == MYSQL_TYPE_TIMESTAMP) )
+  {
+    value->year   = strtoul(text, &end, 10);
+    value->month  = (*end == '-') ? strtoul(end + 1, &end, 10) : 0;
+    value->day    = (*end == '-') ? strtoul(end + 1, &end, 10) : 0;
+    
+    if (*end == ' ')
+    {
+      value->hour   = strtoul(end + 1, &end, 10);
+      value->minute = (*end == ':') ? strtoul(end + 1, &end, 10) : 0;
+      value->second = (*end == ':') ? strtoul(end + 1, &end, 10) : 0;
+    }
+  }
+  else
+  {
+    return false;
+  }
+  
+  // Fraction of up to 6 digits, in microseconds
+  if (*end == '.')
+  {
+    uint32_t scale = 100000;
+    
+    for (const char *digit = end + 1; (*digit >= '0') && (*digit <= '9') && (scale > 0); digit++, scale /= 10)
+      value->microsecond += (*digit - '0') * scale;
+  }
+  
+  return true;
+}
+
 #endif    // WITH_SELECT
 
 #endif    // ESP32_MySQL_Query_IMPL_H
@@ -0,0 +1,108 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Reactor.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  A small poll() based event loop
+
+  One task can service many connections, listening sockets and timers:
+  the reactor sleeps in a single poll() until one of them needs
+  attention, then calls its handler. Connections are watched for
+  readability only (a response, or the server dropping an idle
+  connection): writes to them block until sent. get_io_state() tells a
+  handler whether a response is still outstanding.
+
+  A connection is watched through its socket descriptor. Every connect,
+  reconnect() included, forgets it, so give the connection a provider
+  that is asked after each one:
+
+    conn.set_socket_fd_provider([](void *c) { return ((WiFiClient *) c)->fd(); }, &client);
+
+  Without a descriptor the reactor falls back to checking
+  bytes_available() every ESP32_MYSQL_REACTOR_POLL_MS.
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_REACTOR_H
+#define ESP32_MYSQL_REACTOR_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <ESP32_MySQL_Connection.h>
+
+#include <sys/poll.h>
+
+#ifndef ESP32_MYSQL_REACTOR_MAX_SOURCES
+  #define ESP32_MYSQL_REACTOR_MAX_SOURCES   16      // connections + descriptors + timers
+#endif
+
+#ifndef ESP32_MYSQL_REACTOR_POLL_MS
+  #define ESP32_MYSQL_REACTOR_POLL_MS       10      // poll period for connections without descriptor
+#endif
+
+// Event bits passed to a Reactor_Handler
+#define REACTOR_READABLE      0x01
+#define REACTOR_WRITABLE      0x02
+#define REACTOR_ERROR         0x04
+#define REACTOR_TIMER         0x08
+
+typedef void (*Reactor_Handler)(int id, uint8_t events, void *arg);
+
+class ESP32_MySQL_Reactor
+{
+  public:
+    ESP32_MySQL_Reactor();
+
+    int   add_connection(ESP32_MySQL_Connection *conn, Reactor_Handler handler, void *arg = NULL);
+    int   add_fd(int fd, uint8_t events, Reactor_Handler handler, void *arg = NULL);
+    int   add_timer(const uint32_t& interval_ms, Reactor_Handler handler, void *arg = NULL, bool repeat = true);
+    void  remove(int id);
+
+    int   run_once(const uint32_t& max_wait_ms);
+    void  run();
+
+    void  stop()
+    {
+      running = false;
+    }
+
+  private:
+    typedef enum
+    {
+      SOURCE_FREE = 0,
+      SOURCE_CONNECTION,
+      SOURCE_FD,
+      SOURCE_TIMER
+    } Source_Type;
+
+    typedef struct
+    {
+      Source_Type             type;
+      Reactor_Handler         handler;
+      void                    *arg;
+      ESP32_MySQL_Connection  *conn;
+      int                     fd;
+      uint8_t                 events;       // interest for SOURCE_FD
+      uint32_t                interval_ms;  // SOURCE_TIMER
+      unsigned long           due;
+      bool                    repeat;
+    } Source;
+
+    int   add(const Source& source);
+
+    Source  sources[ESP32_MYSQL_REACTOR_MAX_SOURCES];
+    bool    running;
+};
+
+#endif    // ESP32_MYSQL_REACTOR_H
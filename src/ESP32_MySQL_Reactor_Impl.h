@@ -0,0 +1,285 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Reactor_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_REACTOR_IMPL_H
+#define ESP32_MYSQL_REACTOR_IMPL_H
+
+#include <ESP32_MySQL_Reactor.h>
+
+ESP32_MySQL_Reactor::ESP32_MySQL_Reactor()
+{
+  memset(sources, 0, sizeof(sources));
+  running = false;
+}
+
+int ESP32_MySQL_Reactor::add(const Source& source)
+{
+  for (int i = 0; i < ESP32_MYSQL_REACTOR_MAX_SOURCES; i++)
+  {
+    if (sources[i].type == SOURCE_FREE)
+    {
+      sources[i] = source;
+      return i;
+    }
+  }
+
+  ESP32_MYSQL_LOGERROR("ESP32_MySQL_Reactor: too many sources");
+
+  return -1;
+}
+
+/*
+  add_connection - watch a connection
+
+  The handler gets REACTOR_READABLE when the server sent data and
+  REACTOR_ERROR when the socket failed or was closed.
+
+  Returns int - source id, -1 = no free slot
+*/
+int ESP32_MySQL_Reactor::add_connection(ESP32_MySQL_Connection *conn, Reactor_Handler handler, void *arg)
+{
+  Source source;
+
+  memset(&source, 0, sizeof(source));
+  source.type     = SOURCE_CONNECTION;
+  source.handler  = handler;
+  source.arg      = arg;
+  source.conn     = conn;
+  source.fd       = -1;
+
+  return add(source);
+}
+
+/*
+  add_fd - watch any descriptor, e.g. a listening socket
+
+  events[in]      REACTOR_READABLE and/or REACTOR_WRITABLE
+
+  Returns int - source id, -1 = no free slot
+*/
+int ESP32_MySQL_Reactor::add_fd(int fd, uint8_t events, Reactor_Handler handler, void *arg)
+{
+  Source source;
+
+  memset(&source, 0, sizeof(source));
+  source.type     = SOURCE_FD;
+  source.handler  = handler;
+  source.arg      = arg;
+  source.fd       = fd;
+  source.events   = events;
+
+  return add(source);
+}
+
+/*
+  add_timer - call handler with REACTOR_TIMER every interval_ms
+
+  repeat[in]      False = fire once, then remove the timer
+
+  Returns int - source id, -1 = no free slot
+*/
+int ESP32_MySQL_Reactor::add_timer(const uint32_t& interval_ms, Reactor_Handler handler, void *arg, bool repeat)
+{
+  Source source;
+
+  memset(&source, 0, sizeof(source));
+  source.type         = SOURCE_TIMER;
+  source.handler      = handler;
+  source.arg          = arg;
+  source.fd           = -1;
+  source.interval_ms  = interval_ms;
+  source.due          = millis() + interval_ms;
+  source.repeat       = repeat;
+
+  return add(source);
+}
+
+void ESP32_MySQL_Reactor::remove(int id)
+{
+  if ((id >= 0) && (id < ESP32_MYSQL_REACTOR_MAX_SOURCES))
+    sources[id].type = SOURCE_FREE;
+}
+
+/*
+  run_once - wait for events once and dispatch them
+
+  Sleeps in poll() until a watched descriptor is ready, the next timer is
+  due or max_wait_ms passed, whichever comes first. Data already
+  decrypted by TLS or watched connections without a descriptor shorten
+  the wait, as poll() can't see them.
+
+  max_wait_ms[in]  Longest time to block
+
+  Returns int - number of handlers called, -1 = poll() failed
+*/
+int ESP32_MySQL_Reactor::run_once(const uint32_t& max_wait_ms)
+{
+  struct pollfd fds[ESP32_MYSQL_REACTOR_MAX_SOURCES];
+  int           owner[ESP32_MYSQL_REACTOR_MAX_SOURCES];
+  nfds_t        nfds      = 0;
+  long          wait_ms   = max_wait_ms;
+  int           dispatched = 0;
+
+  const unsigned long now = millis();
+
+  for (int i = 0; i < ESP32_MYSQL_REACTOR_MAX_SOURCES; i++)
+  {
+    Source& source = sources[i];
+    short   interest = 0;
+    int     fd = source.fd;
+
+    if (source.type == SOURCE_TIMER)
+    {
+      long remaining = (long) (source.due - now);
+
+      if (remaining < wait_ms)
+        wait_ms = (remaining > 0) ? remaining : 0;
+
+      continue;
+    }
+    else if (source.type == SOURCE_CONNECTION)
+    {
+      ESP32_MySQL_Connection *conn = source.conn;
+
+      fd = conn->socket_fd();
+
+      // Buffered bytes are invisible to poll()
+      if (conn->bytes_available() > 0)
+        wait_ms = 0;
+      else if ((fd < 0) && (wait_ms > ESP32_MYSQL_REACTOR_POLL_MS))
+        wait_ms = ESP32_MYSQL_REACTOR_POLL_MS;
+
+      interest = POLLIN;
+    }
+    else if (source.type == SOURCE_FD)
+    {
+      if (source.events & REACTOR_READABLE)
+        interest |= POLLIN;
+
+      if (source.events & REACTOR_WRITABLE)
+        interest |= POLLOUT;
+    }
+
+    if ((fd >= 0) && interest)
+    {
+      fds[nfds].fd      = fd;
+      fds[nfds].events  = interest;
+      fds[nfds].revents = 0;
+      owner[nfds]       = i;
+      nfds++;
+    }
+  }
+
+  int ready = 0;
+
+  if (nfds > 0)
+  {
+    ready = poll(fds, nfds, (int) wait_ms);
+
+    if (ready < 0)
+    {
+      ESP32_MYSQL_LOGERROR("ESP32_MySQL_Reactor: poll failed");
+      return -1;
+    }
+  }
+  else if (wait_ms > 0)
+  {
+    delay(wait_ms);
+  }
+
+  // Descriptor events
+  for (nfds_t n = 0; (n < nfds) && (ready > 0); n++)
+  {
+    if (fds[n].revents == 0)
+      continue;
+
+    Source& source = sources[owner[n]];
+    uint8_t events = 0;
+
+    if (fds[n].revents & POLLIN)
+      events |= REACTOR_READABLE;
+
+    if (fds[n].revents & POLLOUT)
+      events |= REACTOR_WRITABLE;
+
+    if (fds[n].revents & (POLLERR | POLLHUP | POLLNVAL))
+      events |= REACTOR_ERROR;
+
+    ready--;
+
+    if ((source.type != SOURCE_FREE) && source.handler)
+    {
+      source.handler(owner[n], events, source.arg);
+      dispatched++;
+    }
+  }
+
+  // Connections poll() can't see, and timers
+  for (int i = 0; i < ESP32_MYSQL_REACTOR_MAX_SOURCES; i++)
+  {
+    Source& source = sources[i];
+
+    if (source.type == SOURCE_CONNECTION)
+    {
+      bool watched = false;
+
+      for (nfds_t n = 0; n < nfds; n++)
+      {
+        if ((owner[n] == i) && fds[n].revents)
+          watched = true;
+      }
+
+      if (!watched && source.handler && (source.conn->bytes_available() > 0))
+      {
+        source.handler(i, REACTOR_READABLE, source.arg);
+        dispatched++;
+      }
+    }
+    else if ((source.type == SOURCE_TIMER) && ((long) (millis() - source.due) >= 0))
+    {
+      if (source.repeat)
+        source.due += source.interval_ms;
+      else
+        source.type = SOURCE_FREE;
+
+      if (source.handler)
+      {
+        source.handler(i, REACTOR_TIMER, source.arg);
+        dispatched++;
+      }
+    }
+  }
+
+  return dispatched;
+}
+
+/*
+  run - dispatch events until stop() is called from a handler
+*/
+void ESP32_MySQL_Reactor::run()
+{
+  running = true;
+
+  while (running)
+  {
+    if (run_once(1000) < 0)
+      delay(ESP32_MYSQL_REACTOR_POLL_MS);
+
+    yield();
+  }
+}
+
+#endif    // ESP32_MYSQL_REACTOR_IMPL_H
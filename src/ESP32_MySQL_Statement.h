@@ -0,0 +1,316 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Statement.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Server-side prepared statements
+
+  The server parses the SQL once in prepare(); each execute() then only
+  sends the statement id and the parameter values in binary form, so
+  numbers are neither formatted on the device nor parsed on the server:
+
+    ESP32_MySQL_Statement insert(&conn);
+
+    insert.prepare("INSERT INTO test.readings (sensor, value, raw) VALUES (?, ?, ?)");
+
+    insert.bind_int(0, sensor_id);
+    insert.bind_float(1, temperature);
+    insert.bind_blob(2, samples, sizeof(samples));
+    insert.execute();
+
+  A statement that returns rows delivers them in binary form, decoded
+  from the packet buffer without going through text:
+
+    select.prepare("SELECT id, value, stamp FROM test.readings WHERE sensor = ?");
+    select.bind_int(0, sensor_id);
+
+    if (select.execute())
+    {
+      while (select.fetch())
+      {
+        int64_t         id    = select.get_int64(0);
+        double          value = select.get_double(1);
+        MySQL_DateTime  stamp;
+
+        select.get_datetime(2, &stamp);
+      }
+    }
+
+  Values point into the connection buffer and are valid until the next
+  fetch(). Read the rows to the end (or call free_result()) before using
+  the connection for anything else.
+
+  For large results, set_fetch_size(n) opens a read-only cursor on the
+  server instead: execute() returns before any row is sent, and fetch()
+  asks for n rows at a time (COM_STMT_FETCH). The connection is free for
+  other statements between batches, and free_result() closes the cursor
+  after at most n unread rows.
+
+  Values too large for one packet (or for RAM) go up in pieces with
+  COM_STMT_SEND_LONG_DATA during execute(), from memory, a Stream such
+  as a File, or a callback that fills the buffer it is given:
+
+    upload.bind_long_data(0, samples, sizeof(samples));
+    upload.bind_long_data(1, file);
+    upload.bind_long_data(2, next_chunk, &state);
+    upload.execute();
+
+  Only ESP32_MYSQL_LONG_DATA_CHUNK bytes are held at a time. Streams and
+  callbacks are read once, so bind them again before the next execute().
+
+  Rows of parameters can also go to the server together: add_batch()
+  copies the current bindings, execute_batch() runs the statement once
+  per row copied:
+
+    for (int i = 0; i < count; i++)
+    {
+      insert.bind_int(0, readings[i].sensor);
+      insert.bind_float(1, readings[i].value);
+      insert.add_batch();
+    }
+
+    insert.execute_batch();
+
+  MariaDB gets the whole batch in one COM_STMT_BULK_EXECUTE packet. On
+  MySQL the executes are pipelined: all written at once, then all
+  responses read, for a single round trip either way.
+
+  Bindings stay in place between executions, so only the values that
+  changed need binding again. Strings and blobs are not copied: keep them
+  valid until execute() returns. If the connection logs in again (see
+  reconnect() and reset()) the statement is prepared again on its next
+  execute().
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_STATEMENT_H
+#define ESP32_MYSQL_STATEMENT_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <ESP32_MySQL_Connection.h>
+
+#ifndef ESP32_MYSQL_LONG_DATA_CHUNK
+  #define ESP32_MYSQL_LONG_DATA_CHUNK   1024    // bytes per COM_STMT_SEND_LONG_DATA packet
+#endif
+
+#ifndef ESP32_MYSQL_BATCH_BYTES
+  #define ESP32_MYSQL_BATCH_BYTES       8192    // parameter values held by add_batch()
+#endif
+
+// A bound parameter value
+typedef struct
+{
+  uint8_t           type;         // MYSQL_TYPE_xxx, MYSQL_TYPE_NULL = NULL or unbound
+  union
+  {
+    int64_t         i;
+    float           f;
+    double          d;
+  } value;
+  const uint8_t     *data;        // MYSQL_TYPE_STRING / MYSQL_TYPE_BLOB, not copied
+  size_t            length;
+  bool              long_data;    // sent with COM_STMT_SEND_LONG_DATA, from data or source
+  Long_Data_Source  source;
+  void              *context;
+} Statement_Param;
+
+class ESP32_MySQL_Statement
+{
+  public:
+    ESP32_MySQL_Statement(ESP32_MySQL_Connection *connection);
+    ~ESP32_MySQL_Statement();
+
+    bool prepare(const char *query);
+    bool execute();
+    void close();
+
+    bool bind_int(const uint16_t& index, const int64_t& value);
+    bool bind_float(const uint16_t& index, const float& value);
+    bool bind_double(const uint16_t& index, const double& value);
+    bool bind_string(const uint16_t& index, const char *value);
+    bool bind_blob(const uint16_t& index, const uint8_t *data, const size_t& length);
+    bool bind_null(const uint16_t& index);
+
+    // Sent in pieces during execute()
+    bool bind_long_data(const uint16_t& index, const uint8_t *data, const size_t& length);
+    bool bind_long_data(const uint16_t& index, Stream& stream);
+    bool bind_long_data(const uint16_t& index, Long_Data_Source source, void *context = NULL);
+
+    void clear_bindings();
+
+    // Rows of parameters executed together
+    bool add_batch();
+    bool execute_batch();
+    void clear_batch();
+
+    uint16_t get_batch_rows() const
+    {
+      return batch_rows;
+    }
+
+    // Rows that failed in the last execute_batch()
+    uint16_t get_batch_errors() const
+    {
+      return batch_errors;
+    }
+
+    // Rows of a statement that returns a result set
+    bool fetch();
+    void free_result();
+
+    // Rows per COM_STMT_FETCH, 0 = no cursor, all rows follow execute()
+    void set_fetch_size(const uint32_t& rows)
+    {
+      fetch_size = rows;
+    }
+
+    uint32_t get_fetch_size() const
+    {
+      return fetch_size;
+    }
+
+    bool has_open_cursor() const
+    {
+      return cursor_open;
+    }
+
+    bool has_result_set() const
+    {
+      return rows_pending || cursor_open;
+    }
+
+    bool      is_null(const uint16_t& column) const;
+    int64_t   get_int64(const uint16_t& column) const;
+    double    get_double(const uint16_t& column) const;
+    bool      get_datetime(const uint16_t& column, MySQL_DateTime *value) const;
+    const uint8_t *get_bytes(const uint16_t& column, size_t *length) const;
+
+    uint8_t get_column_type(const uint16_t& column) const
+    {
+      return (column < result_columns) ? column_types[column] : (uint8_t) MYSQL_TYPE_NULL;
+    }
+
+    bool is_prepared() const
+    {
+      return prepared;
+    }
+
+    const char *get_sql() const
+    {
+      return sql;
+    }
+
+    size_t get_memory_use() const;
+
+    uint32_t get_statement_id() const
+    {
+      return statement_id;
+    }
+
+    // Parameter metadata from the server
+    uint16_t get_param_count() const
+    {
+      return num_params;
+    }
+
+    uint8_t get_param_type(const uint16_t& index) const
+    {
+      return (index < num_params) ? param_types[index] : (uint8_t) MYSQL_TYPE_NULL;
+    }
+
+    uint16_t get_column_count() const
+    {
+      return num_columns;
+    }
+
+    int get_rows_affected() const
+    {
+      return rows_affected;
+    }
+
+    int get_last_insert_id() const
+    {
+      return last_insert_id;
+    }
+
+    uint16_t get_server_status() const
+    {
+      return server_status;
+    }
+
+    ESP32_MySQL_Connection *connection()
+    {
+      return conn;
+    }
+
+  private:
+    bool  prepare_on_server();
+    bool  read_definitions(const uint16_t& count, uint8_t *types, uint16_t *flags = NULL);
+    bool  read_result_columns();
+    bool  send_long_data();
+    bool  send_long_data_packet(const uint16_t& index, const size_t& length);
+    bool  send_execute();
+    bool  send_bulk_execute();
+    bool  send_batch_executes();
+    bool  read_batch_responses(const uint16_t& count, const uint16_t& rows_each);
+    size_t value_size(const Statement_Param& p) const;
+    int   store_value(byte *buff, const Statement_Param& p) const;
+    bool  read_execute_response();
+    bool  skip_result_set();
+    bool  skip_more_results();
+    bool  fetch_batch();
+    void  reset_cursor();
+    bool  parse_row();
+    int   value_offset(const uint16_t& column) const;
+    Statement_Param *param(const uint16_t& index);
+    void  release_connection();
+
+    ESP32_MySQL_Connection *conn;
+
+    char            *sql;             // kept to prepare again in a new session
+    uint32_t        statement_id;
+    uint32_t        session;          // conn->get_session() when prepared
+    uint16_t        num_params;
+    uint16_t        num_columns;
+    uint8_t         *param_types;
+    Statement_Param *params;
+    bool            prepared;
+    bool            holds_lock;
+    bool            rejected;         // the last failure was an error packet, nothing else to read
+
+    // Current result set
+    uint16_t        result_columns;
+    uint16_t        columns_allocated;
+    uint8_t         *column_types;
+    uint16_t        *column_flags;
+    int             *value_offsets;   // of each value in conn->buffer, 0 = NULL
+    bool            rows_pending;     // rows of this batch still to read, connection locked
+    bool            cursor_open;      // server holds more rows for COM_STMT_FETCH
+    uint32_t        fetch_size;
+
+    // Rows of add_batch(), an indicator and the value of each parameter
+    uint8_t         *batch;
+    size_t          batch_len;
+    size_t          batch_size;
+    uint16_t        batch_rows;
+    uint16_t        batch_errors;
+    uint8_t         *batch_types;     // of each parameter, the same in every row
+
+    int             rows_affected;
+    int             last_insert_id;
+    uint16_t        server_status;
+};
+
+#endif    // ESP32_MYSQL_STATEMENT_H
@@ -0,0 +1,198 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Statement_Cache.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Prepared statement cache
+
+  Keeps the statements of one connection prepared on the server, keyed
+  by their SQL text, so an application that repeats a handful of
+  statements never handles statement ids itself:
+
+    ESP32_MySQL_Statement_Cache cache(&conn);
+
+    cache.execute_cached("INSERT INTO test.readings (sensor, value) VALUES (?, ?)", sensor_id, temperature);
+
+    ESP32_MySQL_Statement *select = cache.execute_cached("SELECT value FROM test.readings WHERE id = ?", id);
+
+    while (select && select->fetch())
+      Serial.println(select->get_double(0));
+
+  Arguments are bound in order: integers with bind_int(), float and
+  double with bind_float() / bind_double(), strings with bind_string()
+  and nullptr with bind_null(). Parameters without an argument are NULL.
+
+  The least recently used statement is closed (COM_STMT_CLOSE) when the
+  cache holds max_statements statements or more than max_bytes of heap.
+  Statements do not survive a new session, so the cache empties itself
+  after reconnect(), reset() or change_user().
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_STATEMENT_CACHE_H
+#define ESP32_MYSQL_STATEMENT_CACHE_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <type_traits>
+
+#include <ESP32_MySQL_Statement.h>
+
+#ifndef ESP32_MYSQL_STATEMENT_CACHE_SIZE
+  #define ESP32_MYSQL_STATEMENT_CACHE_SIZE      8         // statements
+#endif
+
+#ifndef ESP32_MYSQL_STATEMENT_CACHE_BYTES
+  #define ESP32_MYSQL_STATEMENT_CACHE_BYTES     4096      // heap of all cached statements
+#endif
+
+class ESP32_MySQL_Statement_Cache
+{
+  public:
+    ESP32_MySQL_Statement_Cache(ESP32_MySQL_Connection *connection,
+                                const uint8_t& max_statements = ESP32_MYSQL_STATEMENT_CACHE_SIZE,
+                                const size_t& max_bytes = ESP32_MYSQL_STATEMENT_CACHE_BYTES);
+    ~ESP32_MySQL_Statement_Cache();
+
+    /*
+      execute_cached - execute sql with args, preparing it on a miss
+
+      Returns ESP32_MySQL_Statement * - the executed statement, valid until
+                                        it is evicted; NULL = failed
+    */
+    template <typename... Args>
+    ESP32_MySQL_Statement *execute_cached(const char *sql, const Args&... args)
+    {
+      ESP32_MySQL_Statement *stmt = statement(sql);
+
+      if (!stmt)
+        return NULL;
+
+      stmt->clear_bindings();
+
+      if ( !bind_all(stmt, 0, args...) || !stmt->execute() )
+        return NULL;
+
+      return stmt;
+    }
+
+    ESP32_MySQL_Statement *statement(const char *sql);
+    void clear();
+
+    uint8_t count() const
+    {
+      return num_entries;
+    }
+
+    size_t memory_use() const;
+
+    // Counters since construction
+    uint32_t hits() const
+    {
+      return num_hits;
+    }
+
+    uint32_t misses() const
+    {
+      return num_misses;
+    }
+
+    uint32_t evictions() const
+    {
+      return num_evictions;
+    }
+
+    uint32_t invalidations() const
+    {
+      return num_invalidations;
+    }
+
+    ESP32_MySQL_Connection *connection()
+    {
+      return conn;
+    }
+
+  private:
+    typedef struct
+    {
+      uint32_t                hash;       // of the SQL text
+      uint32_t                last_used;
+      ESP32_MySQL_Statement   *stmt;
+    } Entry;
+
+    void  evict_lru(const ESP32_MySQL_Statement *keep);
+    void  remove(const uint8_t& index);
+
+    // Binds execute_cached() arguments from index on
+    static bool bind_all(ESP32_MySQL_Statement *, const uint16_t&)
+    {
+      return true;
+    }
+
+    template <typename T, typename... Rest>
+    static bool bind_all(ESP32_MySQL_Statement *stmt, const uint16_t& index, const T& value, const Rest&... rest)
+    {
+      return bind_value(stmt, index, value) && bind_all(stmt, index + 1, rest...);
+    }
+
+    // One overload per argument type
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value, bool>::type
+    bind_value(ESP32_MySQL_Statement *stmt, const uint16_t& index, const T& value)
+    {
+      return stmt->bind_int(index, (int64_t) value);
+    }
+
+    static bool bind_value(ESP32_MySQL_Statement *stmt, const uint16_t& index, const float& value)
+    {
+      return stmt->bind_float(index, value);
+    }
+
+    static bool bind_value(ESP32_MySQL_Statement *stmt, const uint16_t& index, const double& value)
+    {
+      return stmt->bind_double(index, value);
+    }
+
+    static bool bind_value(ESP32_MySQL_Statement *stmt, const uint16_t& index, const char *value)
+    {
+      return stmt->bind_string(index, value);
+    }
+
+    static bool bind_value(ESP32_MySQL_Statement *stmt, const uint16_t& index, const String& value)
+    {
+      return stmt->bind_string(index, value.c_str());
+    }
+
+    static bool bind_value(ESP32_MySQL_Statement *stmt, const uint16_t& index, const std::nullptr_t&)
+    {
+      return stmt->bind_null(index);
+    }
+
+    ESP32_MySQL_Connection *conn;
+
+    Entry     entries[ESP32_MYSQL_STATEMENT_CACHE_SIZE];
+    uint8_t   num_entries;
+    uint8_t   max_entries;
+    size_t    max_bytes;
+
+    uint32_t  session;          // conn->get_session() of the cached statements
+    uint32_t  clock;            // bumped on every lookup, for last_used
+
+    uint32_t  num_hits;
+    uint32_t  num_misses;
+    uint32_t  num_evictions;
+    uint32_t  num_invalidations;
+};
+
+#endif    // ESP32_MYSQL_STATEMENT_CACHE_H
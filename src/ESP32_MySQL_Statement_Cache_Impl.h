@@ -0,0 +1,170 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Statement_Cache_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_STATEMENT_CACHE_IMPL_H
+#define ESP32_MYSQL_STATEMENT_CACHE_IMPL_H
+
+#include <new>
+
+#include <ESP32_MySQL_Statement_Cache.h>
+
+ESP32_MySQL_Statement_Cache::ESP32_MySQL_Statement_Cache(ESP32_MySQL_Connection *connection,
+                                                         const uint8_t& max_statements, const size_t& max_bytes)
+{
+  conn              = connection;
+  num_entries       = 0;
+  max_entries       = (max_statements == 0) ? 1 : (max_statements > ESP32_MYSQL_STATEMENT_CACHE_SIZE) ?
+                      ESP32_MYSQL_STATEMENT_CACHE_SIZE : max_statements;
+  this->max_bytes   = max_bytes;
+  session           = conn->get_session();
+  clock             = 0;
+  num_hits          = 0;
+  num_misses        = 0;
+  num_evictions     = 0;
+  num_invalidations = 0;
+}
+
+ESP32_MySQL_Statement_Cache::~ESP32_MySQL_Statement_Cache()
+{
+  clear();
+}
+
+/*
+  statement - the cached statement for sql, prepared on a miss
+
+  sql[in]         SQL statement, copied on a miss
+
+  Returns ESP32_MySQL_Statement * - NULL = prepare failed
+*/
+ESP32_MySQL_Statement *ESP32_MySQL_Statement_Cache::statement(const char *sql)
+{
+  // The server dropped every statement id of the old session
+  if (session != conn->get_session())
+  {
+    if (num_entries > 0)
+    {
+      ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Statement_Cache: new session, dropping", num_entries);
+      num_invalidations++;
+    }
+
+    clear();
+    session = conn->get_session();
+  }
+
+  const uint32_t hash = SQL_hash_string(sql);
+
+  clock++;
+
+  for (uint8_t i = 0; i < num_entries; i++)
+  {
+    if ( (entries[i].hash == hash) && (strcmp(entries[i].stmt->get_sql(), sql) == 0) )
+    {
+      entries[i].last_used = clock;
+      num_hits++;
+
+      return entries[i].stmt;
+    }
+  }
+
+  num_misses++;
+
+  if (num_entries >= max_entries)
+    evict_lru(NULL);
+
+  ESP32_MySQL_Statement *stmt = new (std::nothrow) ESP32_MySQL_Statement(conn);
+
+  if (!stmt)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement_Cache: out of memory");
+    return NULL;
+  }
+
+  if (!stmt->prepare(sql))
+  {
+    delete stmt;
+    return NULL;
+  }
+
+  // prepare() may have logged in again
+  session = conn->get_session();
+
+  entries[num_entries].hash       = hash;
+  entries[num_entries].last_used  = clock;
+  entries[num_entries].stmt       = stmt;
+  num_entries++;
+
+  while ( (num_entries > 1) && (memory_use() > max_bytes) )
+    evict_lru(stmt);
+
+  return stmt;
+}
+
+/*
+  evict_lru - close the least recently used statement other than keep
+*/
+void ESP32_MySQL_Statement_Cache::evict_lru(const ESP32_MySQL_Statement *keep)
+{
+  int oldest = -1;
+
+  for (uint8_t i = 0; i < num_entries; i++)
+  {
+    if ( (entries[i].stmt != keep) && ((oldest < 0) || (entries[i].last_used < entries[oldest].last_used)) )
+      oldest = i;
+  }
+
+  if (oldest < 0)
+    return;
+
+  ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Statement_Cache: evicting", entries[oldest].stmt->get_sql());
+
+  remove(oldest);
+  num_evictions++;
+}
+
+void ESP32_MySQL_Statement_Cache::remove(const uint8_t& index)
+{
+  // Sends COM_STMT_CLOSE unless the session is gone
+  delete entries[index].stmt;
+
+  num_entries--;
+  entries[index] = entries[num_entries];
+}
+
+/*
+  clear - close every cached statement
+*/
+void ESP32_MySQL_Statement_Cache::clear()
+{
+  while (num_entries > 0)
+    remove(num_entries - 1);
+}
+
+/*
+  memory_use - heap held by the cached statements
+
+  Returns size_t - bytes
+*/
+size_t ESP32_MySQL_Statement_Cache::memory_use() const
+{
+  size_t bytes = 0;
+
+  for (uint8_t i = 0; i < num_entries; i++)
+    bytes += entries[i].stmt->get_memory_use();
+
+  return bytes;
+}
+
+#endif    // ESP32_MYSQL_STATEMENT_CACHE_IMPL_H
@@ -0,0 +1,1731 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Statement_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_STATEMENT_IMPL_H
+#define ESP32_MYSQL_STATEMENT_IMPL_H
+
+#include <ESP32_MySQL_Statement.h>
+
+// Little-endian integer of size bytes, as used by the binary protocol
+static void SQL_store_le(byte *buff, uint64_t value, const int& size)
+{
+  for (int i = 0; i < size; i++)
+  {
+    buff[i] = (byte) value;
+    value >>= 8;
+  }
+}
+
+static uint64_t SQL_read_le(const byte *buff, const int& size)
+{
+  uint64_t value = 0;
+
+  for (int i = size - 1; i >= 0; i--)
+    value = (value << 8) | buff[i];
+
+  return value;
+}
+
+// Offset just past the length coded string at offset
+static int SQL_skip_lcs(const byte *buff, const int& offset)
+{
+  const byte lcb = buff[offset];
+
+  if (lcb < 0xfb)
+    return offset + 1 + lcb;
+
+  if (lcb == 0xfc)
+    return offset + 3 + SQL_read_le(&buff[offset + 1], 2);
+
+  if (lcb == 0xfd)
+    return offset + 4 + SQL_read_le(&buff[offset + 1], 3);
+
+  // NULL (0xfb) has no data; 8 byte lengths don't fit a packet we read
+  return offset + 1;
+}
+
+// Bytes taken by a binary protocol value of type starting at buff
+static int SQL_binary_size(const uint8_t& type, const byte *buff)
+{
+  switch (type)
+  {
+    case MYSQL_TYPE_TINY:
+      return 1;
+
+    case MYSQL_TYPE_SHORT:
+    case MYSQL_TYPE_YEAR:
+      return 2;
+
+    case MYSQL_TYPE_LONG:
+    case MYSQL_TYPE_INT24:
+    case MYSQL_TYPE_FLOAT:
+      return 4;
+
+    case MYSQL_TYPE_LONGLONG:
+    case MYSQL_TYPE_DOUBLE:
+      return 8;
+
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+    case MYSQL_TYPE_TIME:
+      return 1 + buff[0];
+
+    default:
+      // Strings, DECIMAL, BLOB, BIT, ... are length coded
+      return SQL_skip_lcs(buff, 0);
+  }
+}
+
+ESP32_MySQL_Statement::ESP32_MySQL_Statement(ESP32_MySQL_Connection *connection)
+{
+  conn               = connection;
+  sql                = NULL;
+  statement_id       = 0;
+  session            = 0;
+  num_params         = 0;
+  num_columns        = 0;
+  param_types        = NULL;
+  params             = NULL;
+  prepared           = false;
+  holds_lock         = false;
+  rejected           = false;
+  result_columns     = 0;
+  columns_allocated  = 0;
+  column_types       = NULL;
+  column_flags       = NULL;
+  value_offsets      = NULL;
+  rows_pending       = false;
+  cursor_open        = false;
+  fetch_size         = 0;
+  batch              = NULL;
+  batch_len          = 0;
+  batch_size         = 0;
+  batch_rows         = 0;
+  batch_errors       = 0;
+  batch_types        = NULL;
+  rows_affected      = -1;
+  last_insert_id     = -1;
+  server_status      = 0;
+}
+
+ESP32_MySQL_Statement::~ESP32_MySQL_Statement()
+{
+  free_result();
+  release_connection();
+  close();
+
+  free(column_types);
+  free(column_flags);
+  free(value_offsets);
+  free(batch);
+}
+
+/*
+  prepare - have the server parse a statement
+
+  Use ? for each parameter. A statement already prepared with this
+  object is closed first.
+
+  query[in]       SQL statement, copied
+
+  Returns bool - True = statement ready to execute
+*/
+bool ESP32_MySQL_Statement::prepare(const char *query)
+{
+  char *copy = SQL_strdup(query);
+
+  close();
+
+  if (!copy)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::prepare: out of memory");
+    return false;
+  }
+
+  sql = copy;
+
+  ESP32_MySQL_Lock_Guard guard(conn);
+
+  if (!guard.owns_lock())
+    return false;
+
+  if (!conn->keepalive())
+  {
+    ESP32_MYSQL_LOGERROR(NOT_CONNECTED);
+    return false;
+  }
+
+  rejected = false;
+
+  if (prepare_on_server())
+    return true;
+
+  // Definitions still on the way would be read as the next answer
+  if (!rejected)
+    conn->close();
+
+  return false;
+}
+
+/*
+  prepare_on_server - COM_STMT_PREPARE with the saved SQL
+
+  The response is an Ok packet with the statement id and the number of
+  columns and parameters, followed by one column definition per
+  parameter and per result column.
+
+  Bytes                   Name
+  -----                   ----
+  1                       0x00
+  4                       statement_id
+  2                       num_columns
+  2                       num_params
+  1                       (filler)
+  2                       warning_count
+
+  Returns bool - True = prepared
+*/
+bool ESP32_MySQL_Statement::prepare_on_server()
+{
+  prepared = false;
+
+  if ( !conn->send_command(ESP32_MYSQL_COM_STMT_PREPARE, (const uint8_t *) sql, strlen(sql)) || !conn->read_packet() )
+    return false;
+
+  if (conn->get_packet_type() != ESP32_MYSQL_OK_PACKET)
+  {
+    conn->parse_error_packet();
+    conn->set_io_state(IO_IDLE);
+    rejected = true;
+
+    return false;
+  }
+
+  statement_id = SQL_read_le(&conn->buffer[5], 4);
+  num_columns  = SQL_read_le(&conn->buffer[9], 2);
+
+  const uint16_t count = SQL_read_le(&conn->buffer[11], 2);
+
+  // Bindings and batch survive preparing the same SQL again
+  if ( (count != num_params) || (params == NULL) )
+  {
+    free(params);
+    free(param_types);
+    free(batch_types);
+
+    num_params  = count;
+    params      = (Statement_Param *) malloc(sizeof(Statement_Param) * (count ? count : 1));
+    param_types = (uint8_t *) malloc(count ? count : 1);
+    batch_types = (uint8_t *) malloc(count ? count : 1);
+
+    if (!params || !param_types || !batch_types)
+    {
+      ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::prepare: out of memory");
+      return false;
+    }
+
+    clear_bindings();
+    clear_batch();
+  }
+
+  if ( (num_params > 0) && !read_definitions(num_params, param_types) )
+    return false;
+
+  if ( (num_columns > 0) && !read_definitions(num_columns, NULL) )
+    return false;
+
+  conn->set_io_state(IO_IDLE);
+
+  session   = conn->get_session();
+  prepared  = true;
+
+  ESP32_MYSQL_LOGDEBUG3("ESP32_MySQL_Statement::prepare: id =", statement_id, ", params =", num_params);
+
+  return true;
+}
+
+/*
+  read_definitions - read count column definitions and the EOF packet
+
+  types[out]      (optional) type of each column
+  flags[out]      (optional) flags of each column, needs types
+*/
+bool ESP32_MySQL_Statement::read_definitions(const uint16_t& count, uint8_t *types, uint16_t *flags)
+{
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if ( !conn->read_packet() || (conn->packet_len <= 0) )
+      return false;
+
+    if (types)
+    {
+      // catalog, schema, table, org_table, name, org_name
+      int offset = 4;
+
+      for (int s = 0; s < 6; s++)
+        offset = SQL_skip_lcs(conn->buffer, offset);
+
+      // 0x0c, charset (2), length (4), type
+      offset += 7;
+
+      types[i] = (offset < conn->packet_len + 4) ? conn->buffer[offset] : (uint8_t) MYSQL_TYPE_NULL;
+
+      if (flags)
+        flags[i] = (offset + 2 < conn->packet_len + 4) ? SQL_read_le(&conn->buffer[offset + 1], 2) : 0;
+    }
+  }
+
+  return conn->read_packet() && (conn->get_packet_type() == ESP32_MYSQL_EOF_PACKET);
+}
+
+/*
+  read_result_columns - column count and definitions of a result set
+
+  The count is in the packet just read. Arrays only grow, so executing
+  the same statement again allocates nothing.
+*/
+bool ESP32_MySQL_Statement::read_result_columns()
+{
+  const uint16_t count = conn->read_lcb_int(4);
+
+  if (count > columns_allocated)
+  {
+    uint8_t   *types    = (uint8_t *) realloc(column_types, count);
+    uint16_t  *flags    = types ? (uint16_t *) realloc(column_flags, count * sizeof(uint16_t)) : NULL;
+    int       *offsets  = flags ? (int *) realloc(value_offsets, count * sizeof(int)) : NULL;
+
+    // realloc() leaves the old block in place when it fails
+    if (types)
+      column_types = types;
+
+    if (flags)
+      column_flags = flags;
+
+    if (!offsets)
+    {
+      ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::execute: out of memory");
+      return false;
+    }
+
+    value_offsets     = offsets;
+    columns_allocated = count;
+  }
+
+  result_columns = count;
+
+  return read_definitions(count, column_types, column_flags);
+}
+
+/*
+  execute - run the prepared statement with the bound values
+
+  Parameters never bound are sent as NULL. If the statement returns a
+  result set the connection stays locked until fetch() has read the last
+  row or free_result() is called; with a fetch size it stays locked only
+  while a batch is being read.
+
+  Returns bool - True = statement succeeded
+*/
+bool ESP32_MySQL_Statement::execute()
+{
+  // Executing again closes an open cursor on the server
+  cursor_open = false;
+  free_result();
+  release_connection();
+
+  if (!sql)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::execute: not prepared");
+    return false;
+  }
+
+  if (!conn->lock())
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::execute: connection busy");
+    return false;
+  }
+
+  holds_lock = true;
+
+  rows_affected   = -1;
+  last_insert_id  = -1;
+  server_status   = 0;
+  rejected        = false;
+
+  bool ok = conn->keepalive();
+
+  if (!ok)
+    ESP32_MYSQL_LOGERROR(NOT_CONNECTED);
+
+  // Statement ids don't outlive the session
+  if ( ok && (!prepared || (session != conn->get_session())) )
+    ok = prepare_on_server();
+
+  if (ok)
+    ok = send_long_data() && send_execute() && read_execute_response();
+
+  // Short of an error packet, part of the answer may still be on the way
+  if (!ok && !rejected)
+    conn->close();
+
+  if (!rows_pending)
+    release_connection();
+
+  return ok;
+}
+
+/*
+  send_execute - encode COM_STMT_EXECUTE into the connection buffer
+
+  Bytes                   Name
+  -----                   ----
+  1                       COM_STMT_EXECUTE
+  4                       statement_id
+  1                       flags, CURSOR_TYPE_READ_ONLY with a fetch size
+  4                       iteration_count, always 1
+  (num_params + 7) / 8    NULL bitmap
+  1                       new_params_bound_flag, always 1
+  2 * num_params          type of each parameter
+  n                       values of the non-NULL parameters
+
+  Returns bool - True = packet written
+*/
+bool ESP32_MySQL_Statement::send_execute()
+{
+  const int bitmap_len = (num_params + 7) / 8;
+
+  size_t size = 4 + 1 + 4 + 1 + 4;
+
+  if (num_params > 0)
+    size += bitmap_len + 1 + 2 * num_params;
+
+  for (uint16_t i = 0; i < num_params; i++)
+    size += value_size(params[i]);
+
+  if (size - 4 >= 0xffffff)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::execute: parameters too large for one packet");
+    return false;
+  }
+
+  if (!conn->reserve_buffer(size))
+    return false;
+
+  byte *buff = conn->buffer;
+  int pos = 4;
+
+  SQL_store_le(&buff[0], size - 4, 3);
+  buff[3] = 0x00;
+
+  buff[pos++] = ESP32_MYSQL_COM_STMT_EXECUTE;
+  SQL_store_le(&buff[pos], statement_id, 4);
+  pos += 4;
+  buff[pos++] = (fetch_size > 0) ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR;
+  SQL_store_le(&buff[pos], 1, 4);
+  pos += 4;
+
+  if (num_params > 0)
+  {
+    memset(&buff[pos], 0, bitmap_len);
+
+    for (uint16_t i = 0; i < num_params; i++)
+    {
+      if (params[i].type == MYSQL_TYPE_NULL)
+        buff[pos + i / 8] |= (1 << (i % 8));
+    }
+
+    pos += bitmap_len;
+    buff[pos++] = 0x01;
+
+    for (uint16_t i = 0; i < num_params; i++)
+    {
+      buff[pos++] = params[i].type;
+      buff[pos++] = 0x00;     // signed
+    }
+
+    for (uint16_t i = 0; i < num_params; i++)
+      pos += store_value(&buff[pos], params[i]);
+  }
+
+  return conn->write_bytes(buff, pos);
+}
+
+/*
+  value_size - bytes of a bound value in the binary protocol
+
+  Returns size_t - 0 for NULL and for long data, which the server
+                   already holds
+*/
+size_t ESP32_MySQL_Statement::value_size(const Statement_Param& p) const
+{
+  if (p.long_data)
+    return 0;
+
+  if ( (p.type == MYSQL_TYPE_LONGLONG) || (p.type == MYSQL_TYPE_DOUBLE) )
+    return 8;
+
+  if (p.type == MYSQL_TYPE_FLOAT)
+    return 4;
+
+  if ( (p.type == MYSQL_TYPE_STRING) || (p.type == MYSQL_TYPE_BLOB) )
+    return conn->store_lcb_int(NULL, p.length) + p.length;
+
+  return 0;
+}
+
+/*
+  store_value - encode a bound value, value_size() bytes
+
+  Both ends are little-endian, so numbers go in as they are in memory.
+
+  Returns int - bytes written
+*/
+int ESP32_MySQL_Statement::store_value(byte *buff, const Statement_Param& p) const
+{
+  if (p.long_data)
+    return 0;
+
+  if (p.type == MYSQL_TYPE_LONGLONG)
+  {
+    SQL_store_le(buff, (uint64_t) p.value.i, 8);
+    return 8;
+  }
+
+  if (p.type == MYSQL_TYPE_DOUBLE)
+  {
+    memcpy(buff, &p.value.d, 8);
+    return 8;
+  }
+
+  if (p.type == MYSQL_TYPE_FLOAT)
+  {
+    memcpy(buff, &p.value.f, 4);
+    return 4;
+  }
+
+  if ( (p.type == MYSQL_TYPE_STRING) || (p.type == MYSQL_TYPE_BLOB) )
+  {
+    const int lcb_len = conn->store_lcb_int(buff, p.length);
+
+    if (p.length > 0)
+      memcpy(&buff[lcb_len], p.data, p.length);
+
+    return lcb_len + p.length;
+  }
+
+  return 0;
+}
+
+/*
+  send_long_data - send the long data parameters ahead of COM_STMT_EXECUTE
+
+  Bytes                   Name
+  -----                   ----
+  1                       COM_STMT_SEND_LONG_DATA
+  4                       statement_id
+  2                       param_id
+  n                       data
+
+  The server appends the data of each packet to the parameter and does
+  not answer; problems are reported by the execute that follows. A
+  parameter without any data is sent as one empty packet, so it is an
+  empty value rather than NULL.
+
+  Returns bool - True = all data written
+*/
+bool ESP32_MySQL_Statement::send_long_data()
+{
+  for (uint16_t i = 0; i < num_params; i++)
+  {
+    const Statement_Param& p = params[i];
+
+    if (!p.long_data)
+      continue;
+
+    if (!conn->reserve_buffer(11 + ESP32_MYSQL_LONG_DATA_CHUNK))
+      return false;
+
+    size_t sent = 0;
+    size_t length;
+
+    do
+    {
+      if (p.source)
+      {
+        length = p.source(&conn->buffer[11], ESP32_MYSQL_LONG_DATA_CHUNK, p.context);
+
+        if (length > ESP32_MYSQL_LONG_DATA_CHUNK)
+          length = ESP32_MYSQL_LONG_DATA_CHUNK;
+      }
+      else
+      {
+        length = (p.length - sent < ESP32_MYSQL_LONG_DATA_CHUNK) ? p.length - sent : ESP32_MYSQL_LONG_DATA_CHUNK;
+
+        if (length > 0)
+          memcpy(&conn->buffer[11], p.data + sent, length);
+      }
+
+      if ( ((length > 0) || (sent == 0)) && !send_long_data_packet(i, length) )
+        return false;
+
+      sent += length;
+    } while (length > 0);
+
+    ESP32_MYSQL_LOGDEBUG3("ESP32_MySQL_Statement: long data for parameter", i, ", bytes =", sent);
+  }
+
+  return true;
+}
+
+/*
+  send_long_data_packet - write one piece, already at conn->buffer[11]
+*/
+bool ESP32_MySQL_Statement::send_long_data_packet(const uint16_t& index, const size_t& length)
+{
+  byte *buff = conn->buffer;
+
+  SQL_store_le(&buff[0], 7 + length, 3);
+  buff[3] = 0x00;
+  buff[4] = ESP32_MYSQL_COM_STMT_SEND_LONG_DATA;
+  SQL_store_le(&buff[5], statement_id, 4);
+  SQL_store_le(&buff[9], index, 2);
+
+  return conn->write_bytes(buff, 11 + length);
+}
+
+/*
+  read_execute_response - read the response of execute()
+
+  An Ok packet ends the statement. A result set stops after the column
+  definitions, leaving the rows to fetch(). With a cursor, the EOF after
+  the definitions has SERVER_STATUS_CURSOR_EXISTS and no rows follow;
+  the server ignores the cursor for statements that can't have one.
+*/
+bool ESP32_MySQL_Statement::read_execute_response()
+{
+  if ( !conn->read_packet() || (conn->packet_len <= 0) )
+    return false;
+
+  const int type = conn->get_packet_type();
+
+  if (type == ESP32_MYSQL_ERROR_PACKET)
+  {
+    conn->parse_error_packet();
+    rejected = true;
+    return false;
+  }
+
+  if (type != ESP32_MYSQL_OK_PACKET)
+  {
+    if (!read_result_columns())
+      return false;
+
+    if ( (fetch_size > 0) && (conn->get_status_flags() & SERVER_STATUS_CURSOR_EXISTS) )
+      cursor_open = true;
+    else
+      rows_pending = true;
+
+    return true;
+  }
+
+  const int insert_id_offset = 5 + conn->get_lcb_len(5);
+
+  rows_affected = conn->read_lcb_int(5);
+
+  if (rows_affected > 0)
+    last_insert_id = conn->read_lcb_int(insert_id_offset);
+
+  server_status = conn->get_status_flags();
+
+  return (server_status & SERVER_MORE_RESULTS_EXISTS) ? skip_more_results() : true;
+}
+
+/*
+  skip_more_results - read and discard the results after the current one
+
+  Only a CALL has more than one result.
+*/
+bool ESP32_MySQL_Statement::skip_more_results()
+{
+  while (server_status & SERVER_MORE_RESULTS_EXISTS)
+  {
+    if ( !conn->read_packet() || (conn->packet_len <= 0) )
+      return false;
+
+    const int type = conn->get_packet_type();
+
+    if (type == ESP32_MYSQL_ERROR_PACKET)
+    {
+      conn->parse_error_packet();
+      rejected = true;
+      return false;
+    }
+
+    if ( (type != ESP32_MYSQL_OK_PACKET) && !skip_result_set() )
+      return false;
+
+    server_status = conn->get_status_flags();
+  }
+
+  return true;
+}
+
+/*
+  skip_result_set - read past column definitions and rows
+
+  Returns bool - False = read failed, or the server failed while sending
+                 rows
+*/
+bool ESP32_MySQL_Statement::skip_result_set()
+{
+  if (conn->skip_result_set() < 0)
+    return false;
+
+  if (conn->get_packet_type() == ESP32_MYSQL_ERROR_PACKET)
+  {
+    rejected = true;
+    return false;
+  }
+
+  return true;
+}
+
+/*
+  fetch - read the next binary row of the result set
+
+  Binary rows start with 0x00 and a NULL bitmap whose first two bits are
+  unused; the values of the non-NULL columns follow, each in the native
+  form of its column type. Only the offsets are recorded here, the
+  get_xxx() methods decode straight from the packet buffer.
+
+  Returns bool - True = row available, False = no more rows or an error
+*/
+bool ESP32_MySQL_Statement::fetch()
+{
+  if ( !rows_pending && (!cursor_open || !fetch_batch()) )
+    return false;
+
+  bool ok = conn->read_packet() && (conn->packet_len > 0);
+
+  if (!ok)
+  {
+    // An oversize row is left unread, a failed read is half done
+    conn->close();
+  }
+  else
+  {
+    const int type = conn->get_packet_type();
+
+    if ( (type == ESP32_MYSQL_EOF_PACKET) && (conn->packet_len < 9) )
+    {
+      server_status = conn->get_status_flags();
+
+      if (cursor_open)
+      {
+        // End of this batch; the connection is free until the next one
+        rows_pending = false;
+        release_connection();
+
+        if (server_status & SERVER_STATUS_LAST_ROW_SENT)
+          cursor_open = false;
+
+        return fetch();
+      }
+
+      skip_more_results();
+    }
+    else if (type == ESP32_MYSQL_ERROR_PACKET)
+    {
+      conn->parse_error_packet();
+      cursor_open = false;
+    }
+    else if (parse_row())
+    {
+      return true;
+    }
+    else
+    {
+      // The rest of the result set would be taken for the next answer
+      ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::fetch: malformed row");
+      conn->close();
+    }
+  }
+
+  rows_pending = false;
+  cursor_open  = false;
+  release_connection();
+
+  return false;
+}
+
+/*
+  fetch_batch - ask the server for the next fetch_size rows of the cursor
+
+  COM_STMT_FETCH: statement_id (4), num_rows (4). The rows come back
+  like those of a result set, up to an EOF packet.
+
+  Returns bool - True = rows on their way, connection locked
+*/
+bool ESP32_MySQL_Statement::fetch_batch()
+{
+  if (!conn->lock())
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::fetch: connection busy");
+    return false;
+  }
+
+  holds_lock = true;
+
+  // A new session has no cursor
+  if ( (session != conn->get_session()) || !conn->connected() )
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::fetch: cursor lost with the session");
+
+    cursor_open = false;
+    release_connection();
+
+    return false;
+  }
+
+  uint8_t payload[8];
+
+  SQL_store_le(&payload[0], statement_id, 4);
+  SQL_store_le(&payload[4], fetch_size ? fetch_size : 1, 4);
+
+  if (!conn->send_command(ESP32_MYSQL_COM_STMT_FETCH, payload, sizeof(payload)))
+  {
+    cursor_open = false;
+    release_connection();
+
+    return false;
+  }
+
+  rows_pending = true;
+
+  return true;
+}
+
+/*
+  reset_cursor - close the cursor on the server (COM_STMT_RESET)
+*/
+void ESP32_MySQL_Statement::reset_cursor()
+{
+  cursor_open = false;
+
+  if ( (session != conn->get_session()) || !conn->connected() )
+    return;
+
+  ESP32_MySQL_Lock_Guard guard(conn);
+
+  if (guard.owns_lock())
+  {
+    uint8_t id[4];
+
+    SQL_store_le(id, statement_id, 4);
+
+    if (conn->send_command(ESP32_MYSQL_COM_STMT_RESET, id, sizeof(id)))
+      conn->read_ok_packet();
+
+    conn->set_io_state(IO_IDLE);
+  }
+}
+
+/*
+  free_result - discard the rest of the result set
+
+  Without a cursor every remaining row is read. With one, only the rest
+  of the current batch is; the cursor is then closed on the server.
+*/
+void ESP32_MySQL_Statement::free_result()
+{
+  const bool had_cursor = cursor_open;
+
+  // Stop fetch() from asking for another batch
+  cursor_open = false;
+
+  while (fetch())
+    ;
+
+  if (had_cursor)
+    reset_cursor();
+}
+
+bool ESP32_MySQL_Statement::parse_row()
+{
+  const int bitmap  = 5;
+  const int end     = conn->packet_len + 4;
+  int offset        = bitmap + (result_columns + 7 + 2) / 8;
+
+  if (offset > end)
+    return false;
+
+  for (uint16_t i = 0; i < result_columns; i++)
+  {
+    const int bit = i + 2;
+
+    if (conn->buffer[bitmap + bit / 8] & (1 << (bit % 8)))
+    {
+      value_offsets[i] = 0;
+      continue;
+    }
+
+    if (offset >= end)
+      return false;
+
+    value_offsets[i] = offset;
+    offset += SQL_binary_size(column_types[i], &conn->buffer[offset]);
+  }
+
+  return offset <= end;
+}
+
+// Offset of the value of column in the current row, 0 = NULL or no row
+int ESP32_MySQL_Statement::value_offset(const uint16_t& column) const
+{
+  if ( !rows_pending || (column >= result_columns) )
+    return 0;
+
+  return value_offsets[column];
+}
+
+bool ESP32_MySQL_Statement::is_null(const uint16_t& column) const
+{
+  return value_offset(column) == 0;
+}
+
+/*
+  get_int64 - value of column as an integer
+
+  Integer columns are read as they are, honouring UNSIGNED; floating
+  point columns are truncated, DECIMAL and string columns parsed. BIT
+  columns are read big-endian.
+
+  Returns int64_t - 0 for NULL and for dates and times
+*/
+int64_t ESP32_MySQL_Statement::get_int64(const uint16_t& column) const
+{
+  const int offset = value_offset(column);
+
+  if (offset == 0)
+    return 0;
+
+  const byte *value       = &conn->buffer[offset];
+  const bool  is_unsigned = column_flags[column] & UNSIGNED_FLAG;
+
+  switch (column_types[column])
+  {
+    case MYSQL_TYPE_TINY:
+      return is_unsigned ? (int64_t) value[0] : (int64_t) (int8_t) value[0];
+
+    case MYSQL_TYPE_SHORT:
+    case MYSQL_TYPE_YEAR:
+      return is_unsigned ? (int64_t) SQL_read_le(value, 2) : (int64_t) (int16_t) SQL_read_le(value, 2);
+
+    case MYSQL_TYPE_LONG:
+    case MYSQL_TYPE_INT24:
+      return is_unsigned ? (int64_t) SQL_read_le(value, 4) : (int64_t) (int32_t) SQL_read_le(value, 4);
+
+    case MYSQL_TYPE_LONGLONG:
+      return (int64_t) SQL_read_le(value, 8);
+
+    case MYSQL_TYPE_FLOAT:
+    case MYSQL_TYPE_DOUBLE:
+      return (int64_t) get_double(column);
+
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+    case MYSQL_TYPE_TIME:
+      return 0;
+
+    default:
+      break;
+  }
+
+  size_t length;
+  const uint8_t *data = get_bytes(column, &length);
+
+  if (column_types[column] == MYSQL_TYPE_BIT)
+  {
+    uint64_t bits = 0;
+
+    for (size_t i = 0; (i < length) && (i < 8); i++)
+      bits = (bits << 8) | data[i];
+
+    return (int64_t) bits;
+  }
+
+  char text[24];
+
+  length = (length < sizeof(text) - 1) ? length : sizeof(text) - 1;
+  memcpy(text, data, length);
+  text[length] = 0;
+
+  return strtoll(text, NULL, 10);
+}
+
+/*
+  get_double - value of column as a double
+
+  Returns double - 0 for NULL and for dates and times
+*/
+double ESP32_MySQL_Statement::get_double(const uint16_t& column) const
+{
+  const int offset = value_offset(column);
+
+  if (offset == 0)
+    return 0;
+
+  const byte *value = &conn->buffer[offset];
+
+  switch (column_types[column])
+  {
+    case MYSQL_TYPE_FLOAT:
+    {
+      float f;
+
+      memcpy(&f, value, 4);
+
+      return f;
+    }
+
+    case MYSQL_TYPE_DOUBLE:
+    {
+      double d;
+
+      memcpy(&d, value, 8);
+
+      return d;
+    }
+
+    case MYSQL_TYPE_TINY:
+    case MYSQL_TYPE_SHORT:
+    case MYSQL_TYPE_YEAR:
+    case MYSQL_TYPE_LONG:
+    case MYSQL_TYPE_INT24:
+    case MYSQL_TYPE_BIT:
+      return (double) get_int64(column);
+
+    case MYSQL_TYPE_LONGLONG:
+      return (column_flags[column] & UNSIGNED_FLAG) ? (double) SQL_read_le(value, 8) : (double) get_int64(column);
+
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+    case MYSQL_TYPE_TIME:
+      return 0;
+
+    default:
+      break;
+  }
+
+  size_t length;
+  const uint8_t *data = get_bytes(column, &length);
+  char text[64];
+
+  length = (length < sizeof(text) - 1) ? length : sizeof(text) - 1;
+  memcpy(text, data, length);
+  text[length] = 0;
+
+  return strtod(text, NULL);
+}
+
+/*
+  get_datetime - value of a DATE, DATETIME, TIMESTAMP or TIME column
+
+  The server leaves out trailing zero parts, so the value is between 0
+  and 11 bytes (12 for TIME) after its length byte.
+
+  Bytes (DATE...)         Bytes (TIME)
+  -----                   -----
+  2   year                1   is_negative
+  1   month               4   days
+  1   day                 1   hour
+  1   hour                1   minute
+  1   minute              1   second
+  1   second              4   microsecond
+  4   microsecond
+
+  value[out]      Parts of the value, all zero for a zero length value
+
+  Returns bool - False = NULL or not a date / time column
+*/
+bool ESP32_MySQL_Statement::get_datetime(const uint16_t& column, MySQL_DateTime *value) const
+{
+  const int offset = value_offset(column);
+
+  memset(value, 0, sizeof(MySQL_DateTime));
+
+  if (offset == 0)
+    return false;
+
+  const uint8_t type  = column_types[column];
+  const byte    *data = &conn->buffer[offset + 1];
+  const uint8_t len   = conn->buffer[offset];
+
+  if (type == MYSQL_TYPE_TIME)
+  {
+    if (len >= 8)
+    {
+      value->negative = data[0];
+      value->day      = SQL_read_le(&data[1], 4);
+      value->hour     = data[5];
+      value->minute   = data[6];
+      value->second   = data[7];
+    }
+
+    if (len >= 12)
+      value->microsecond = SQL_read_le(&data[8], 4);
+
+    return true;
+  }
+
+  if ( (type != MYSQL_TYPE_DATE) && (type != MYSQL_TYPE_DATETIME) && (type != MYSQL_TYPE_TIMESTAMP) )
+    return false;
+
+  if (len >= 4)
+  {
+    value->year   = SQL_read_le(data, 2);
+    value->month  = data[2];
+    value->day    = data[3];
+  }
+
+  if (len >= 7)
+  {
+    value->hour   = data[4];
+    value->minute = data[5];
+    value->second = data[6];
+  }
+
+  if (len >= 11)
+    value->microsecond = SQL_read_le(&data[7], 4);
+
+  return true;
+}
+
+/*
+  get_bytes - raw value of a string, BLOB, DECIMAL, ... column
+
+  The value is not NUL terminated and stays valid until the next fetch().
+
+  length[out]     Bytes in the value
+
+  Returns const uint8_t * - NULL for a NULL value or a fixed size type
+*/
+const uint8_t *ESP32_MySQL_Statement::get_bytes(const uint16_t& column, size_t *length) const
+{
+  const int offset = value_offset(column);
+
+  *length = 0;
+
+  if (offset == 0)
+    return NULL;
+
+  switch (column_types[column])
+  {
+    case MYSQL_TYPE_TINY:
+    case MYSQL_TYPE_SHORT:
+    case MYSQL_TYPE_YEAR:
+    case MYSQL_TYPE_LONG:
+    case MYSQL_TYPE_INT24:
+    case MYSQL_TYPE_FLOAT:
+    case MYSQL_TYPE_LONGLONG:
+    case MYSQL_TYPE_DOUBLE:
+    case MYSQL_TYPE_DATE:
+    case MYSQL_TYPE_DATETIME:
+    case MYSQL_TYPE_TIMESTAMP:
+    case MYSQL_TYPE_TIME:
+      return NULL;
+
+    default:
+      break;
+  }
+
+  const int data = offset + conn->get_lcb_len(offset);
+
+  *length = SQL_skip_lcs(conn->buffer, offset) - data;
+
+  return &conn->buffer[data];
+}
+
+/*
+  close - free the statement on the server (COM_STMT_CLOSE)
+
+  The server does not answer COM_STMT_CLOSE. Statements of an earlier
+  session are already gone.
+*/
+void ESP32_MySQL_Statement::close()
+{
+  // COM_STMT_CLOSE closes an open cursor too
+  cursor_open = false;
+  free_result();
+  release_connection();
+
+  if ( prepared && (session == conn->get_session()) && conn->connected() )
+  {
+    ESP32_MySQL_Lock_Guard guard(conn);
+
+    if (guard.owns_lock())
+    {
+      uint8_t id[4];
+
+      SQL_store_le(id, statement_id, 4);
+      conn->send_command(ESP32_MYSQL_COM_STMT_CLOSE, id, sizeof(id));
+      conn->set_io_state(IO_IDLE);
+    }
+  }
+
+  prepared = false;
+
+  free(sql);
+  free(params);
+  free(param_types);
+  free(batch_types);
+
+  sql         = NULL;
+  params      = NULL;
+  param_types = NULL;
+  batch_types = NULL;
+  batch_len   = 0;
+  batch_rows  = 0;
+  num_params      = 0;
+  num_columns     = 0;
+  result_columns  = 0;
+}
+
+/*
+  get_memory_use - heap held by this statement, SQL text and arrays
+
+  Returns size_t - bytes, including the object itself
+*/
+size_t ESP32_MySQL_Statement::get_memory_use() const
+{
+  size_t bytes = sizeof(ESP32_MySQL_Statement);
+
+  if (sql)
+    bytes += strlen(sql) + 1;
+
+  bytes += num_params * (sizeof(Statement_Param) + 2 * sizeof(uint8_t));
+  bytes += batch_size;
+  bytes += columns_allocated * (sizeof(uint8_t) + sizeof(uint16_t) + sizeof(int));
+
+  return bytes;
+}
+
+/*
+  param - the parameter at index, cleared for a new binding
+*/
+Statement_Param *ESP32_MySQL_Statement::param(const uint16_t& index)
+{
+  if (index >= num_params)
+  {
+    ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Statement: no parameter", index);
+    return NULL;
+  }
+
+  memset(&params[index], 0, sizeof(Statement_Param));
+
+  return &params[index];
+}
+
+bool ESP32_MySQL_Statement::bind_int(const uint16_t& index, const int64_t& value)
+{
+  Statement_Param *p = param(index);
+
+  if (!p)
+    return false;
+
+  p->type     = MYSQL_TYPE_LONGLONG;
+  p->value.i  = value;
+
+  return true;
+}
+
+bool ESP32_MySQL_Statement::bind_float(const uint16_t& index, const float& value)
+{
+  Statement_Param *p = param(index);
+
+  if (!p)
+    return false;
+
+  p->type     = MYSQL_TYPE_FLOAT;
+  p->value.f  = value;
+
+  return true;
+}
+
+bool ESP32_MySQL_Statement::bind_double(const uint16_t& index, const double& value)
+{
+  Statement_Param *p = param(index);
+
+  if (!p)
+    return false;
+
+  p->type     = MYSQL_TYPE_DOUBLE;
+  p->value.d  = value;
+
+  return true;
+}
+
+bool ESP32_MySQL_Statement::bind_string(const uint16_t& index, const char *value)
+{
+  if (!value)
+    return bind_null(index);
+
+  Statement_Param *p = param(index);
+
+  if (!p)
+    return false;
+
+  p->type   = MYSQL_TYPE_STRING;
+  p->data   = (const uint8_t *) value;
+  p->length = strlen(value);
+
+  return true;
+}
+
+bool ESP32_MySQL_Statement::bind_blob(const uint16_t& index, const uint8_t *data, const size_t& length)
+{
+  if (!data)
+    return bind_null(index);
+
+  Statement_Param *p = param(index);
+
+  if (!p)
+    return false;
+
+  p->type   = MYSQL_TYPE_BLOB;
+  p->data   = data;
+  p->length = length;
+
+  return true;
+}
+
+bool ESP32_MySQL_Statement::bind_null(const uint16_t& index)
+{
+  Statement_Param *p = param(index);
+
+  if (!p)
+    return false;
+
+  p->type = MYSQL_TYPE_NULL;
+
+  return true;
+}
+
+/*
+  bind_long_data - send length bytes at data in pieces during execute()
+
+  data is not copied; keep it valid until execute() returns.
+*/
+bool ESP32_MySQL_Statement::bind_long_data(const uint16_t& index, const uint8_t *data, const size_t& length)
+{
+  if (!data)
+    return bind_null(index);
+
+  Statement_Param *p = param(index);
+
+  if (!p)
+    return false;
+
+  p->type       = MYSQL_TYPE_BLOB;
+  p->data       = data;
+  p->length     = length;
+  p->long_data  = true;
+
+  return true;
+}
+
+/*
+  bind_long_data - send everything left in stream during execute()
+
+  Reading stops at the end of the stream or when readBytes() times out.
+*/
+bool ESP32_MySQL_Statement::bind_long_data(const uint16_t& index, Stream& stream)
+{
+  return bind_long_data(index, SQL_read_stream, &stream);
+}
+
+/*
+  bind_long_data - send what source produces during execute()
+
+  source[in]      called until it returns 0
+  context[in]     (optional) passed on to source
+*/
+bool ESP32_MySQL_Statement::bind_long_data(const uint16_t& index, Long_Data_Source source, void *context)
+{
+  if (!source)
+    return bind_null(index);
+
+  Statement_Param *p = param(index);
+
+  if (!p)
+    return false;
+
+  p->type       = MYSQL_TYPE_BLOB;
+  p->source     = source;
+  p->context    = context;
+  p->long_data  = true;
+
+  return true;
+}
+
+/*
+  clear_bindings - set every parameter to NULL
+*/
+void ESP32_MySQL_Statement::clear_bindings()
+{
+  for (uint16_t i = 0; i < num_params; i++)
+  {
+    memset(&params[i], 0, sizeof(Statement_Param));
+    params[i].type = MYSQL_TYPE_NULL;
+  }
+}
+
+/*
+  add_batch - copy the current bindings as a row for execute_batch()
+
+  Values are copied, so strings and blobs can change after this returns.
+  A parameter keeps the type of its first non-NULL value for the whole
+  batch. Long data can't be batched.
+
+  Returns bool - False = batch full (ESP32_MYSQL_BATCH_BYTES, call
+                 execute_batch() first), type changed or out of memory
+*/
+bool ESP32_MySQL_Statement::add_batch()
+{
+  if (num_params == 0)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::add_batch: no parameters");
+    return false;
+  }
+
+  // An indicator per parameter, then the value
+  size_t row_len = num_params;
+
+  for (uint16_t i = 0; i < num_params; i++)
+  {
+    const Statement_Param& p = params[i];
+
+    if (p.long_data)
+    {
+      ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Statement::add_batch: long data in parameter", i);
+      return false;
+    }
+
+    if ( (p.type != MYSQL_TYPE_NULL) && (batch_types[i] != MYSQL_TYPE_NULL) && (p.type != batch_types[i]) )
+    {
+      ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Statement::add_batch: type changed in parameter", i);
+      return false;
+    }
+
+    row_len += value_size(p);
+  }
+
+  // A single row may be larger than the limit
+  if ( (batch_rows > 0) && (batch_len + row_len > ESP32_MYSQL_BATCH_BYTES) )
+  {
+    ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Statement::add_batch: batch full, rows =", batch_rows);
+    return false;
+  }
+
+  if (batch_len + row_len > batch_size)
+  {
+    size_t size = (batch_size * 2 > batch_len + row_len) ? batch_size * 2 : batch_len + row_len;
+    uint8_t *grown = (uint8_t *) realloc(batch, size);
+
+    if (!grown)
+    {
+      ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::add_batch: out of memory");
+      return false;
+    }
+
+    batch       = grown;
+    batch_size  = size;
+  }
+
+  for (uint16_t i = 0; i < num_params; i++)
+  {
+    const Statement_Param& p = params[i];
+
+    if (p.type == MYSQL_TYPE_NULL)
+    {
+      batch[batch_len++] = STMT_INDICATOR_NULL;
+    }
+    else
+    {
+      batch[batch_len++] = STMT_INDICATOR_NONE;
+      batch_len += store_value(&batch[batch_len], p);
+      batch_types[i] = p.type;
+    }
+  }
+
+  batch_rows++;
+
+  return true;
+}
+
+/*
+  execute_batch - execute the statement for every row of add_batch()
+
+  get_rows_affected() is the total of all rows and get_last_insert_id()
+  the id of the first row inserted. The batch is empty afterwards, even
+  if some rows failed: see get_batch_errors(). A MariaDB bulk execute
+  stops at the first error, so all its rows count as failed.
+
+  Returns bool - True = every row succeeded
+*/
+bool ESP32_MySQL_Statement::execute_batch()
+{
+  cursor_open = false;
+  free_result();
+  release_connection();
+
+  rows_affected   = 0;
+  last_insert_id  = -1;
+  server_status   = 0;
+  batch_errors    = 0;
+
+  if (batch_rows == 0)
+    return true;
+
+  bool ok = false;
+
+  if (!sql)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::execute_batch: not prepared");
+  }
+  else if (!conn->lock())
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::execute_batch: connection busy");
+  }
+  else
+  {
+    holds_lock = true;
+
+    ok = conn->keepalive();
+
+    if (!ok)
+      ESP32_MYSQL_LOGERROR(NOT_CONNECTED);
+
+    if ( ok && (!prepared || (session != conn->get_session())) )
+      ok = prepare_on_server();
+
+    if (ok && conn->supports_bulk_execute())
+    {
+      ok = send_bulk_execute() && read_batch_responses(1, batch_rows);
+    }
+    else if (ok)
+    {
+      ok = send_batch_executes() && read_batch_responses(batch_rows, 1);
+    }
+
+    // Responses still on the way can't be matched any more
+    if (!ok)
+      conn->close();
+
+    release_connection();
+  }
+
+  if (!ok)
+    batch_errors = batch_rows;
+
+  clear_batch();
+
+  return batch_errors == 0;
+}
+
+void ESP32_MySQL_Statement::clear_batch()
+{
+  batch_len   = 0;
+  batch_rows  = 0;
+
+  for (uint16_t i = 0; i < num_params; i++)
+    batch_types[i] = MYSQL_TYPE_NULL;
+}
+
+/*
+  send_bulk_execute - the whole batch as one COM_STMT_BULK_EXECUTE
+
+  Bytes                   Name
+  -----                   ----
+  1                       COM_STMT_BULK_EXECUTE
+  4                       statement_id
+  2                       flags, STMT_BULK_FLAG_SEND_TYPES_TO_SERVER
+  2 * num_params          type of each parameter
+  n                       rows: per parameter an indicator, then the
+                          value unless it is NULL
+
+  Returns bool - True = packet written
+*/
+bool ESP32_MySQL_Statement::send_bulk_execute()
+{
+  const size_t size = 4 + 1 + 4 + 2 + 2 * num_params + batch_len;
+
+  if (size - 4 >= 0xffffff)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Statement::execute_batch: batch too large for one packet");
+    return false;
+  }
+
+  if (!conn->reserve_buffer(size))
+    return false;
+
+  byte *buff = conn->buffer;
+  int pos = 4;
+
+  SQL_store_le(&buff[0], size - 4, 3);
+  buff[3] = 0x00;
+
+  buff[pos++] = ESP32_MYSQL_COM_STMT_BULK_EXECUTE;
+  SQL_store_le(&buff[pos], statement_id, 4);
+  pos += 4;
+  SQL_store_le(&buff[pos], STMT_BULK_FLAG_SEND_TYPES_TO_SERVER, 2);
+  pos += 2;
+
+  for (uint16_t i = 0; i < num_params; i++)
+  {
+    buff[pos++] = batch_types[i];
+    buff[pos++] = 0x00;       // signed
+  }
+
+  memcpy(&buff[pos], batch, batch_len);
+
+  ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Statement: bulk execute, rows =", batch_rows);
+
+  return conn->write_bytes(buff, size);
+}
+
+/*
+  send_batch_executes - one COM_STMT_EXECUTE per row, written together
+
+  The rows are turned into the layout of send_execute(): the indicators
+  become the NULL bitmap and the values follow unchanged.
+
+  Returns bool - True = packets written
+*/
+bool ESP32_MySQL_Statement::send_batch_executes()
+{
+  const int bitmap_len = (num_params + 7) / 8;
+  const size_t overhead = 4 + 1 + 4 + 1 + 4 + bitmap_len + 1 + 2 * num_params;
+
+  // Each row loses its indicators and gains the overhead
+  if (!conn->reserve_buffer(batch_rows * overhead + batch_len - batch_rows * num_params))
+    return false;
+
+  byte *buff = conn->buffer;
+  size_t pos = 0;
+  size_t offset = 0;
+
+  for (uint16_t r = 0; r < batch_rows; r++)
+  {
+    const size_t start = pos;
+
+    pos += 4;
+    buff[pos++] = ESP32_MYSQL_COM_STMT_EXECUTE;
+    SQL_store_le(&buff[pos], statement_id, 4);
+    pos += 4;
+    buff[pos++] = CURSOR_TYPE_NO_CURSOR;
+    SQL_store_le(&buff[pos], 1, 4);
+    pos += 4;
+
+    byte *bitmap = &buff[pos];
+
+    memset(bitmap, 0, bitmap_len);
+    pos += bitmap_len;
+    buff[pos++] = 0x01;
+
+    for (uint16_t i = 0; i < num_params; i++)
+    {
+      buff[pos++] = batch_types[i];
+      buff[pos++] = 0x00;     // signed
+    }
+
+    for (uint16_t i = 0; i < num_params; i++)
+    {
+      if (batch[offset++] == STMT_INDICATOR_NULL)
+      {
+        bitmap[i / 8] |= (1 << (i % 8));
+        continue;
+      }
+
+      const int len = SQL_binary_size(batch_types[i], &batch[offset]);
+
+      memcpy(&buff[pos], &batch[offset], len);
+      offset  += len;
+      pos     += len;
+    }
+
+    SQL_store_le(&buff[start], pos - start - 4, 3);
+    buff[start + 3] = 0x00;
+  }
+
+  ESP32_MYSQL_LOGDEBUG1("ESP32_MySQL_Statement: pipelined executes, rows =", batch_rows);
+
+  return conn->write_bytes(buff, pos);
+}
+
+/*
+  read_batch_responses - read count responses of rows_each rows
+
+  Returns bool - False = a response is missing, the stream is out of step
+*/
+bool ESP32_MySQL_Statement::read_batch_responses(const uint16_t& count, const uint16_t& rows_each)
+{
+  for (uint16_t r = 0; r < count; r++)
+  {
+    if ( !conn->read_packet() || (conn->packet_len <= 0) )
+      return false;
+
+    const int type = conn->get_packet_type();
+
+    if (type == ESP32_MYSQL_ERROR_PACKET)
+    {
+      conn->parse_error_packet();
+      batch_errors += rows_each;
+    }
+    else if (type == ESP32_MYSQL_OK_PACKET)
+    {
+      const int affected = conn->read_lcb_int(5);
+
+      rows_affected += affected;
+
+      if ( (affected > 0) && (last_insert_id <= 0) )
+        last_insert_id = conn->read_lcb_int(5 + conn->get_lcb_len(5));
+
+      server_status = conn->get_status_flags();
+    }
+    else if (!skip_result_set())
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void ESP32_MySQL_Statement::release_connection()
+{
+  if (holds_lock)
+  {
+    holds_lock = false;
+    conn->set_io_state(IO_IDLE);
+    conn->unlock();
+  }
+}
+
+#endif    // ESP32_MYSQL_STATEMENT_IMPL_H
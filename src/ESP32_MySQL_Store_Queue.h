@@ -0,0 +1,268 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Store_Queue.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Store-and-forward queue
+
+  Rows that can't reach the server go to flash instead of being lost,
+  and are inserted once it is back:
+
+    ESP32_MySQL_Store_Queue     queue(LittleFS, "/mysqlq");
+    ESP32_MySQL_Insert_Batcher  batcher(&conn, "test.readings", "sensor, value");
+
+    LittleFS.begin(true);
+    queue.begin();
+
+    if (conn.connected() && queue.empty())
+      batcher.add_row(sensor_id, value);
+    else
+      queue.push(sensor_id, value);             // survives a reboot
+
+    if (conn.connected())
+      queue.drain(batcher);                     // in loop()
+
+  Any fs::FS works: LittleFS, SPIFFS, SD, FFat.
+
+  Rows are appended to segment files of segment_bytes in dir, one
+  compact binary record per row: 0xa5, the payload length (2 bytes),
+  the values, then a CRC-32 of the payload. Records are never changed
+  once written, and a damaged one (a write cut short by a reset) is
+  skipped with the rest of its segment. After a restart, begin() goes on
+  appending to the last segment, unless it ends in a damaged record; a
+  new segment is started then.
+
+  drain() reads the records into the batcher. Each time the server
+  answers an INSERT, the position after its rows is saved in a
+  checkpoint, and fully sent segments are deleted. The checkpoint
+  alternates between two files, each with a generation number and a
+  CRC, so a reset while one is written leaves the other. A row is thus
+  sent at least once: a reset between an INSERT and its checkpoint
+  sends its rows again.
+
+  With max_segments segments full, the oldest one is dropped to make
+  room, counted in stats().dropped.
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_STORE_QUEUE_H
+#define ESP32_MYSQL_STORE_QUEUE_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <FS.h>
+#include <type_traits>
+
+#include <ESP32_MySQL_Insert_Batcher.h>
+
+#ifndef ESP32_MYSQL_QUEUE_SEGMENT_BYTES
+  #define ESP32_MYSQL_QUEUE_SEGMENT_BYTES   16384     // size of a segment file
+#endif
+
+#ifndef ESP32_MYSQL_QUEUE_SEGMENTS
+  #define ESP32_MYSQL_QUEUE_SEGMENTS        32        // segments kept, the oldest dropped after
+#endif
+
+#ifndef ESP32_MYSQL_QUEUE_RECORD_BYTES
+  #define ESP32_MYSQL_QUEUE_RECORD_BYTES    256       // largest record payload
+#endif
+
+#ifndef ESP32_MYSQL_QUEUE_VALUES
+  #define ESP32_MYSQL_QUEUE_VALUES          16        // values per row
+#endif
+
+// Record format
+#define ESP32_MYSQL_QUEUE_MARKER          0xa5
+#define ESP32_MYSQL_QUEUE_OVERHEAD        7         // marker, length, CRC-32
+
+// Value types in a record, each followed by its data
+#define QUEUE_VALUE_INT                   1         // zigzag varint
+#define QUEUE_VALUE_UINT                  2         // varint
+#define QUEUE_VALUE_FLOAT                 3         // 4 bytes
+#define QUEUE_VALUE_DOUBLE                4         // 8 bytes
+#define QUEUE_VALUE_STRING                5         // varint length, bytes, '\0'
+#define QUEUE_VALUE_NULL                  6
+
+typedef struct
+{
+  uint32_t queued;            // rows pushed
+  uint32_t sent;              // rows the server took
+  uint32_t failed;            // rows the server rejected, or too large for the batcher
+  uint32_t dropped;           // rows lost with the oldest segment
+  uint32_t damaged;           // damaged records, skipped with the rest of their segment
+  uint32_t drains;            // drain() calls that sent rows
+  uint32_t drain_rate;        // rows per second of the last of those
+} Queue_Stats;
+
+class ESP32_MySQL_Store_Queue
+{
+  public:
+    ESP32_MySQL_Store_Queue(fs::FS& fs, const char *dir = "/mysqlq",
+                            const size_t& segment_bytes = ESP32_MYSQL_QUEUE_SEGMENT_BYTES,
+                            const uint16_t& max_segments = ESP32_MYSQL_QUEUE_SEGMENTS);
+    ~ESP32_MySQL_Store_Queue();
+
+    bool begin();
+
+    /*
+      push - append a row to the queue
+
+      Values as for ESP32_MySQL_Insert_Batcher::add_row().
+
+      Returns bool - False = not begun, row too large or write failed
+    */
+    template <typename... Args>
+    bool push(const Args&... values)
+    {
+      static_assert(sizeof...(values) <= ESP32_MYSQL_QUEUE_VALUES, "increase ESP32_MYSQL_QUEUE_VALUES");
+
+      record_len = 0;
+
+      return put_byte(sizeof...(values)) && put_all(values...) && append_record();
+    }
+
+    // push() with the values and their types known at run time
+    bool push_values(const Batcher_Value *values, const uint16_t& count);
+
+    bool drain(ESP32_MySQL_Insert_Batcher& batcher, const uint32_t& max_rows = 0);
+
+    // Rows waiting
+    uint32_t backlog() const
+    {
+      return backlog_rows;
+    }
+
+    bool empty() const
+    {
+      return backlog_rows == 0;
+    }
+
+    const Queue_Stats& stats() const
+    {
+      return queue_stats;
+    }
+
+    void reset_stats()
+    {
+      memset(&queue_stats, 0, sizeof(queue_stats));
+    }
+
+  private:
+    // Result of reading a record
+    typedef enum
+    {
+      RECORD_OK = 0,
+      RECORD_END,             // end of the segment
+      RECORD_DAMAGED
+    } Record_Result;
+
+    bool          append_record();
+    Record_Result read_record(fs::File& file, uint8_t *buffer, size_t& length);
+    bool          decode_record(Batcher_Value *values, uint16_t& count);
+    void          advance(const uint32_t& seq, const uint32_t& offset, const uint32_t& rows);
+    uint32_t      count_records(const uint32_t& seq, const uint32_t& offset, uint32_t *end = NULL);
+    void          drop_oldest_segment();
+    bool          load_checkpoint();
+    bool          save_checkpoint();
+    const char    *segment_path(const uint32_t& seq);
+
+    bool put_byte(const uint8_t& value);
+    bool put_bytes(const void *data, const size_t& length);
+    bool put_varint(uint64_t value);
+    bool put_int(const int64_t& value);
+    bool put_uint(const uint64_t& value);
+    bool put_float(const float& value);
+    bool put_double(const double& value);
+    bool put_string(const char *value);
+    bool put_null();
+
+    bool put_all()
+    {
+      return true;
+    }
+
+    template <typename T, typename... Rest>
+    bool put_all(const T& value, const Rest&... rest)
+    {
+      return put_value(value) && put_all(rest...);
+    }
+
+    // One overload per value type, as ESP32_MySQL_Insert_Batcher
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, bool>::type
+    put_value(const T& value)
+    {
+      return put_int((int64_t) value);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, bool>::type
+    put_value(const T& value)
+    {
+      return put_uint((uint64_t) value);
+    }
+
+    bool put_value(const float& value)
+    {
+      return put_float(value);
+    }
+
+    bool put_value(const double& value)
+    {
+      return put_double(value);
+    }
+
+    bool put_value(const char *value)
+    {
+      return put_string(value);
+    }
+
+    bool put_value(const String& value)
+    {
+      return put_string(value.c_str());
+    }
+
+    bool put_value(const std::nullptr_t&)
+    {
+      return put_null();
+    }
+
+    fs::FS    *file_system;
+    char      *dir;
+    char      *path;            // sized for dir
+    size_t    path_size;
+
+    size_t    segment_bytes;
+    uint16_t  max_segments;
+    bool      started;
+
+    // Oldest row not yet sent, saved in the checkpoint
+    uint32_t  read_seq;
+    uint32_t  read_offset;
+    uint32_t  checkpoint_generation;
+
+    // Segment rows are appended to; write_size 0 = not created yet
+    uint32_t  write_seq;
+    uint32_t  write_size;
+
+    uint32_t  backlog_rows;
+
+    // Payload of the record pushed or read
+    uint8_t   record[ESP32_MYSQL_QUEUE_RECORD_BYTES];
+    size_t    record_len;
+
+    Queue_Stats queue_stats;
+};
+
+#endif    // ESP32_MYSQL_STORE_QUEUE_H
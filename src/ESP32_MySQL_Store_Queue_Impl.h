@@ -0,0 +1,789 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Store_Queue_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_STORE_QUEUE_IMPL_H
+#define ESP32_MYSQL_STORE_QUEUE_IMPL_H
+
+#include <ESP32_MySQL_Store_Queue.h>
+
+#define QUEUE_CHECKPOINT_MAGIC    0x4b43514dUL      // "MQCK"
+
+// Checkpoint file, written alternately to two slots
+typedef struct
+{
+  uint32_t magic;
+  uint32_t generation;
+  uint32_t read_seq;
+  uint32_t read_offset;
+  uint32_t crc;               // of the fields above
+} Queue_Checkpoint;
+
+// CRC-32 (IEEE 802.3), bit by bit: records are short
+static uint32_t SQL_crc32(const uint8_t *data, const size_t& length)
+{
+  uint32_t crc = 0xFFFFFFFFUL;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+  }
+
+  return ~crc;
+}
+
+/*
+  ESP32_MySQL_Store_Queue
+
+  fs[in]              mounted file system, e.g. LittleFS
+  dir[in]             (optional) directory of the queue files, copied
+  segment_bytes[in]   (optional) size of a segment file
+  max_segments[in]    (optional) segments kept, at least 2
+*/
+ESP32_MySQL_Store_Queue::ESP32_MySQL_Store_Queue(fs::FS& fs, const char *dir, const size_t& segment_bytes,
+                                                 const uint16_t& max_segments)
+{
+  file_system             = &fs;
+  this->dir               = SQL_strdup(dir);
+  // dir, then "/" and a segment name of up to 10 digits and ".seg"
+  path_size               = this->dir ? strlen(this->dir) + 16 : 0;
+  path                    = this->dir ? (char *) malloc(path_size) : NULL;
+  this->segment_bytes     = segment_bytes;
+  this->max_segments      = (max_segments < 2) ? 2 : max_segments;
+  started                 = false;
+  read_seq                = 1;
+  read_offset             = 0;
+  checkpoint_generation   = 0;
+  write_seq               = 1;
+  write_size              = 0;
+  backlog_rows            = 0;
+  record_len              = 0;
+
+  memset(&queue_stats, 0, sizeof(queue_stats));
+
+  if (!path)
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Store_Queue: out of memory");
+}
+
+ESP32_MySQL_Store_Queue::~ESP32_MySQL_Store_Queue()
+{
+  free(dir);
+  free(path);
+}
+
+/*
+  begin - open the queue left by the last run
+
+  Call it once the file system is mounted. Counts the rows waiting, which
+  reads every record once. New rows go on at the end of the last segment
+  if it ends after a whole record, else into a new one.
+
+  Returns bool - True = queue ready
+*/
+bool ESP32_MySQL_Store_Queue::begin()
+{
+  if (!dir || !path)
+    return false;
+
+  if (!file_system->exists(dir))
+    file_system->mkdir(dir);
+
+  uint32_t min_seq = 0;
+  uint32_t max_seq = 0;
+
+  // Segment files are named by their sequence number, "00000042.seg"
+  fs::File directory = file_system->open(dir);
+
+  if (directory && directory.isDirectory())
+  {
+    fs::File file;
+
+    while ( (file = directory.openNextFile()) )
+    {
+      const char *name = strrchr(file.name(), '/');
+      name = name ? name + 1 : file.name();
+
+      char *end;
+      const uint32_t seq = strtoul(name, &end, 10);
+
+      if ( (seq > 0) && (end != name) && (strcmp(end, ".seg") == 0) )
+      {
+        if ( (min_seq == 0) || (seq < min_seq) )
+          min_seq = seq;
+
+        if (seq > max_seq)
+          max_seq = seq;
+      }
+
+      file.close();
+    }
+
+    directory.close();
+  }
+
+  if (!load_checkpoint())
+  {
+    read_seq    = (min_seq > 0) ? min_seq : 1;
+    read_offset = 0;
+  }
+
+  // Segments dropped or lost since
+  if ( (min_seq > 0) && (read_seq < min_seq) )
+  {
+    read_seq    = min_seq;
+    read_offset = 0;
+  }
+
+  if (!file_system->exists(segment_path(read_seq)))
+    read_offset = 0;
+
+  write_seq   = (max_seq + 1 > read_seq) ? max_seq + 1 : read_seq;
+  write_size  = 0;
+
+  backlog_rows = 0;
+
+  for (uint32_t seq = read_seq; seq < write_seq; seq++)
+  {
+    uint32_t end = 0;
+
+    backlog_rows += count_records(seq, (seq == read_seq) ? read_offset : 0, &end);
+
+    // Never append after a record a reset may have cut short
+    if ( (seq == max_seq) && (end > 0) )
+    {
+      write_seq   = seq;
+      write_size  = end;
+    }
+  }
+
+  ESP32_MYSQL_LOGINFO1("ESP32_MySQL_Store_Queue: rows waiting =", backlog_rows);
+
+  started = save_checkpoint();
+
+  return started;
+}
+
+/*
+  push_values - append a row of count values
+
+  Returns bool - as push()
+*/
+bool ESP32_MySQL_Store_Queue::push_values(const Batcher_Value *values, const uint16_t& count)
+{
+  if (count > ESP32_MYSQL_QUEUE_VALUES)
+    return false;
+
+  record_len = 0;
+
+  if (!put_byte(count))
+    return false;
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    const Batcher_Value& v = values[i];
+    bool ok;
+
+    switch (v.type)
+    {
+      case MYSQL_TYPE_LONGLONG:
+        ok = v.is_unsigned ? put_uint(v.value.u) : put_int(v.value.i);
+        break;
+
+      case MYSQL_TYPE_FLOAT:
+        ok = put_float((float) v.value.d);
+        break;
+
+      case MYSQL_TYPE_DOUBLE:
+        ok = put_double(v.value.d);
+        break;
+
+      case MYSQL_TYPE_STRING:
+        ok = put_string(v.text);
+        break;
+
+      default:
+        ok = put_null();
+        break;
+    }
+
+    if (!ok)
+      return false;
+  }
+
+  return append_record();
+}
+
+/*
+  drain - send waiting rows through batcher, oldest first
+
+  Rows waiting in batcher are sent first. Rows the server rejects are
+  dropped like those of the batcher, and counted in stats().failed.
+
+  batcher[in]     batcher of the table the rows are for
+  max_rows[in]    (optional) rows to read at most, 0 = all
+
+  Returns bool - True = every row read was answered; false = connection
+                 failed, the rows stay queued
+*/
+bool ESP32_MySQL_Store_Queue::drain(ESP32_MySQL_Insert_Batcher& batcher, const uint32_t& max_rows)
+{
+  if ( !started || (backlog_rows == 0) )
+    return true;
+
+  batcher.flush();
+
+  if (batcher.pending_rows() > 0)
+    return false;
+
+  const Batcher_Stats& batch_stats = batcher.stats();
+  const uint32_t rows_before = batch_stats.rows;
+  const uint32_t failed_before = batch_stats.failed_rows;
+  const uint32_t start = millis();
+
+  const uint32_t last_seq = (write_size > 0) ? write_seq : write_seq - 1;
+
+  uint32_t seq = read_seq;
+  uint32_t offset = read_offset;
+  uint32_t rows_read = 0;
+  uint32_t unconfirmed = 0;       // rows read since the checkpoint
+  bool answered = true;
+
+  Batcher_Value values[ESP32_MYSQL_QUEUE_VALUES];
+  uint16_t count;
+
+  while ( answered && (seq <= last_seq) && ((max_rows == 0) || (rows_read < max_rows)) )
+  {
+    fs::File file = file_system->open(segment_path(seq), FILE_READ);
+    Record_Result result = RECORD_END;
+
+    if (file && file.seek(offset))
+    {
+      while ( answered && ((max_rows == 0) || (rows_read < max_rows)) )
+      {
+        result = read_record(file, record, record_len);
+
+        if (result != RECORD_OK)
+          break;
+
+        const uint32_t record_start = offset;
+
+        offset += record_len + ESP32_MYSQL_QUEUE_OVERHEAD;
+        rows_read++;
+        unconfirmed++;
+
+        // Can never be sent: not a valid row, or the wrong number of values
+        if ( !decode_record(values, count) || (count != batcher.column_count()) )
+        {
+          queue_stats.failed++;
+          continue;
+        }
+
+        const uint16_t pending_before = batcher.pending_rows();
+
+        if (batcher.add_values(values, count))
+        {
+          if (batcher.pending_rows() == 0)
+          {
+            // This row went out with the others
+            advance(seq, offset, unconfirmed);
+            unconfirmed = 0;
+          }
+          else if ( (pending_before > 0) && (batcher.pending_rows() == 1) )
+          {
+            // The others went out to make room for this row
+            advance(seq, record_start, unconfirmed - 1);
+            unconfirmed = 1;
+          }
+        }
+        else if (batcher.pending_rows() > 0)
+        {
+          answered = false;
+        }
+        else
+        {
+          // Can never be sent: larger than max_bytes
+          queue_stats.failed++;
+          advance(seq, offset, unconfirmed);
+          unconfirmed = 0;
+        }
+      }
+    }
+
+    file.close();
+
+    if ( !answered || (result == RECORD_OK) )
+      break;
+
+    if (result == RECORD_DAMAGED)
+    {
+      ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Store_Queue: damaged record, rest of segment skipped:", segment_path(seq));
+      queue_stats.damaged++;
+    }
+
+    // The segment being written may still grow
+    if (seq == write_seq)
+      break;
+
+    seq++;
+    offset = 0;
+  }
+
+  if (answered)
+  {
+    batcher.flush();
+    answered = (batcher.pending_rows() == 0);
+  }
+
+  if (answered)
+    advance(seq, offset, unconfirmed);
+  else
+    batcher.clear();
+
+  const uint32_t sent = batch_stats.rows - rows_before;
+  const uint32_t elapsed = millis() - start;
+
+  queue_stats.sent   += sent;
+  queue_stats.failed += batch_stats.failed_rows - failed_before;
+
+  if (sent > 0)
+  {
+    queue_stats.drains++;
+    queue_stats.drain_rate = (sent * 1000UL) / (elapsed ? elapsed : 1);
+  }
+
+  ESP32_MYSQL_LOGDEBUG3("ESP32_MySQL_Store_Queue: sent =", sent, ", rows waiting =", backlog_rows);
+
+  return answered;
+}
+
+/*
+  advance - move the checkpoint to seq / offset
+
+  Segments before it are sent and deleted.
+
+  rows[in]        rows passed
+*/
+void ESP32_MySQL_Store_Queue::advance(const uint32_t& seq, const uint32_t& offset, const uint32_t& rows)
+{
+  for (uint32_t s = read_seq; s < seq; s++)
+    file_system->remove(segment_path(s));
+
+  read_seq      = seq;
+  read_offset   = offset;
+  backlog_rows  = (rows < backlog_rows) ? backlog_rows - rows : 0;
+
+  save_checkpoint();
+}
+
+bool ESP32_MySQL_Store_Queue::append_record()
+{
+  if (!started)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Store_Queue: begin() first");
+    return false;
+  }
+
+  const size_t total = record_len + ESP32_MYSQL_QUEUE_OVERHEAD;
+
+  if ( (write_size > 0) && (write_size + total > segment_bytes) )
+  {
+    write_seq++;
+    write_size = 0;
+  }
+
+  if (write_size == 0)
+  {
+    while (write_seq - read_seq + 1 > max_segments)
+      drop_oldest_segment();
+  }
+
+  uint8_t header[3] = { ESP32_MYSQL_QUEUE_MARKER, (uint8_t) record_len, (uint8_t) (record_len >> 8) };
+  uint8_t crc[4];
+  const uint32_t value = SQL_crc32(record, record_len);
+
+  for (uint8_t i = 0; i < 4; i++)
+    crc[i] = (uint8_t) (value >> (8 * i));
+
+  fs::File file = file_system->open(segment_path(write_seq), FILE_APPEND);
+  size_t written = 0;
+
+  if (file)
+  {
+    written = file.write(header, sizeof(header));
+    written += file.write(record, record_len);
+    written += file.write(crc, sizeof(crc));
+    file.close();
+  }
+
+  if (written != total)
+  {
+    // A partial record ends its segment
+    ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Store_Queue: can't write", segment_path(write_seq));
+
+    if (written > 0)
+    {
+      write_seq++;
+      write_size = 0;
+    }
+
+    return false;
+  }
+
+  write_size += total;
+  backlog_rows++;
+  queue_stats.queued++;
+
+  return true;
+}
+
+/*
+  read_record - read the next record of file
+
+  buffer[out]     payload, ESP32_MYSQL_QUEUE_RECORD_BYTES long
+  length[out]     of the payload
+*/
+ESP32_MySQL_Store_Queue::Record_Result ESP32_MySQL_Store_Queue::read_record(fs::File& file, uint8_t *buffer,
+                                                                           size_t& length)
+{
+  uint8_t header[3];
+  uint8_t crc[4];
+
+  const size_t got = file.read(header, sizeof(header));
+
+  if (got == 0)
+    return RECORD_END;
+
+  if ( (got != sizeof(header)) || (header[0] != ESP32_MYSQL_QUEUE_MARKER) )
+    return RECORD_DAMAGED;
+
+  length = header[1] | (header[2] << 8);
+
+  if ( (length == 0) || (length > ESP32_MYSQL_QUEUE_RECORD_BYTES) )
+    return RECORD_DAMAGED;
+
+  if ( (file.read(buffer, length) != length) || (file.read(crc, sizeof(crc)) != sizeof(crc)) )
+    return RECORD_DAMAGED;
+
+  const uint32_t value = crc[0] | (crc[1] << 8) | (crc[2] << 16) | ((uint32_t) crc[3] << 24);
+
+  return (value == SQL_crc32(buffer, length)) ? RECORD_OK : RECORD_DAMAGED;
+}
+
+// Varint of record at pos, pos moved past it
+static bool SQL_get_varint(const uint8_t *record, const size_t& length, size_t& pos, uint64_t& value)
+{
+  value = 0;
+
+  for (uint8_t shift = 0; (shift < 64) && (pos < length); shift += 7)
+  {
+    const uint8_t b = record[pos++];
+
+    value |= (uint64_t) (b & 0x7f) << shift;
+
+    if ((b & 0x80) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+/*
+  decode_record - values of the record read last
+
+  Strings point into the record.
+
+  Returns bool - False = not a valid row
+*/
+bool ESP32_MySQL_Store_Queue::decode_record(Batcher_Value *values, uint16_t& count)
+{
+  size_t pos = 1;
+
+  count = record[0];
+
+  if (count > ESP32_MYSQL_QUEUE_VALUES)
+    return false;
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    Batcher_Value& v = values[i];
+    uint64_t n;
+
+    memset(&v, 0, sizeof(v));
+
+    if (pos >= record_len)
+      return false;
+
+    switch (record[pos++])
+    {
+      case QUEUE_VALUE_INT:
+        if (!SQL_get_varint(record, record_len, pos, n))
+          return false;
+
+        v.type    = MYSQL_TYPE_LONGLONG;
+        v.value.i = (int64_t) (n >> 1) ^ -(int64_t) (n & 1);
+        break;
+
+      case QUEUE_VALUE_UINT:
+        if (!SQL_get_varint(record, record_len, pos, n))
+          return false;
+
+        v.type        = MYSQL_TYPE_LONGLONG;
+        v.is_unsigned = true;
+        v.value.u     = n;
+        break;
+
+      case QUEUE_VALUE_FLOAT:
+      {
+        float f;
+
+        if (pos + sizeof(f) > record_len)
+          return false;
+
+        memcpy(&f, &record[pos], sizeof(f));
+        pos += sizeof(f);
+
+        v.type    = MYSQL_TYPE_FLOAT;
+        v.value.d = f;
+        break;
+      }
+
+      case QUEUE_VALUE_DOUBLE:
+        if (pos + sizeof(double) > record_len)
+          return false;
+
+        memcpy(&v.value.d, &record[pos], sizeof(double));
+        pos += sizeof(double);
+
+        v.type = MYSQL_TYPE_DOUBLE;
+        break;
+
+      case QUEUE_VALUE_STRING:
+        if ( !SQL_get_varint(record, record_len, pos, n) || (pos + n + 1 > record_len) || (record[pos + n] != 0) )
+          return false;
+
+        v.type  = MYSQL_TYPE_STRING;
+        v.text  = (const char *) &record[pos];
+        pos    += n + 1;
+        break;
+
+      case QUEUE_VALUE_NULL:
+        v.type = MYSQL_TYPE_NULL;
+        break;
+
+      default:
+        return false;
+    }
+  }
+
+  return pos == record_len;
+}
+
+/*
+  count_records - whole records of segment seq from offset on
+
+  end[out]        (optional) size of the segment if it ends after a
+                  whole record and holds at least one, else 0
+*/
+uint32_t ESP32_MySQL_Store_Queue::count_records(const uint32_t& seq, const uint32_t& offset, uint32_t *end)
+{
+  if (end)
+    *end = 0;
+
+  fs::File file = file_system->open(segment_path(seq), FILE_READ);
+
+  if (!file)
+    return 0;
+
+  uint8_t buffer[ESP32_MYSQL_QUEUE_RECORD_BYTES];
+  size_t length;
+  uint32_t records = 0;
+  uint32_t position = offset;
+
+  if (file.seek(offset))
+  {
+    Record_Result result;
+
+    while ( (result = read_record(file, buffer, length)) == RECORD_OK )
+    {
+      records++;
+      position += length + ESP32_MYSQL_QUEUE_OVERHEAD;
+    }
+
+    if ( end && (result == RECORD_END) )
+      *end = position;
+  }
+
+  file.close();
+
+  return records;
+}
+
+void ESP32_MySQL_Store_Queue::drop_oldest_segment()
+{
+  const uint32_t rows = count_records(read_seq, read_offset);
+
+  ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Store_Queue: queue full, rows dropped =", rows);
+
+  queue_stats.dropped += rows;
+  advance(read_seq + 1, 0, rows);
+}
+
+bool ESP32_MySQL_Store_Queue::load_checkpoint()
+{
+  bool found = false;
+
+  for (uint8_t slot = 0; slot < 2; slot++)
+  {
+    Queue_Checkpoint checkpoint;
+
+    snprintf(path, path_size, "%s/ckpt%u", dir, slot);
+
+    fs::File file = file_system->open(path, FILE_READ);
+
+    if (!file)
+      continue;
+
+    const size_t got = file.read((uint8_t *) &checkpoint, sizeof(checkpoint));
+
+    file.close();
+
+    if ( (got != sizeof(checkpoint)) || (checkpoint.magic != QUEUE_CHECKPOINT_MAGIC) ||
+         (checkpoint.crc != SQL_crc32((const uint8_t *) &checkpoint, offsetof(Queue_Checkpoint, crc))) )
+    {
+      continue;
+    }
+
+    if ( !found || (checkpoint.generation > checkpoint_generation) )
+    {
+      checkpoint_generation = checkpoint.generation;
+      read_seq              = checkpoint.read_seq;
+      read_offset           = checkpoint.read_offset;
+      found                 = true;
+    }
+  }
+
+  return found;
+}
+
+// Writes the slot not holding the last checkpoint
+bool ESP32_MySQL_Store_Queue::save_checkpoint()
+{
+  Queue_Checkpoint checkpoint;
+
+  checkpoint.magic        = QUEUE_CHECKPOINT_MAGIC;
+  checkpoint.generation   = checkpoint_generation + 1;
+  checkpoint.read_seq     = read_seq;
+  checkpoint.read_offset  = read_offset;
+  checkpoint.crc          = SQL_crc32((const uint8_t *) &checkpoint, offsetof(Queue_Checkpoint, crc));
+
+  snprintf(path, path_size, "%s/ckpt%u", dir, (unsigned) (checkpoint.generation & 1));
+
+  fs::File file = file_system->open(path, FILE_WRITE);
+
+  if ( !file || (file.write((const uint8_t *) &checkpoint, sizeof(checkpoint)) != sizeof(checkpoint)) )
+  {
+    ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Store_Queue: can't write", path);
+    file.close();
+
+    return false;
+  }
+
+  file.close();
+  checkpoint_generation = checkpoint.generation;
+
+  return true;
+}
+
+const char *ESP32_MySQL_Store_Queue::segment_path(const uint32_t& seq)
+{
+  snprintf(path, path_size, "%s/%08lu.seg", dir, (unsigned long) seq);
+
+  return path;
+}
+
+bool ESP32_MySQL_Store_Queue::put_byte(const uint8_t& value)
+{
+  return put_bytes(&value, 1);
+}
+
+bool ESP32_MySQL_Store_Queue::put_bytes(const void *data, const size_t& length)
+{
+  if (record_len + length > ESP32_MYSQL_QUEUE_RECORD_BYTES)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Store_Queue: row larger than ESP32_MYSQL_QUEUE_RECORD_BYTES");
+    return false;
+  }
+
+  memcpy(&record[record_len], data, length);
+  record_len += length;
+
+  return true;
+}
+
+bool ESP32_MySQL_Store_Queue::put_varint(uint64_t value)
+{
+  do
+  {
+    const uint8_t b = (value & 0x7f) | ((value > 0x7f) ? 0x80 : 0);
+
+    if (!put_byte(b))
+      return false;
+
+    value >>= 7;
+  } while (value > 0);
+
+  return true;
+}
+
+bool ESP32_MySQL_Store_Queue::put_int(const int64_t& value)
+{
+  // Zigzag: small negative numbers stay short
+  return put_byte(QUEUE_VALUE_INT) && put_varint(((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+bool ESP32_MySQL_Store_Queue::put_uint(const uint64_t& value)
+{
+  return put_byte(QUEUE_VALUE_UINT) && put_varint(value);
+}
+
+bool ESP32_MySQL_Store_Queue::put_float(const float& value)
+{
+  return put_byte(QUEUE_VALUE_FLOAT) && put_bytes(&value, sizeof(value));
+}
+
+bool ESP32_MySQL_Store_Queue::put_double(const double& value)
+{
+  return put_byte(QUEUE_VALUE_DOUBLE) && put_bytes(&value, sizeof(value));
+}
+
+bool ESP32_MySQL_Store_Queue::put_string(const char *value)
+{
+  if (!value)
+    return put_null();
+
+  const size_t length = strlen(value);
+
+  return put_byte(QUEUE_VALUE_STRING) && put_varint(length) && put_bytes(value, length + 1);
+}
+
+bool ESP32_MySQL_Store_Queue::put_null()
+{
+  return put_byte(QUEUE_VALUE_NULL);
+}
+
+#endif    // ESP32_MYSQL_STORE_QUEUE_IMPL_H
@@ -0,0 +1,243 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Time_Series.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Time-series ingestion
+
+  A fixed ring of packed samples, 10 bytes each, filled by a fast
+  producer (a sampling task, or an interrupt handler) and emptied into
+  the database by a flush on another task:
+
+    ESP32_MySQL_Time_Series series(&conn, "test.samples", "taken, sensor, value", 2048);
+
+    series.set_flush_policy(500, 1000);     // 500 samples or 1 s
+    series.start_task();                    // flushes in the background
+
+    series.push(sensor, value);             // from the producer, never waits on the network
+
+  A sample holds a time (millis() unless given), a channel and a float
+  value, written to the three columns in that order. A flush sends them
+  as multi-row INSERTs (an ESP32_MySQL_Insert_Batcher), or with
+  set_flush_mode(TS_FLUSH_STATEMENT) as a prepared statement batch
+  (COM_STMT_BULK_EXECUTE on MariaDB).
+
+  A flush is due when flush_count samples or flush_bytes bytes of the
+  ring are waiting, or flush_ms after the last flush. Samples leave the
+  ring only once the server has answered for them, so a failed flush
+  sends them again next time. When the ring is full push() follows the
+  overflow policy:
+
+    TS_DROP_OLDEST    the oldest waiting sample makes room (default)
+    TS_DROP_NEWEST    the new sample is dropped
+    TS_BLOCK          push() waits up to block_ms for the flush to make
+                      room, then drops the new sample; without a flush
+                      task it flushes itself. Never waits in an interrupt
+
+  push() only holds a short critical section, so it can be called from
+  an interrupt handler. The flush uses the connection: with start_task()
+  give the series a connection of its own, or enable_thread_safe().
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_TIME_SERIES_H
+#define ESP32_MYSQL_TIME_SERIES_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <ESP32_MySQL_Insert_Batcher.h>
+#include <ESP32_MySQL_Statement.h>
+
+#if defined(ESP32)
+  #include "freertos/FreeRTOS.h"
+  #include "freertos/task.h"
+#endif
+
+#ifndef ESP32_MYSQL_TS_CAPACITY
+  #define ESP32_MYSQL_TS_CAPACITY       1024      // samples in the ring
+#endif
+
+#ifndef ESP32_MYSQL_TS_FLUSH_COUNT
+  #define ESP32_MYSQL_TS_FLUSH_COUNT    200       // samples waiting
+#endif
+
+#ifndef ESP32_MYSQL_TS_FLUSH_MS
+  #define ESP32_MYSQL_TS_FLUSH_MS       1000      // since the last flush
+#endif
+
+#ifndef ESP32_MYSQL_TS_CHUNK
+  #define ESP32_MYSQL_TS_CHUNK          32        // samples copied out of the ring at a time
+#endif
+
+typedef struct __attribute__((packed))
+{
+  uint32_t  time;
+  uint16_t  channel;
+  float     value;
+} TS_Sample;
+
+typedef enum
+{
+  TS_DROP_OLDEST = 0,
+  TS_DROP_NEWEST,
+  TS_BLOCK
+} TS_Overflow;
+
+typedef enum
+{
+  TS_FLUSH_INSERT = 0,        // multi-row INSERT
+  TS_FLUSH_STATEMENT          // prepared statement batch
+} TS_Flush_Mode;
+
+typedef struct
+{
+  uint32_t pushed;            // samples stored
+  uint32_t dropped_oldest;    // overwritten before they were sent
+  uint32_t dropped_newest;    // refused with the ring full
+  uint32_t blocked;           // push() calls that waited for room
+  uint32_t sent;              // samples the server took
+  uint32_t rejected;          // samples in rejected statements, dropped
+  uint32_t flushes;           // flushes that sent samples
+  uint32_t failed_flushes;    // flushes stopped by the connection
+  uint32_t max_waiting;       // highest fill of the ring
+  uint32_t last_flush_ms;     // duration of the last flush
+  uint32_t max_flush_ms;
+} TS_Stats;
+
+class ESP32_MySQL_Time_Series
+{
+  public:
+    ESP32_MySQL_Time_Series(ESP32_MySQL_Connection *connection, const char *table, const char *columns,
+                            const uint32_t& capacity = ESP32_MYSQL_TS_CAPACITY);
+    ~ESP32_MySQL_Time_Series();
+
+    bool push(const uint16_t& channel, const float& value);
+    bool push(const uint16_t& channel, const float& value, const uint32_t& time);
+
+    // Flush when count samples, age_ms or bytes of samples wait; 0 = no limit
+    void set_flush_policy(const uint32_t& count, const uint32_t& age_ms, const size_t& bytes = 0)
+    {
+      flush_count = count;
+      flush_ms    = age_ms;
+      flush_bytes = bytes;
+    }
+
+    void set_overflow(const TS_Overflow& policy, const uint32_t& block_ms = 0)
+    {
+      overflow      = policy;
+      this->block_ms = block_ms;
+    }
+
+    void set_flush_mode(const TS_Flush_Mode& mode)
+    {
+      flush_mode = mode;
+    }
+
+    bool flush();
+    bool flush_if_due();
+
+#if defined(ESP32)
+    // Task calling flush_if_due() every interval_ms
+    bool start_task(const uint32_t& interval_ms = 10, const UBaseType_t& priority = 1,
+                    const BaseType_t& core = tskNO_AFFINITY, const uint32_t& stack_bytes = 6144);
+    void stop_task();
+#endif
+
+    // Samples in the ring, not yet sent
+    uint32_t waiting();
+
+    uint32_t get_capacity() const
+    {
+      return capacity;
+    }
+
+    const TS_Stats& stats() const
+    {
+      return ts_stats;
+    }
+
+    void reset_stats()
+    {
+      memset(&ts_stats, 0, sizeof(ts_stats));
+    }
+
+    ESP32_MySQL_Connection *connection()
+    {
+      return conn;
+    }
+
+  private:
+    bool      store(const TS_Sample& sample);
+    uint32_t  copy_samples(uint32_t& seq, const uint32_t& end, TS_Sample *samples);
+    void      release(const uint32_t& seq);
+    bool      flush_inserts(const uint32_t& end);
+    bool      flush_statement(const uint32_t& end);
+    bool      execute_batch(const uint32_t& seq);
+    bool      in_interrupt();
+
+    void lock()
+    {
+#if defined(ESP32)
+      if (xPortInIsrContext())
+        portENTER_CRITICAL_ISR(&mux);
+      else
+        portENTER_CRITICAL(&mux);
+#endif
+    }
+
+    void unlock()
+    {
+#if defined(ESP32)
+      if (xPortInIsrContext())
+        portEXIT_CRITICAL_ISR(&mux);
+      else
+        portEXIT_CRITICAL(&mux);
+#endif
+    }
+
+#if defined(ESP32)
+    static void flush_task(void *series);
+
+    portMUX_TYPE          mux = portMUX_INITIALIZER_UNLOCKED;
+    volatile TaskHandle_t task = NULL;
+    volatile bool         task_running = false;
+    uint32_t              task_interval_ms = 10;
+#endif
+
+    ESP32_MySQL_Connection *conn;
+
+    // head and tail count the samples ever stored and released; the
+    // ring holds head - tail of them, sample n at ring[n % capacity]
+    TS_Sample         *ring;
+    uint32_t          capacity;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile bool     flushing;
+
+    ESP32_MySQL_Insert_Batcher  batcher;
+    ESP32_MySQL_Statement       statement;
+    String                      insert_sql;     // of the statement, with placeholders
+
+    TS_Flush_Mode     flush_mode;
+    TS_Overflow       overflow;
+    uint32_t          block_ms;
+    uint32_t          flush_count;
+    uint32_t          flush_ms;
+    size_t            flush_bytes;
+    uint32_t          last_flush_ms;
+
+    TS_Stats          ts_stats;
+};
+
+#endif    // ESP32_MYSQL_TIME_SERIES_H
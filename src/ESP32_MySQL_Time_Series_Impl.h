@@ -0,0 +1,487 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Time_Series_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_TIME_SERIES_IMPL_H
+#define ESP32_MYSQL_TIME_SERIES_IMPL_H
+
+#include <ESP32_MySQL_Time_Series.h>
+
+/*
+  ESP32_MySQL_Time_Series
+
+  table[in]       table name, e.g. "test.samples"
+  columns[in]     the time, channel and value columns, e.g. "taken, sensor, value"
+  capacity[in]    (optional) samples in the ring, allocated here
+*/
+ESP32_MySQL_Time_Series::ESP32_MySQL_Time_Series(ESP32_MySQL_Connection *connection, const char *table,
+                                                 const char *columns, const uint32_t& capacity)
+  : batcher(connection, table, columns, 0xFFFF, 0xFFFFFFFFUL),
+    statement(connection),
+    insert_sql(String("INSERT INTO ") + table + " (" + columns + ") VALUES (?,?,?)")
+{
+  conn            = connection;
+  this->capacity  = (capacity == 0) ? 1 : capacity;
+  head            = 0;
+  tail            = 0;
+  flushing        = false;
+  flush_mode      = TS_FLUSH_INSERT;
+  overflow        = TS_DROP_OLDEST;
+  block_ms        = 0;
+  flush_count     = ESP32_MYSQL_TS_FLUSH_COUNT;
+  flush_ms        = ESP32_MYSQL_TS_FLUSH_MS;
+  flush_bytes     = 0;
+  last_flush_ms   = millis();
+
+  memset(&ts_stats, 0, sizeof(ts_stats));
+
+  ring = (TS_Sample *) malloc(this->capacity * sizeof(TS_Sample));
+
+  if (!ring)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Time_Series: out of memory");
+    this->capacity = 0;
+  }
+}
+
+ESP32_MySQL_Time_Series::~ESP32_MySQL_Time_Series()
+{
+#if defined(ESP32)
+  stop_task();
+#endif
+
+  if (head != tail)
+    ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Time_Series: samples not sent =", (uint32_t) (head - tail));
+
+  free(ring);
+}
+
+/*
+  push - store a sample taken now
+
+  channel[in]     sensor or series number
+  value[in]       the reading
+
+  Returns bool - False = ring full and the sample dropped (TS_DROP_NEWEST,
+                 or TS_BLOCK without room in time)
+*/
+bool ESP32_MySQL_Time_Series::push(const uint16_t& channel, const float& value)
+{
+  return push(channel, value, (uint32_t) millis());
+}
+
+// push() with the time the sample was taken
+bool ESP32_MySQL_Time_Series::push(const uint16_t& channel, const float& value, const uint32_t& time)
+{
+  TS_Sample sample;
+
+  sample.time     = time;
+  sample.channel  = channel;
+  sample.value    = value;
+
+  if ( (overflow == TS_BLOCK) && (waiting() >= capacity) && (capacity > 0) && !in_interrupt() )
+  {
+    lock();
+    ts_stats.blocked++;
+    unlock();
+
+#if defined(ESP32)
+    if (task)
+    {
+      const uint32_t start = millis();
+
+      while ( (waiting() >= capacity) && ((uint32_t) (millis() - start) < block_ms) )
+        vTaskDelay(1);
+    }
+    else
+#endif
+    {
+      flush();
+    }
+  }
+
+  return store(sample);
+}
+
+/*
+  flush - send the waiting samples now
+
+  Sends what is in the ring when called; samples pushed meanwhile wait
+  for the next flush. Only one flush runs at a time.
+
+  Returns bool - True = every sample answered, or none waiting; false =
+                 connection failed or busy, the samples stay
+*/
+bool ESP32_MySQL_Time_Series::flush()
+{
+  lock();
+
+  const bool busy = flushing;
+  const uint32_t end = head;
+
+  flushing = true;
+  unlock();
+
+  if (busy)
+    return false;
+
+  bool ok = true;
+
+  if (end != tail)
+  {
+    const uint32_t start = millis();
+    const uint32_t sent_before = ts_stats.sent;
+
+    ok = (flush_mode == TS_FLUSH_STATEMENT) ? flush_statement(end) : flush_inserts(end);
+
+    const uint32_t elapsed = millis() - start;
+
+    if (ts_stats.sent != sent_before)
+      ts_stats.flushes++;
+
+    if (!ok)
+      ts_stats.failed_flushes++;
+
+    ts_stats.last_flush_ms = elapsed;
+
+    if (elapsed > ts_stats.max_flush_ms)
+      ts_stats.max_flush_ms = elapsed;
+
+    ESP32_MYSQL_LOGDEBUG3("ESP32_MySQL_Time_Series: sent =", ts_stats.sent - sent_before, ", ms =", elapsed);
+  }
+
+  last_flush_ms = millis();
+  flushing      = false;
+
+  return ok;
+}
+
+/*
+  flush_if_due - flush if the flush policy says so
+
+  Due with flush_count samples or flush_bytes bytes waiting, a full
+  ring, or flush_ms after the last flush. Called by the task of
+  start_task(); without one call it from loop().
+
+  Returns bool - False = a due flush failed
+*/
+bool ESP32_MySQL_Time_Series::flush_if_due()
+{
+  const uint32_t count = waiting();
+
+  if (count == 0)
+    return true;
+
+  if ( (count >= capacity) || ((flush_count > 0) && (count >= flush_count)) ||
+       ((flush_bytes > 0) && (count * sizeof(TS_Sample) >= flush_bytes)) ||
+       ((flush_ms > 0) && ((uint32_t) (millis() - last_flush_ms) >= flush_ms)) )
+  {
+    return flush();
+  }
+
+  return true;
+}
+
+uint32_t ESP32_MySQL_Time_Series::waiting()
+{
+  lock();
+
+  const uint32_t count = head - tail;
+
+  unlock();
+
+  return count;
+}
+
+#if defined(ESP32)
+
+/*
+  start_task - flush in the background
+
+  interval_ms[in]   (optional) time between flush_if_due() calls
+  priority[in]      (optional) of the task
+  core[in]          (optional) core to run on, e.g. the one WiFi is not on
+  stack_bytes[in]   (optional) stack of the task
+
+  Returns bool - True = task running
+*/
+bool ESP32_MySQL_Time_Series::start_task(const uint32_t& interval_ms, const UBaseType_t& priority,
+                                         const BaseType_t& core, const uint32_t& stack_bytes)
+{
+  if (task)
+    return true;
+
+  task_interval_ms  = (interval_ms == 0) ? 1 : interval_ms;
+  task_running      = true;
+
+  TaskHandle_t handle = NULL;
+
+  if (xTaskCreatePinnedToCore(flush_task, "mysql_ts", stack_bytes, this, priority, &handle, core) != pdPASS)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Time_Series: can't create flush task");
+    task_running = false;
+
+    return false;
+  }
+
+  task = handle;
+
+  return true;
+}
+
+// Stops the task after its current flush
+void ESP32_MySQL_Time_Series::stop_task()
+{
+  task_running = false;
+
+  while (task)
+    vTaskDelay(1);
+}
+
+void ESP32_MySQL_Time_Series::flush_task(void *series)
+{
+  ESP32_MySQL_Time_Series *self = (ESP32_MySQL_Time_Series *) series;
+
+  while (self->task_running)
+  {
+    self->flush_if_due();
+    vTaskDelay(pdMS_TO_TICKS(self->task_interval_ms));
+  }
+
+  self->task = NULL;
+  vTaskDelete(NULL);
+}
+
+#endif
+
+bool ESP32_MySQL_Time_Series::in_interrupt()
+{
+#if defined(ESP32)
+  return xPortInIsrContext();
+#else
+  return false;
+#endif
+}
+
+/*
+  store - put a sample in the ring, following the overflow policy when
+          it is full
+*/
+bool ESP32_MySQL_Time_Series::store(const TS_Sample& sample)
+{
+  if (capacity == 0)
+    return false;
+
+  lock();
+
+  if (head - tail >= capacity)
+  {
+    if (overflow != TS_DROP_OLDEST)
+    {
+      ts_stats.dropped_newest++;
+      unlock();
+
+      return false;
+    }
+
+    tail = tail + 1;
+    ts_stats.dropped_oldest++;
+  }
+
+  ring[head % capacity] = sample;
+  head = head + 1;
+
+  ts_stats.pushed++;
+
+  if (head - tail > ts_stats.max_waiting)
+    ts_stats.max_waiting = head - tail;
+
+  unlock();
+
+  return true;
+}
+
+/*
+  copy_samples - copy up to ESP32_MYSQL_TS_CHUNK samples from seq on
+
+  Samples overwritten since seq was read are skipped.
+
+  seq[in,out]     first sample to copy, then the one after the last copied
+  end[in]         sample to stop at
+  samples[out]    ESP32_MYSQL_TS_CHUNK samples
+
+  Returns uint32_t - samples copied
+*/
+uint32_t ESP32_MySQL_Time_Series::copy_samples(uint32_t& seq, const uint32_t& end, TS_Sample *samples)
+{
+  lock();
+
+  if ((int32_t) (tail - seq) > 0)
+    seq = tail;
+
+  uint32_t count = ((int32_t) (end - seq) > 0) ? end - seq : 0;
+
+  if (count > ESP32_MYSQL_TS_CHUNK)
+    count = ESP32_MYSQL_TS_CHUNK;
+
+  for (uint32_t i = 0; i < count; i++)
+    samples[i] = ring[(seq + i) % capacity];
+
+  unlock();
+
+  seq += count;
+
+  return count;
+}
+
+// Samples before seq are answered for and leave the ring
+void ESP32_MySQL_Time_Series::release(const uint32_t& seq)
+{
+  lock();
+
+  if ((int32_t) (seq - tail) > 0)
+    tail = seq;
+
+  unlock();
+}
+
+/*
+  flush_inserts - samples up to end as multi-row INSERTs
+
+  As ESP32_MySQL_Store_Queue::drain(), samples are released each time
+  the batcher sends the rows they are in.
+*/
+bool ESP32_MySQL_Time_Series::flush_inserts(const uint32_t& end)
+{
+  const Batcher_Stats& batch_stats = batcher.stats();
+  const uint32_t rows_before = batch_stats.rows;
+  const uint32_t failed_before = batch_stats.failed_rows;
+
+  TS_Sample samples[ESP32_MYSQL_TS_CHUNK];
+  uint32_t seq = tail;
+  uint32_t count;
+  bool answered = true;
+
+  while ( answered && ((count = copy_samples(seq, end, samples)) > 0) )
+  {
+    const uint32_t first = seq - count;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+      const uint16_t pending_before = batcher.pending_rows();
+
+      if (batcher.add_row(samples[i].time, samples[i].channel, samples[i].value))
+      {
+        if (batcher.pending_rows() == 0)
+          release(first + i + 1);
+        else if ( (pending_before > 0) && (batcher.pending_rows() == 1) )
+          release(first + i);
+      }
+      else
+      {
+        answered = false;
+        break;
+      }
+    }
+  }
+
+  if (answered)
+  {
+    batcher.flush();
+    answered = (batcher.pending_rows() == 0);
+  }
+
+  if (answered)
+    release(seq);
+  else
+    batcher.clear();
+
+  ts_stats.sent     += batch_stats.rows - rows_before;
+  ts_stats.rejected += batch_stats.failed_rows - failed_before;
+
+  return answered;
+}
+
+/*
+  flush_statement - samples up to end as prepared statement batches,
+                    one per ESP32_MYSQL_BATCH_BYTES of parameters
+*/
+bool ESP32_MySQL_Time_Series::flush_statement(const uint32_t& end)
+{
+  ESP32_MySQL_Lock_Guard guard(conn);
+
+  if (!guard.owns_lock())
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Time_Series: connection busy");
+    return false;
+  }
+
+  if ( !statement.is_prepared() && !statement.prepare(insert_sql.c_str()) )
+    return false;
+
+  TS_Sample samples[ESP32_MYSQL_TS_CHUNK];
+  uint32_t seq = tail;
+  uint32_t count;
+
+  while ((count = copy_samples(seq, end, samples)) > 0)
+  {
+    const uint32_t first = seq - count;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+      statement.bind_int(0, samples[i].time);
+      statement.bind_int(1, samples[i].channel);
+      statement.bind_float(2, samples[i].value);
+
+      if (statement.add_batch())
+        continue;
+
+      // Batch full: send it and start the next with this sample
+      if ( !execute_batch(first + i) || !statement.add_batch() )
+      {
+        statement.clear_batch();
+        return false;
+      }
+    }
+  }
+
+  return execute_batch(seq);
+}
+
+/*
+  execute_batch - send the batch, whose last sample is before seq
+
+  Returns bool - True = answered: the samples are released, those the
+                 server rejected dropped
+*/
+bool ESP32_MySQL_Time_Series::execute_batch(const uint32_t& seq)
+{
+  const uint16_t rows = statement.get_batch_rows();
+
+  if (rows == 0)
+    return true;
+
+  if ( !statement.execute_batch() && !conn->connected() )
+    return false;
+
+  ts_stats.sent     += rows - statement.get_batch_errors();
+  ts_stats.rejected += statement.get_batch_errors();
+
+  release(seq);
+
+  return true;
+}
+
+#endif    // ESP32_MYSQL_TIME_SERIES_IMPL_H
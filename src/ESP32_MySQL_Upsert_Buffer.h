@@ -0,0 +1,156 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Upsert_Buffer.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+/*
+  Coalescing upserts for latest-value tables
+
+  For tables holding the current value of each key, such as device
+  state, where the same keys are written many times per second. Only
+  the latest value of each key is kept, in a small hash table, and all
+  of them go to the server together as one multi-row upsert:
+
+    ESP32_MySQL_Upsert_Buffer state(&conn, "test.device_state", "k", "v");
+
+    state.set_double("temperature", t);     // as often as you like
+    state.set_int("relay", relay_on);
+    state.flush_if_due();                   // in loop()
+
+  sends at most once per interval_ms:
+
+    INSERT INTO test.device_state (k, v) VALUES ('temperature',21.5),('relay',1)
+      ON DUPLICATE KEY UPDATE v = VALUES(v)
+
+  k must be the primary key or a unique key of the table. Memory is
+  fixed by max_keys, whatever the write rate: a key written again before
+  the flush only replaces its value.
+
+  If the connection fails the values stay and are sent with the next
+  flush (an upsert can be sent twice without harm). If the server
+  rejects the statement they are dropped, and so is a value too large
+  for max_bytes on its own. A new key that finds the table full
+  flushes it first, and is refused if that fails.
+*/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_UPSERT_BUFFER_H
+#define ESP32_MYSQL_UPSERT_BUFFER_H
+
+#include "ESP32_MySQL_Debug.h"
+
+#include <ESP32_MySQL_Insert_Batcher.h>
+
+#ifndef ESP32_MYSQL_UPSERT_KEYS
+  #define ESP32_MYSQL_UPSERT_KEYS         32        // keys held between flushes
+#endif
+
+#ifndef ESP32_MYSQL_UPSERT_KEY_LEN
+  #define ESP32_MYSQL_UPSERT_KEY_LEN      24        // longest key
+#endif
+
+#ifndef ESP32_MYSQL_UPSERT_TEXT_LEN
+  #define ESP32_MYSQL_UPSERT_TEXT_LEN     24        // longest string value
+#endif
+
+#ifndef ESP32_MYSQL_UPSERT_INTERVAL_MS
+  #define ESP32_MYSQL_UPSERT_INTERVAL_MS  1000      // shortest time between flushes
+#endif
+
+// Latest value of a key
+typedef struct
+{
+  char      key[ESP32_MYSQL_UPSERT_KEY_LEN + 1];
+  uint8_t   type;         // MYSQL_TYPE_LONGLONG, _FLOAT, _DOUBLE, _STRING or _NULL
+  union
+  {
+    int64_t i;
+    double  d;
+    char    text[ESP32_MYSQL_UPSERT_TEXT_LEN + 1];
+  } value;
+} Upsert_Entry;
+
+typedef struct
+{
+  uint32_t writes;            // set_xxx() calls stored
+  uint32_t coalesced;         // of those, replacing a value not yet sent
+  uint32_t refused;           // new keys with the table full
+  uint32_t flushes;           // upserts answered with Ok
+  uint32_t rows;              // rows in those
+  uint32_t failed_flushes;    // rejected or not answered
+  uint32_t dropped;           // values dropped with a rejected upsert, or too large
+} Upsert_Stats;
+
+class ESP32_MySQL_Upsert_Buffer
+{
+  public:
+    ESP32_MySQL_Upsert_Buffer(ESP32_MySQL_Connection *connection, const char *table,
+                              const char *key_column, const char *value_column,
+                              const uint16_t& max_keys = ESP32_MYSQL_UPSERT_KEYS,
+                              const uint32_t& interval_ms = ESP32_MYSQL_UPSERT_INTERVAL_MS,
+                              const size_t& max_bytes = ESP32_MYSQL_BATCHER_BYTES);
+    ~ESP32_MySQL_Upsert_Buffer();
+
+    bool set_int(const char *key, const int64_t& value);
+    bool set_float(const char *key, const float& value);
+    bool set_double(const char *key, const double& value);
+    bool set_string(const char *key, const char *value);
+    bool set_null(const char *key);
+
+    bool flush();
+    bool flush_if_due();
+
+    // Keys with a value not yet sent
+    uint16_t pending_keys() const
+    {
+      return num_entries;
+    }
+
+    const Upsert_Stats& stats() const
+    {
+      return upsert_stats;
+    }
+
+    void reset_stats()
+    {
+      memset(&upsert_stats, 0, sizeof(upsert_stats));
+    }
+
+    ESP32_MySQL_Connection *connection()
+    {
+      return batcher.connection();
+    }
+
+  private:
+    Upsert_Entry *entry(const char *key);
+    bool  add_row(const Upsert_Entry& e);
+    void  clear();
+    void  reindex();
+
+    ESP32_MySQL_Insert_Batcher batcher;
+
+    // Entries in the order of their first write, found through an open
+    // addressing index of twice as many slots
+    Upsert_Entry  *entries;
+    uint16_t      *slots;               // entry + 1, 0 = empty
+    uint16_t      num_slots;
+    uint16_t      num_entries;
+    uint16_t      max_keys;
+
+    uint32_t      interval_ms;
+    uint32_t      last_flush_ms;
+
+    Upsert_Stats  upsert_stats;
+};
+
+#endif    // ESP32_MYSQL_UPSERT_BUFFER_H
@@ -0,0 +1,362 @@
+/*
+ * ESP32_MySQL - An optimized library for ESP32 to directly connect and execute SQL to MySQL database without intermediary.
+ * 
+ * Copyright (c) 2024 Syafiqlim
+ * 
+ * This software is released under the MIT License.
+ * https://opensource.org/licenses/MIT
+ */
+
+/**************************** 
+  ESP32_MySQL_Upsert_Buffer_Impl.h
+  by Syafiqlim @ syafiqlimx
+*****************************/
+
+#pragma once
+
+#ifndef ESP32_MYSQL_UPSERT_BUFFER_IMPL_H
+#define ESP32_MYSQL_UPSERT_BUFFER_IMPL_H
+
+#include <ESP32_MySQL_Upsert_Buffer.h>
+
+/*
+  ESP32_MySQL_Upsert_Buffer
+
+  table[in]         table name, e.g. "test.device_state"
+  key_column[in]    primary or unique key column
+  value_column[in]  column set to the latest value
+  max_keys[in]      (optional) keys held between flushes
+  interval_ms[in]   (optional) shortest time between flushes
+  max_bytes[in]     (optional) largest upsert; more keys go in several
+*/
+ESP32_MySQL_Upsert_Buffer::ESP32_MySQL_Upsert_Buffer(ESP32_MySQL_Connection *connection, const char *table,
+                                                     const char *key_column, const char *value_column,
+                                                     const uint16_t& max_keys, const uint32_t& interval_ms,
+                                                     const size_t& max_bytes)
+  : batcher(connection, table, (String(key_column) + ", " + value_column).c_str(),
+            (max_keys == 0) ? 1 : max_keys, 0xFFFFFFFFUL, max_bytes)
+{
+  this->max_keys      = (max_keys == 0) ? 1 : max_keys;
+  this->interval_ms   = interval_ms;
+  num_slots           = this->max_keys * 2;
+  num_entries         = 0;
+  last_flush_ms       = millis() - interval_ms;
+
+  memset(&upsert_stats, 0, sizeof(upsert_stats));
+
+  String suffix = String(" ON DUPLICATE KEY UPDATE ") + value_column + " = VALUES(" + value_column + ")";
+
+  batcher.set_suffix(suffix.c_str());
+
+  entries = (Upsert_Entry *) malloc(this->max_keys * sizeof(Upsert_Entry));
+  slots   = (uint16_t *) calloc(num_slots, sizeof(uint16_t));
+
+  if (!entries || !slots)
+  {
+    ESP32_MYSQL_LOGERROR("ESP32_MySQL_Upsert_Buffer: out of memory");
+
+    free(entries);
+    free(slots);
+    entries   = NULL;
+    slots     = NULL;
+  }
+}
+
+ESP32_MySQL_Upsert_Buffer::~ESP32_MySQL_Upsert_Buffer()
+{
+  if (num_entries > 0)
+    ESP32_MYSQL_LOGWARN1("ESP32_MySQL_Upsert_Buffer: values not sent =", num_entries);
+
+  free(entries);
+  free(slots);
+}
+
+bool ESP32_MySQL_Upsert_Buffer::set_int(const char *key, const int64_t& value)
+{
+  Upsert_Entry *e = entry(key);
+
+  if (!e)
+    return false;
+
+  e->type     = MYSQL_TYPE_LONGLONG;
+  e->value.i  = value;
+
+  return true;
+}
+
+bool ESP32_MySQL_Upsert_Buffer::set_float(const char *key, const float& value)
+{
+  Upsert_Entry *e = entry(key);
+
+  if (!e)
+    return false;
+
+  e->type     = MYSQL_TYPE_FLOAT;
+  e->value.d  = value;
+
+  return true;
+}
+
+bool ESP32_MySQL_Upsert_Buffer::set_double(const char *key, const double& value)
+{
+  Upsert_Entry *e = entry(key);
+
+  if (!e)
+    return false;
+
+  e->type     = MYSQL_TYPE_DOUBLE;
+  e->value.d  = value;
+
+  return true;
+}
+
+/*
+  set_string - latest value of key is a string
+
+  value[in]       copied, up to ESP32_MYSQL_UPSERT_TEXT_LEN characters;
+                  NULL = NULL
+
+  Returns bool - False = value too long, key too long or table full
+*/
+bool ESP32_MySQL_Upsert_Buffer::set_string(const char *key, const char *value)
+{
+  if (!value)
+    return set_null(key);
+
+  const size_t value_len = strlen(value);
+
+  if (value_len > ESP32_MYSQL_UPSERT_TEXT_LEN)
+  {
+    ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Upsert_Buffer::set_string: value too long for key", key);
+    return false;
+  }
+
+  Upsert_Entry *e = entry(key);
+
+  if (!e)
+    return false;
+
+  e->type = MYSQL_TYPE_STRING;
+  memcpy(e->value.text, value, value_len + 1);
+
+  return true;
+}
+
+bool ESP32_MySQL_Upsert_Buffer::set_null(const char *key)
+{
+  Upsert_Entry *e = entry(key);
+
+  if (!e)
+    return false;
+
+  e->type = MYSQL_TYPE_NULL;
+
+  return true;
+}
+
+/*
+  entry - the entry of key, added if new
+
+  A full table is flushed to make room.
+
+  Returns Upsert_Entry * - NULL = key too long or no room
+*/
+Upsert_Entry *ESP32_MySQL_Upsert_Buffer::entry(const char *key)
+{
+  const size_t key_len = strlen(key);
+
+  if ( (key_len > ESP32_MYSQL_UPSERT_KEY_LEN) || !entries )
+  {
+    ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Upsert_Buffer: key too long or no memory, key =", key);
+    return NULL;
+  }
+
+  const uint32_t hash = SQL_hash_string(key);
+
+  // Linear probing; at most half of the slots are used, so an empty one
+  // ends every search
+  uint16_t slot = hash % num_slots;
+
+  while (slots[slot] != 0)
+  {
+    Upsert_Entry *e = &entries[slots[slot] - 1];
+
+    if (strcmp(e->key, key) == 0)
+    {
+      upsert_stats.writes++;
+      upsert_stats.coalesced++;
+
+      return e;
+    }
+
+    slot = (slot + 1) % num_slots;
+  }
+
+  if (num_entries >= max_keys)
+  {
+    // A flush answered by the server, Ok or not, empties the table
+    flush();
+
+    if (num_entries > 0)
+    {
+      upsert_stats.refused++;
+      ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Upsert_Buffer: table full, key refused =", key);
+
+      return NULL;
+    }
+
+    slot = hash % num_slots;
+  }
+
+  Upsert_Entry *e = &entries[num_entries++];
+
+  memcpy(e->key, key, key_len + 1);
+  slots[slot] = num_entries;
+
+  upsert_stats.writes++;
+
+  return e;
+}
+
+void ESP32_MySQL_Upsert_Buffer::clear()
+{
+  num_entries = 0;
+
+  if (slots)
+    memset(slots, 0, num_slots * sizeof(uint16_t));
+}
+
+// Builds the index again after entries were removed
+void ESP32_MySQL_Upsert_Buffer::reindex()
+{
+  memset(slots, 0, num_slots * sizeof(uint16_t));
+
+  for (uint16_t i = 0; i < num_entries; i++)
+  {
+    uint16_t slot = SQL_hash_string(entries[i].key) % num_slots;
+
+    while (slots[slot] != 0)
+      slot = (slot + 1) % num_slots;
+
+    slots[slot] = i + 1;
+  }
+}
+
+bool ESP32_MySQL_Upsert_Buffer::add_row(const Upsert_Entry& e)
+{
+  switch (e.type)
+  {
+    case MYSQL_TYPE_LONGLONG:
+      return batcher.add_row(e.key, e.value.i);
+
+    case MYSQL_TYPE_FLOAT:
+      return batcher.add_row(e.key, (float) e.value.d);
+
+    case MYSQL_TYPE_DOUBLE:
+      return batcher.add_row(e.key, e.value.d);
+
+    case MYSQL_TYPE_STRING:
+      return batcher.add_row(e.key, (const char *) e.value.text);
+
+    default:
+      return batcher.add_row(e.key, nullptr);
+  }
+}
+
+/*
+  flush - send the latest value of every key now
+
+  Keys go out in the order they were first written since the last flush.
+  A value that does not fit max_bytes on its own is dropped, counted in
+  stats().dropped.
+
+  Returns bool - True = every value answered with Ok, or nothing to send
+*/
+bool ESP32_MySQL_Upsert_Buffer::flush()
+{
+  last_flush_ms = millis();
+
+  if (num_entries == 0)
+    return true;
+
+  const Batcher_Stats& batch_stats = batcher.stats();
+  const uint32_t failed_before = batch_stats.failed_flushes;
+  const uint32_t dropped_before = batch_stats.failed_rows;
+  const uint32_t rows_before = batch_stats.rows;
+  const uint32_t flushes_before = batch_stats.flushes;
+
+  bool queued = true;
+  uint16_t kept = 0;
+  uint16_t too_large = 0;
+
+  // Several upserts if max_bytes is too small for all keys
+  for (uint16_t i = 0; i < num_entries; i++)
+  {
+    if (queued && !add_row(entries[i]))
+    {
+      if (batcher.pending_rows() > 0)
+      {
+        // The rows before it could not be sent to make room
+        queued = false;
+      }
+      else
+      {
+        ESP32_MYSQL_LOGERROR1("ESP32_MySQL_Upsert_Buffer::flush: value larger than max_bytes dropped, key =",
+                              entries[i].key);
+        too_large++;
+        continue;
+      }
+    }
+
+    if (kept != i)
+      entries[kept] = entries[i];
+
+    kept++;
+  }
+
+  if (queued)
+    batcher.flush();
+
+  upsert_stats.flushes        += batch_stats.flushes - flushes_before;
+  upsert_stats.rows           += batch_stats.rows - rows_before;
+  upsert_stats.failed_flushes += batch_stats.failed_flushes - failed_before;
+  upsert_stats.dropped        += batch_stats.failed_rows - dropped_before + too_large;
+
+  // Rows left in the batcher were not answered: keep them all here, and
+  // send them all again next time
+  if (batcher.pending_rows() > 0)
+  {
+    batcher.clear();
+
+    if (too_large > 0)
+    {
+      num_entries = kept;
+      reindex();
+    }
+
+    return false;
+  }
+
+  const bool sent = (batch_stats.failed_flushes == failed_before) && (too_large == 0);
+
+  clear();
+
+  return sent;
+}
+
+/*
+  flush_if_due - flush if interval_ms has passed since the last flush
+
+  Call it from loop().
+
+  Returns bool - False = a due flush failed
+*/
+bool ESP32_MySQL_Upsert_Buffer::flush_if_due()
+{
+  if ( (num_entries > 0) && ((uint32_t) (millis() - last_flush_ms) >= interval_ms) )
+    return flush();
+
+  return true;
+}
+
+#endif    // ESP32_MYSQL_UPSERT_BUFFER_IMPL_H